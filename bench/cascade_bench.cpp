@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cascade/color_buffer.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/fragment_ops.h>
+#include <cascade/multisample.h>
+#include <cascade/pipeline.h>
+#include <cascade/rasterizer.h>
+#include <cascade/render_context.h>
+#include <cascade/render_farm.h>
+#include <cascade/texture.h>
+#include <cascade/visibility_buffer.h>
+
+#include "scenes.h"
+
+using namespace cascade;
+
+constexpr uint32_t WIDTH = 1920;
+constexpr uint32_t HEIGHT = 1080;
+constexpr uint32_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+constexpr uint32_t WARMUP_ITERATIONS = 2;
+constexpr uint32_t TEXTURE_SIZE = 1024;
+
+// What happens to the fragments the rasterizer emits
+enum class Output {
+    Count,       // Only counted, which measures the rasterizer alone
+    Color,       // Written to a color buffer by the fragment operations
+    ColorDepth,  // Early depth tested by the rasterizer and then written with the depth test
+    Textured,    // Sampled from a texture at the first two attributes, which needs FragmentLayout::Quads
+    Multisample, // Rasterized with 4x MSAA and written to the covered samples, which needs FragmentLayout::Quads
+    Blended,     // Blended over the color buffer with BlendMode::Over
+    // Early depth tested into a visibility buffer, which needs FragmentLayout::Visibility, and then resolved into
+    // fragments that are written to a color buffer
+    Visibility,
+    Fused,      // Same as Color with drawTriangles() shading inside the traversal, which needs four attributes
+    FusedDepth, // Same as ColorDepth with drawTriangles()
+};
+
+struct Benchmark {
+    std::string name;
+    const Scene* scene;
+    Output output;
+    FragmentLayout layout;
+    uint32_t buffer_size;
+    uint32_t worker_count; // Uses rasterizeTiled(), or renderFrames() with frames, if non-zero
+    uint32_t buffer_count = 1;
+    ColorLayout color_layout = ColorLayout::Linear;
+    uint32_t draw_triangles = 0; // Splits the scene into draws of this many triangles if non-zero
+    // Records the draws into a command buffer executed with a render context
+    // instead of making a rasterize() call for each
+    bool command_buffer = false;
+    bool short_indices = false; // Draws with the indices of the scene converted to IndexType::UInt16
+    bool frames = false;        // Renders every cell of a sprite sheet as a frame of its own
+};
+
+struct Result {
+    uint64_t triangles;
+    uint64_t fragments;
+    double min_ns;
+    double median_ns;
+};
+
+// Sits between the rasterizer and the fragment operations to count the
+// fragments of every flushed buffer
+struct FlushTarget {
+    uint64_t fragments;
+    uint32_t fragment_stride;
+    FragmentLayout layout;
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context); // Optional
+    const void* context;
+};
+
+static void countAndFlush(const void* buffer, uint32_t used_bytes, const void* context) {
+    FlushTarget* target = static_cast<FlushTarget*>(const_cast<void*>(context));
+    if (target->layout == FragmentLayout::Quads) {
+        for (uint32_t i = 0; i < used_bytes; i += target->fragment_stride) {
+            const FragmentQuadHeader* header =
+                reinterpret_cast<const FragmentQuadHeader*>(static_cast<const char*>(buffer) + i);
+            target->fragments += std::popcount(header->mask);
+        }
+    } else {
+        target->fragments += used_bytes / target->fragment_stride;
+    }
+    if (target->flush != nullptr) {
+        target->flush(buffer, used_bytes, target->context);
+    }
+}
+
+static void* allocateAligned(size_t size) {
+    // Fragment buffers with FragmentLayout::Quads must be 16-byte aligned
+    void* ptr = std::aligned_alloc(64, (size + 63) / 64 * 64);
+    if (!ptr) {
+        std::fprintf(stderr, "allocation of %zu bytes failed\n", size);
+        std::abort();
+    }
+    return ptr;
+}
+
+// Texels that differ from their neighbors, so that every level of the mip
+// chain has something to filter
+static Texture makeBenchTexture() {
+    std::vector<uint32_t> pixels(TEXTURE_SIZE * TEXTURE_SIZE);
+    for (uint32_t y = 0; y < TEXTURE_SIZE; ++y) {
+        for (uint32_t x = 0; x < TEXTURE_SIZE; ++x) {
+            pixels[y * TEXTURE_SIZE + x] = 0xFF000000u | ((x * 0x9E3779B9u) ^ (y * 0x85EBCA6Bu));
+        }
+    }
+    return createTexture(pixels.data(), TEXTURE_SIZE, TEXTURE_SIZE);
+}
+
+static Result runBenchmark(const Benchmark& bench, uint32_t iterations, uint32_t* linear_color_buffer,
+                           ColorBuffer& blocked_color_buffer, DepthBuffer& depth_buffer, const Texture& texture,
+                           MultisampleBuffer& multisample_buffer, VisibilityBuffer& visibility_buffer) {
+    const Scene& scene = *bench.scene;
+    const uint32_t num_attributes = scene.num_attributes;
+    const uint32_t packed_stride = 2 * sizeof(uint32_t) + (num_attributes + 1) * sizeof(float);
+    uint32_t fragment_stride = packed_stride;
+    if (bench.layout == FragmentLayout::Quads) {
+        fragment_stride = fragmentQuadSize(num_attributes);
+    } else if (bench.layout == FragmentLayout::Visibility) {
+        fragment_stride = sizeof(VisibilityFragment);
+    }
+    const uint32_t worker_count = bench.worker_count > 0 ? bench.worker_count : 1;
+    const bool visibility = bench.output == Output::Visibility;
+    const bool fused = bench.output == Output::Fused || bench.output == Output::FusedDepth;
+    const bool depth = bench.output == Output::ColorDepth || bench.output == Output::FusedDepth || visibility;
+
+    const bool blocked = bench.color_layout == ColorLayout::Blocked;
+    uint32_t* color_buffer = blocked ? blocked_color_buffer.pixels : linear_color_buffer;
+
+    // Command buffers draw into the targets of their render context
+    RenderContext render_context = {};
+    if (bench.command_buffer) {
+        render_context = createRenderContext({WIDTH, HEIGHT, num_attributes, bench.buffer_size, bench.buffer_count});
+        color_buffer = render_context.color_buffer;
+    }
+    DepthBuffer& target_depth_buffer = bench.command_buffer ? render_context.depth_buffer : depth_buffer;
+
+    // The resolved fragments of a visibility buffer are already known to be visible
+    DepthBuffer* output_depth_buffer = depth && !visibility ? &target_depth_buffer : nullptr;
+    OutputContext output_context = {color_buffer, fragment_stride, WIDTH, output_depth_buffer};
+    output_context.color_layout = bench.color_layout;
+    TexturedOutputContext textured_context = {color_buffer, fragment_stride, WIDTH, &texture, 0};
+    textured_context.color_layout = bench.color_layout;
+    MultisampleOutputContext multisample_context = {&multisample_buffer, fragment_stride};
+    const void* flush_context = &output_context;
+    void (*flush)(const void*, uint32_t, const void*) = nullptr;
+    if (bench.output == Output::Textured) {
+        flush = processTexturedQuadsWithoutDepth;
+        flush_context = &textured_context;
+    } else if (bench.output == Output::Multisample) {
+        flush = processMultisampleQuadsWithoutDepth;
+        flush_context = &multisample_context;
+    } else if (visibility) {
+        flush = processVisibilityFragments;
+        flush_context = &visibility_buffer;
+        output_context.fragment_stride = packed_stride;
+    } else if (bench.output == Output::Blended) {
+        flush = bench.layout == FragmentLayout::Quads ? processBlendedFragmentQuads : processBlendedFragments;
+    } else if (bench.output != Output::Count) {
+        if (bench.layout == FragmentLayout::Quads) {
+            flush = depth ? processFragmentQuadsWithDepth : processFragmentQuadsWithoutDepth;
+        } else {
+            flush = depth ? processFragmentsWithDepth : processFragmentsWithoutDepth;
+        }
+    }
+
+    std::vector<FlushTarget> targets(worker_count);
+    std::vector<FragmentBufferInfo> buffers(worker_count);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        targets[i] = {0, fragment_stride, bench.layout, flush, flush_context};
+        buffers[i] = {allocateAligned(static_cast<size_t>(bench.buffer_size) * bench.buffer_count),
+                      bench.buffer_size, countAndFlush, &targets[i], bench.layout, bench.buffer_count};
+    }
+
+    RasterizerInput input = {scene.vertex_data.data(), scene.indices.data(),
+                             static_cast<uint32_t>(scene.indices.size()), scene.strideBytes(),
+                             {{0, 0}, {static_cast<int32_t>(WIDTH - 1), static_cast<int32_t>(HEIGHT - 1)}}};
+    input.depth_buffer = depth ? &depth_buffer : nullptr;
+    input.multisample = bench.output == Output::Multisample;
+    input.topology = scene.strips ? PrimitiveTopology::TriangleStrip : PrimitiveTopology::TriangleList;
+    input.primitive_restart = scene.strips;
+    std::vector<uint16_t> short_indices;
+    if (bench.short_indices) {
+        // Restart indices keep all their bits set
+        short_indices.assign(scene.indices.begin(), scene.indices.end());
+        input.indices = short_indices.data();
+        input.index_type = IndexType::UInt16;
+    }
+
+    CommandBuffer command_buffer = createCommandBuffer(0);
+    if (bench.command_buffer) {
+        for (uint32_t first = 0; first < input.index_count; first += 3 * bench.draw_triangles) {
+            const uint32_t index_count = std::min(3 * bench.draw_triangles, input.index_count - first);
+            recordDraw(command_buffer, {input.vertex_data, input.indices, first, index_count, input.stride_bytes,
+                                        countAndFlush, &targets[0], bench.layout, depth});
+        }
+    }
+
+    // Every frame is clipped to its cell and counts its fragments on its own,
+    // so that the frames can be rendered concurrently
+    std::vector<FlushTarget> frame_targets;
+    std::vector<FrameJob> frame_jobs;
+    RenderFarm render_farm = {};
+    if (bench.frames) {
+        const uint32_t cells_x = WIDTH / scene.cell_size;
+        const uint32_t cell_count = scene.triangleCount() / scene.cell_triangles;
+        frame_targets.assign(cell_count, targets[0]);
+        for (uint32_t cell = 0; cell < cell_count; ++cell) {
+            const int32_t x = static_cast<int32_t>(cell % cells_x * scene.cell_size);
+            const int32_t y = static_cast<int32_t>(cell / cells_x * scene.cell_size);
+            const int32_t last = static_cast<int32_t>(scene.cell_size) - 1;
+            RasterizerInput frame = input;
+            frame.indices = scene.indices.data() + 3 * cell * scene.cell_triangles;
+            frame.index_count = 3 * scene.cell_triangles;
+            frame.bounds = {{x, y}, {x + last, y + last}};
+            frame_jobs.push_back({frame, countAndFlush, &frame_targets[cell], bench.layout});
+        }
+        if (bench.worker_count > 0) {
+            render_farm = createRenderFarm({bench.worker_count, num_attributes, bench.buffer_size});
+        }
+    }
+
+    // The visibility buffer is resolved into a buffer of its own
+    OutputContext resolve_context = output_context;
+    FragmentBufferInfo resolve_buffer = {allocateAligned(bench.buffer_size), bench.buffer_size,
+                                         processFragmentsWithoutDepth, &resolve_context};
+
+    std::vector<double> times;
+    uint64_t fragments = 0;
+    for (uint32_t iteration = 0; iteration < WARMUP_ITERATIONS + iterations; ++iteration) {
+        if (depth) {
+            clearDepthBuffer(target_depth_buffer, 1.0f);
+        }
+        if (visibility) {
+            clearVisibilityBuffer(visibility_buffer);
+        }
+        for (FlushTarget& target : targets) {
+            target.fragments = 0;
+        }
+        for (FlushTarget& target : frame_targets) {
+            target.fragments = 0;
+        }
+
+        uint64_t fused_fragments = 0;
+        auto start = std::chrono::steady_clock::now();
+        if (fused) {
+            auto output = [&](int x, int y, uint32_t color) {
+                color_buffer[y * WIDTH + x] = color;
+                ++fused_fragments;
+            };
+            if (depth) {
+                drawTriangles<4>(input, LessDepthTest{&depth_buffer}, VertexColorShader{}, output);
+            } else {
+                drawTriangles<4>(input, NoDepthTest{}, VertexColorShader{}, output);
+            }
+        } else if (bench.frames && bench.worker_count > 0) {
+            renderFrames(render_farm, frame_jobs.data(), static_cast<uint32_t>(frame_jobs.size()));
+        } else if (bench.frames) {
+            for (const FrameJob& job : frame_jobs) {
+                rasterize(job.input, {buffers[0].buffer, bench.buffer_size, countAndFlush, job.context, bench.layout});
+            }
+        } else if (bench.worker_count > 0) {
+            rasterizeTiled(input, buffers.data(), worker_count);
+        } else if (bench.command_buffer) {
+            executeCommandBuffer(command_buffer, render_context);
+        } else if (bench.draw_triangles > 0) {
+            for (uint32_t first = 0; first < input.index_count; first += 3 * bench.draw_triangles) {
+                RasterizerInput draw = input;
+                draw.indices = scene.indices.data() + first;
+                draw.index_count = std::min(3 * bench.draw_triangles, input.index_count - first);
+                rasterize(draw, buffers[0]);
+            }
+        } else {
+            rasterize(input, buffers[0]);
+        }
+        if (visibility) {
+            resolveVisibilityBuffer(visibility_buffer, input, resolve_buffer);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        if (iteration >= WARMUP_ITERATIONS) {
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        fragments = fused_fragments;
+        for (const FlushTarget& target : targets) {
+            fragments += target.fragments;
+        }
+        for (const FlushTarget& target : frame_targets) {
+            fragments += target.fragments;
+        }
+    }
+
+    for (FragmentBufferInfo& buffer : buffers) {
+        std::free(buffer.buffer);
+    }
+    std::free(resolve_buffer.buffer);
+    destroyCommandBuffer(command_buffer);
+    if (bench.command_buffer) {
+        destroyRenderContext(render_context);
+    }
+    if (bench.frames && bench.worker_count > 0) {
+        destroyRenderFarm(render_farm);
+    }
+
+    std::sort(times.begin(), times.end());
+    size_t middle = times.size() / 2;
+    double median = times.size() % 2 ? times[middle] : 0.5 * (times[middle - 1] + times[middle]);
+    return {scene.triangleCount(), fragments, times.front(), median};
+}
+
+static double trianglesPerSecond(const Result& result) { return result.triangles / (result.median_ns * 1e-9); }
+
+static double megaFragmentsPerSecond(const Result& result) {
+    return result.fragments / (result.median_ns * 1e-9) / 1e6;
+}
+
+static double nsPerPixel(const Result& result) {
+    return result.fragments > 0 ? result.median_ns / result.fragments : 0.0;
+}
+
+static bool writeJson(const char* path, const std::vector<Benchmark>& benchmarks, const std::vector<Result>& results,
+                      uint32_t iterations) {
+    FILE* file = std::strcmp(path, "-") == 0 ? stdout : std::fopen(path, "w");
+    if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    const char* simd = std::getenv("CASCADE_SIMD");
+    std::fprintf(file, "{\n  \"width\": %u,\n  \"height\": %u,\n  \"iterations\": %u,\n  \"simd\": \"%s\",\n", WIDTH,
+                 HEIGHT, iterations, simd ? simd : "auto");
+    std::fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        std::fprintf(file,
+                     "    {\"name\": \"%s\", \"triangles\": %llu, \"fragments\": %llu, \"min_ns\": %.0f, "
+                     "\"median_ns\": %.0f, \"triangles_per_sec\": %.0f, \"mfragments_per_sec\": %.3f, "
+                     "\"ns_per_pixel\": %.4f}%s\n",
+                     benchmarks[i].name.c_str(), static_cast<unsigned long long>(result.triangles),
+                     static_cast<unsigned long long>(result.fragments), result.min_ns, result.median_ns,
+                     trianglesPerSecond(result), megaFragmentsPerSecond(result), nsPerPixel(result),
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+
+    if (file != stdout) {
+        std::fclose(file);
+    }
+    return true;
+}
+
+// Looks up the median time of the named benchmark in JSON written by
+// writeJson(). Returns a negative value if it is not there.
+static double findBaselineMedian(const std::string& json, const std::string& name) {
+    size_t entry = json.find("\"name\": \"" + name + "\"");
+    if (entry == std::string::npos) {
+        return -1.0;
+    }
+    size_t field = json.find("\"median_ns\": ", entry);
+    size_t next_entry = json.find("\"name\": ", entry + 1);
+    if (field == std::string::npos || field > next_entry) {
+        return -1.0;
+    }
+    return std::strtod(json.c_str() + field + std::strlen("\"median_ns\": "), nullptr);
+}
+
+static bool readFile(const char* path, std::string& contents) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    char chunk[4096];
+    size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        contents.append(chunk, read);
+    }
+    std::fclose(file);
+    return true;
+}
+
+static void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --iterations <n>   Timed iterations per benchmark (default 15)\n"
+                 "  --filter <text>    Only run benchmarks whose name contains text\n"
+                 "  --json <file>      Write the results as JSON, - for stdout\n"
+                 "  --baseline <file>  Compare against JSON from an earlier run and fail on regressions\n"
+                 "  --tolerance <t>    Allowed slowdown of the median against the baseline (default 0.1)\n"
+                 "  --list             List the benchmarks and exit\n",
+                 program);
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 15;
+    const char* filter = nullptr;
+    const char* json_path = nullptr;
+    const char* baseline_path = nullptr;
+    double tolerance = 0.1;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--iterations") == 0 && has_value) {
+            iterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+            json_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && has_value) {
+            baseline_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--tolerance") == 0 && has_value) {
+            tolerance = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (iterations == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const Scene tiny = makeTinyTriangles(WIDTH, HEIGHT, 4, 200000);
+    const Scene fullscreen = makeFullscreenTriangles(WIDTH, HEIGHT, 4, 4);
+    const Scene slivers = makeSlivers(WIDTH, HEIGHT, 4, 5000);
+    const Scene back_to_front = makeOverdraw(WIDTH, HEIGHT, 4, 32, true);
+    const Scene front_to_back = makeOverdraw(WIDTH, HEIGHT, 4, 32, false);
+    const Scene mesh = makeMesh(WIDTH, HEIGHT, 4, 8, false);
+    const Scene mesh_strips = makeMesh(WIDTH, HEIGHT, 4, 8, true);
+    const Scene sprites = makeSpriteSheet(WIDTH, HEIGHT, 4, 64, 64);
+
+    constexpr uint32_t ATTRIBUTE_COUNTS[] = {0, 1, 2, 4, 8, 16};
+    std::vector<Scene> medium;
+    for (uint32_t num_attributes : ATTRIBUTE_COUNTS) {
+        medium.push_back(makeMediumTriangles(WIDTH, HEIGHT, num_attributes, 20000));
+    }
+    const Scene& medium4 = medium[3];
+    const uint32_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<Benchmark> benchmarks = {
+        {"tiny/a4", &tiny, Output::Count, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0},
+        {"fullscreen/a4", &fullscreen, Output::Count, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0},
+        {"fullscreen/a4/color", &fullscreen, Output::Color, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0},
+        {"fullscreen/a4/quads_color", &fullscreen, Output::Color, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0},
+        {"fullscreen/a4/quads_color_blocked", &fullscreen, Output::Color, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0,
+         1, ColorLayout::Blocked},
+        {"fullscreen/a4/textured", &fullscreen, Output::Textured, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0},
+        {"fullscreen/a4/msaa", &fullscreen, Output::Multisample, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0},
+        {"slivers/a4", &slivers, Output::Count, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0},
+        {"overdraw_back_to_front/a4/depth", &back_to_front, Output::ColorDepth, FragmentLayout::Packed,
+         DEFAULT_BUFFER_SIZE, 0},
+        {"overdraw_front_to_back/a4/depth", &front_to_back, Output::ColorDepth, FragmentLayout::Packed,
+         DEFAULT_BUFFER_SIZE, 0},
+        {"overdraw_back_to_front/a4/visibility", &back_to_front, Output::Visibility, FragmentLayout::Visibility,
+         DEFAULT_BUFFER_SIZE, 0},
+        {"overdraw_back_to_front/a4/fused_depth", &back_to_front, Output::FusedDepth, FragmentLayout::Packed,
+         DEFAULT_BUFFER_SIZE, 0},
+    };
+    for (size_t i = 0; i < medium.size(); ++i) {
+        benchmarks.push_back({"medium/a" + std::to_string(ATTRIBUTE_COUNTS[i]), &medium[i], Output::Count,
+                              FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    }
+    for (uint32_t buffer_size : {1024u, 4096u, 16384u, 262144u, 1048576u}) {
+        benchmarks.push_back({"medium/a4/buffer_" + std::to_string(buffer_size), &medium4, Output::Count,
+                              FragmentLayout::Packed, buffer_size, 0});
+    }
+    benchmarks.push_back({"medium/a4/quads", &medium4, Output::Count, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back({"medium/a4/color", &medium4, Output::Color, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"medium/a4/color_fused", &medium4, Output::Fused, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back({"medium/a4/color_blocked", &medium4, Output::Color, FragmentLayout::Packed,
+                          DEFAULT_BUFFER_SIZE, 0, 1, ColorLayout::Blocked});
+    // Four buffers flushed on a separate thread against a single one of the
+    // same size
+    benchmarks.push_back({"medium/a4/color_buffer_4096", &medium4, Output::Color, FragmentLayout::Packed, 4096, 0});
+    benchmarks.push_back({"medium/a4/color_pipelined", &medium4, Output::Color, FragmentLayout::Packed, 4096, 0, 4});
+    // Many small draws, each with its own rasterize() call against a command
+    // buffer that shares the fragment buffers and the flush thread between them
+    benchmarks.push_back({"tiny/a4/color_draws_16", &tiny, Output::Color, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE,
+                          0, 1, ColorLayout::Linear, 16});
+    benchmarks.push_back({"tiny/a4/color_draws_16_cmd", &tiny, Output::Color, FragmentLayout::Packed,
+                          DEFAULT_BUFFER_SIZE, 0, 1, ColorLayout::Linear, 16, true});
+    benchmarks.push_back({"tiny/a4/color_pipelined_draws_16", &tiny, Output::Color, FragmentLayout::Packed, 4096, 0, 4,
+                          ColorLayout::Linear, 16});
+    benchmarks.push_back({"tiny/a4/color_pipelined_draws_16_cmd", &tiny, Output::Color, FragmentLayout::Packed, 4096,
+                          0, 4, ColorLayout::Linear, 16, true});
+    benchmarks.push_back(
+        {"medium/a4/textured", &medium4, Output::Textured, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"medium/a4/msaa", &medium4, Output::Multisample, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"medium/a4/blended", &medium4, Output::Blended, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"medium/a4/quads_blended", &medium4, Output::Blended, FragmentLayout::Quads, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"medium/a4/tiled", &medium4, Output::Count, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, worker_count});
+    // The same mesh drawn from a triangle list, from strips and from strips
+    // with 16-bit indices
+    benchmarks.push_back({"mesh/a4/color", &mesh, Output::Color, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back(
+        {"mesh_strips/a4/color", &mesh_strips, Output::Color, FragmentLayout::Packed, DEFAULT_BUFFER_SIZE, 0});
+    benchmarks.push_back({"mesh_strips/a4/color_index16", &mesh_strips, Output::Color, FragmentLayout::Packed,
+                          DEFAULT_BUFFER_SIZE, 0, 1, ColorLayout::Linear, 0, false, true});
+    // Small independent frames one after another against all of them spread
+    // over the workers of a render farm
+    benchmarks.push_back({"sprites/a4/color_frames", &sprites, Output::Color, FragmentLayout::Packed,
+                          DEFAULT_BUFFER_SIZE, 0, 1, ColorLayout::Linear, 0, false, false, true});
+    benchmarks.push_back({"sprites/a4/color_farm", &sprites, Output::Color, FragmentLayout::Packed,
+                          DEFAULT_BUFFER_SIZE, worker_count, 1, ColorLayout::Linear, 0, false, false, true});
+
+    if (filter != nullptr) {
+        std::erase_if(benchmarks,
+                      [&](const Benchmark& bench) { return bench.name.find(filter) == std::string::npos; });
+    }
+    if (list) {
+        for (const Benchmark& bench : benchmarks) {
+            std::printf("%s\n", bench.name.c_str());
+        }
+        return 0;
+    }
+
+    std::string baseline;
+    if (baseline_path != nullptr && !readFile(baseline_path, baseline)) {
+        std::fprintf(stderr, "cannot read baseline %s\n", baseline_path);
+        return 1;
+    }
+
+    uint32_t* color_buffer = static_cast<uint32_t*>(allocateAligned(WIDTH * HEIGHT * sizeof(uint32_t)));
+    std::memset(color_buffer, 0, WIDTH * HEIGHT * sizeof(uint32_t));
+    ColorBuffer blocked_color_buffer = createColorBuffer(WIDTH, HEIGHT);
+    clearColorBuffer(blocked_color_buffer, 0);
+    DepthBuffer depth_buffer = createDepthBuffer(WIDTH, HEIGHT);
+    Texture texture = makeBenchTexture();
+    MultisampleBuffer multisample_buffer = createMultisampleBuffer(WIDTH, HEIGHT);
+    clearMultisampleBuffer(multisample_buffer, 0, 1.0f);
+    VisibilityBuffer visibility_buffer = createVisibilityBuffer(WIDTH, HEIGHT);
+
+    // The table goes to stderr when the JSON is written to stdout
+    FILE* table = json_path != nullptr && std::strcmp(json_path, "-") == 0 ? stderr : stdout;
+    std::fprintf(table, "%-36s %10s %12s %10s %10s %12s %10s %8s\n", "benchmark", "triangles", "fragments", "min ms",
+                 "median ms", "Mtri/s", "Mfrag/s", "ns/px");
+
+    std::vector<Result> results;
+    int regressions = 0;
+    for (const Benchmark& bench : benchmarks) {
+        Result result = runBenchmark(bench, iterations, color_buffer, blocked_color_buffer, depth_buffer, texture,
+                                     multisample_buffer, visibility_buffer);
+        results.push_back(result);
+        std::fprintf(table, "%-36s %10llu %12llu %10.3f %10.3f %12.3f %10.1f %8.3f", bench.name.c_str(),
+                     static_cast<unsigned long long>(result.triangles),
+                     static_cast<unsigned long long>(result.fragments), result.min_ns * 1e-6, result.median_ns * 1e-6,
+                     trianglesPerSecond(result) * 1e-6, megaFragmentsPerSecond(result), nsPerPixel(result));
+
+        if (!baseline.empty()) {
+            double baseline_median = findBaselineMedian(baseline, bench.name);
+            if (baseline_median > 0.0) {
+                double change = result.median_ns / baseline_median - 1.0;
+                bool regressed = change > tolerance;
+                regressions += regressed;
+                std::fprintf(table, "  %+6.1f%%%s", 100.0 * change, regressed ? " REGRESSION" : "");
+            } else {
+                std::fprintf(table, "  (not in baseline)");
+            }
+        }
+        std::fprintf(table, "\n");
+    }
+
+    destroyVisibilityBuffer(visibility_buffer);
+    destroyMultisampleBuffer(multisample_buffer);
+    destroyTexture(texture);
+    destroyDepthBuffer(depth_buffer);
+    destroyColorBuffer(blocked_color_buffer);
+    std::free(color_buffer);
+
+    if (json_path != nullptr && !writeJson(json_path, benchmarks, results, iterations)) {
+        return 1;
+    }
+    if (regressions > 0) {
+        std::fprintf(stderr, "%d benchmark(s) regressed by more than %.1f%%\n", regressions, 100.0 * tolerance);
+        return 2;
+    }
+    return 0;
+}
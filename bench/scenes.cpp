@@ -0,0 +1,230 @@
+#include "scenes.h"
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// xorshift32, which is fully determined by the seed
+class Random {
+public:
+    explicit Random(uint32_t seed) : state_(seed) {}
+
+    uint32_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    // Uniform in [min, max)
+    float uniform(float min, float max) { return min + (max - min) * static_cast<float>(next() >> 8) / 16777216.0f; }
+
+private:
+    uint32_t state_;
+};
+
+struct Point {
+    float x;
+    float y;
+};
+
+class SceneBuilder {
+public:
+    SceneBuilder(uint32_t num_attributes, uint32_t seed) : random_(seed) { scene_.num_attributes = num_attributes; }
+
+    Random& random() { return random_; }
+
+    // Appends a triangle with the given screen space vertices and depth. The
+    // vertices are reordered if needed so that the triangle is front-facing,
+    // which means clockwise winding on the screen.
+    void appendTriangle(Point a, Point b, Point c, float z) {
+        float cross = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (cross < 0.0f) {
+            Point tmp = b;
+            b = c;
+            c = tmp;
+        }
+        uint32_t first = static_cast<uint32_t>(scene_.vertex_data.size() / (4 + scene_.num_attributes));
+        appendVertex(a, z);
+        appendVertex(b, z);
+        appendVertex(c, z);
+        scene_.indices.push_back(first);
+        scene_.indices.push_back(first + 1);
+        scene_.indices.push_back(first + 2);
+    }
+
+    // Appends a vertex without a triangle, for scenes that build their own
+    // indices through scene()
+    void appendVertex(Point p, float z) {
+        scene_.vertex_data.push_back(p.x);
+        scene_.vertex_data.push_back(p.y);
+        scene_.vertex_data.push_back(z);
+        scene_.vertex_data.push_back(1.0f);
+        for (uint32_t i = 0; i < scene_.num_attributes; ++i) {
+            scene_.vertex_data.push_back(random_.uniform(0.0f, 1.0f));
+        }
+    }
+
+    Scene& scene() { return scene_; }
+
+    Scene take() { return std::move(scene_); }
+
+private:
+    Scene scene_ = {};
+    Random random_;
+};
+
+// Triangle with its vertices at the given distance from the center, each at a
+// random angle within its own third of the circle so it is never degenerate
+void appendRandomTriangle(SceneBuilder& builder, Point center, float radius, float z) {
+    constexpr float THIRD = 2.0f * 3.14159265f / 3.0f;
+    Random& random = builder.random();
+    float start = random.uniform(0.0f, THIRD);
+    Point v[3];
+    for (int k = 0; k < 3; ++k) {
+        float angle = start + k * THIRD + random.uniform(-0.3f, 0.3f);
+        v[k] = {center.x + radius * std::cos(angle), center.y + radius * std::sin(angle)};
+    }
+    builder.appendTriangle(v[0], v[1], v[2], z);
+}
+
+} // namespace
+
+Scene makeTinyTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count) {
+    SceneBuilder builder(num_attributes, 0x9E3779B9u);
+    Random& random = builder.random();
+    for (uint32_t i = 0; i < count; ++i) {
+        Point center = {random.uniform(0.0f, static_cast<float>(width)),
+                        random.uniform(0.0f, static_cast<float>(height))};
+        appendRandomTriangle(builder, center, random.uniform(0.5f, 1.5f), random.uniform(0.0f, 1.0f));
+    }
+    return builder.take();
+}
+
+Scene makeFullscreenTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count) {
+    SceneBuilder builder(num_attributes, 0x85EBCA6Bu);
+    Random& random = builder.random();
+    const float w = static_cast<float>(width);
+    const float h = static_cast<float>(height);
+    for (uint32_t i = 0; i < count; ++i) {
+        // The hypotenuse runs from (2w, 0) to (0, 2h), which leaves the whole
+        // screen inside the triangle
+        float margin = random.uniform(1.0f, 16.0f);
+        builder.appendTriangle({-margin, -margin}, {2.0f * w + margin, -margin}, {-margin, 2.0f * h + margin},
+                               random.uniform(0.0f, 1.0f));
+    }
+    return builder.take();
+}
+
+Scene makeSlivers(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count) {
+    SceneBuilder builder(num_attributes, 0xC2B2AE35u);
+    Random& random = builder.random();
+    for (uint32_t i = 0; i < count; ++i) {
+        Point center = {random.uniform(0.0f, static_cast<float>(width)),
+                        random.uniform(0.0f, static_cast<float>(height))};
+        float angle = random.uniform(0.0f, 3.14159265f);
+        float half_length = random.uniform(100.0f, 400.0f);
+        float half_width = random.uniform(0.5f, 1.0f);
+        Point dir = {std::cos(angle), std::sin(angle)};
+        Point a = {center.x - dir.x * half_length, center.y - dir.y * half_length};
+        Point b = {center.x + dir.x * half_length - dir.y * half_width,
+                   center.y + dir.y * half_length + dir.x * half_width};
+        Point c = {center.x + dir.x * half_length + dir.y * half_width,
+                   center.y + dir.y * half_length - dir.x * half_width};
+        builder.appendTriangle(a, b, c, random.uniform(0.0f, 1.0f));
+    }
+    return builder.take();
+}
+
+Scene makeMediumTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count) {
+    SceneBuilder builder(num_attributes, 0x27D4EB2Fu);
+    Random& random = builder.random();
+    for (uint32_t i = 0; i < count; ++i) {
+        Point center = {random.uniform(0.0f, static_cast<float>(width)),
+                        random.uniform(0.0f, static_cast<float>(height))};
+        appendRandomTriangle(builder, center, random.uniform(8.0f, 24.0f), random.uniform(0.0f, 1.0f));
+    }
+    return builder.take();
+}
+
+Scene makeOverdraw(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t layers, bool back_to_front) {
+    SceneBuilder builder(num_attributes, 0x165667B1u);
+    Random& random = builder.random();
+    const float size = 0.6f * static_cast<float>(width < height ? width : height);
+    for (uint32_t i = 0; i < layers; ++i) {
+        uint32_t depth_rank = back_to_front ? layers - i : i + 1;
+        float z = static_cast<float>(depth_rank) / static_cast<float>(layers + 1);
+        float x0 = 0.5f * (static_cast<float>(width) - size) + random.uniform(-16.0f, 16.0f);
+        float y0 = 0.5f * (static_cast<float>(height) - size) + random.uniform(-16.0f, 16.0f);
+        Point top_left = {x0, y0};
+        Point top_right = {x0 + size, y0};
+        Point bottom_left = {x0, y0 + size};
+        Point bottom_right = {x0 + size, y0 + size};
+        builder.appendTriangle(top_left, top_right, bottom_left, z);
+        builder.appendTriangle(top_right, bottom_right, bottom_left, z);
+    }
+    return builder.take();
+}
+
+Scene makeSpriteSheet(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t cell_size, uint32_t count) {
+    SceneBuilder builder(num_attributes, 0xFD7046C5u);
+    Random& random = builder.random();
+    const float half_cell = 0.5f * static_cast<float>(cell_size);
+    for (uint32_t y = 0; y + cell_size <= height; y += cell_size) {
+        for (uint32_t x = 0; x + cell_size <= width; x += cell_size) {
+            Point center = {static_cast<float>(x) + half_cell, static_cast<float>(y) + half_cell};
+            for (uint32_t i = 0; i < count; ++i) {
+                Point offset = {random.uniform(-0.5f, 0.5f) * half_cell, random.uniform(-0.5f, 0.5f) * half_cell};
+                appendRandomTriangle(builder, {center.x + offset.x, center.y + offset.y},
+                                     random.uniform(2.0f, 0.5f * half_cell), random.uniform(0.0f, 1.0f));
+            }
+        }
+    }
+
+    Scene& scene = builder.scene();
+    scene.cell_size = cell_size;
+    scene.cell_triangles = count;
+    return builder.take();
+}
+
+Scene makeMesh(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t cell_size, bool strips) {
+    SceneBuilder builder(num_attributes, 0xD3A2646Cu);
+    Random& random = builder.random();
+    const uint32_t columns = (width + cell_size - 1) / cell_size;
+    const uint32_t rows = (height + cell_size - 1) / cell_size;
+    for (uint32_t y = 0; y <= rows; ++y) {
+        for (uint32_t x = 0; x <= columns; ++x) {
+            builder.appendVertex({static_cast<float>(x * cell_size), static_cast<float>(y * cell_size)},
+                                 random.uniform(0.0f, 1.0f));
+        }
+    }
+
+    // Each row starts at its bottom left corner and zigzags to the right,
+    // which makes every triangle clockwise once the strip has flipped every
+    // second one
+    Scene& scene = builder.scene();
+    scene.strips = strips;
+    for (uint32_t y = 0; y < rows; ++y) {
+        const uint32_t top = y * (columns + 1);
+        const uint32_t bottom = top + columns + 1;
+        if (strips) {
+            if (y > 0) {
+                scene.indices.push_back(UINT32_MAX);
+            }
+            for (uint32_t x = 0; x <= columns; ++x) {
+                scene.indices.push_back(bottom + x);
+                scene.indices.push_back(top + x);
+            }
+            ++scene.strip_count;
+            continue;
+        }
+        for (uint32_t x = 0; x < columns; ++x) {
+            scene.indices.insert(scene.indices.end(), {bottom + x, top + x, bottom + x + 1});
+            scene.indices.insert(scene.indices.end(), {bottom + x + 1, top + x, top + x + 1});
+        }
+    }
+    return builder.take();
+}
@@ -0,0 +1,63 @@
+#ifndef CASCADE_BENCH_SCENES_H_
+#define CASCADE_BENCH_SCENES_H_
+
+#include <cstdint>
+#include <vector>
+
+// Synthetic scenes for the benchmarks. They are generated from a fixed seed,
+// so every run and every machine sees exactly the same geometry.
+//
+// Vertices are given in screen space as x, y, z, w followed by the
+// attributes, with z in [0, 1] and w = 1. All triangles are front-facing and
+// lie within the guard band of the rasterizer.
+struct Scene {
+    std::vector<float> vertex_data;
+    std::vector<uint32_t> indices;
+    uint32_t num_attributes;
+    // The indices form strip_count triangle strips separated by restart
+    // indices, which have all bits set, if set and a triangle list otherwise
+    bool strips = false;
+    uint32_t strip_count = 0;
+    // Set for sprite sheets, whose triangles are grouped by the square cell
+    // of cell_size pixels they are drawn in, cell_triangles per cell and the
+    // cells in row-major order
+    uint32_t cell_size = 0;
+    uint32_t cell_triangles = 0;
+
+    uint32_t strideBytes() const { return (4 + num_attributes) * sizeof(float); }
+    uint32_t triangleCount() const {
+        if (strips) {
+            return strip_count > 0 ? static_cast<uint32_t>(indices.size() + 1 - 3 * strip_count) : 0;
+        }
+        return static_cast<uint32_t>(indices.size() / 3);
+    }
+};
+
+// Many triangles about a pixel in size spread over the whole screen
+Scene makeTinyTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count);
+
+// A few triangles that each cover the whole screen
+Scene makeFullscreenTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count);
+
+// Long triangles between one and two pixels wide at random angles
+Scene makeSlivers(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count);
+
+// Triangles of a few hundred pixels spread over the whole screen
+Scene makeMediumTriangles(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t count);
+
+// Layers of overlapping quads in the middle of the screen, each layer closer
+// to the viewer than the previous one if back_to_front is set and farther
+// away otherwise
+Scene makeOverdraw(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t layers, bool back_to_front);
+
+// Sprite sheet of small independent images in square cells of cell_size
+// pixels, each with count triangles of a few pixels to half the cell in size
+// around its center
+Scene makeSpriteSheet(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t cell_size, uint32_t count);
+
+// Grid of square cells cell_size pixels wide covering the whole screen, two
+// triangles per cell sharing the vertices of the grid. Every row of cells is
+// either one triangle strip or the same triangles as a list.
+Scene makeMesh(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t cell_size, bool strips);
+
+#endif
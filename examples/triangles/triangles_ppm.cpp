@@ -1,10 +1,10 @@
 #include <cstdint>
-#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 
 #include <cascade/fragment_ops.h>
+#include <cascade/image_export.h>
 #include <cascade/rasterizer.h>
 
 constexpr uint32_t WIDTH = 640;
@@ -52,19 +52,12 @@ int main(int argc, char** argv) {
     FragmentBufferInfo fbi = {fragment_buffer, FRAG_BUF_SIZE, processFragmentsWithoutDepth, &context};
     rasterize(input, fbi);
 
-    FILE* file = std::fopen(argv[1], "wb");
-    std::fprintf(file, "P6\n%u %u\n255\n", WIDTH, HEIGHT);
-
-    for (int i = 0; i < WIDTH * HEIGHT; ++i) {
-        uint32_t pixel = framebuffer[i];
-        uint8_t r = static_cast<uint8_t>((pixel >> 16) & 0xFF);
-        uint8_t g = static_cast<uint8_t>((pixel >> 8) & 0xFF);
-        uint8_t b = static_cast<uint8_t>(pixel & 0xFF);
-        uint8_t channels[] = {r, g, b};
-        std::fwrite(channels, 1, 3, file);
-    }
-
-    std::fclose(file);
+    const bool written = writeImage(argv[1], ImageFormat::PPM, framebuffer, WIDTH, HEIGHT, WIDTH * sizeof(uint32_t));
     std::free(fragment_buffer);
     std::free(framebuffer);
+
+    if (!written) {
+        std::cerr << "writing " << argv[1] << " failed\n";
+        return 1;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef CASCADE_COLOR_BUFFER_H_
+#define CASCADE_COLOR_BUFFER_H_
+
+#include <cstdint>
+
+namespace cascade {
+
+// Colors are stored in blocks of COLOR_BLOCK_SIZE x COLOR_BLOCK_SIZE pixels
+// like the depth buffer. A row-major buffer starts a new cache line, and
+// often a new page, for every row a triangle covers, while in blocks the
+// pixels of a triangle stay within a few cache lines.
+constexpr uint32_t COLOR_BLOCK_SIZE = 8;
+
+// How the pixels of the color buffer of the fragment operations are laid out
+enum class ColorLayout : uint32_t {
+    Linear,  // Row-major, pixel (x, y) at y * width + x
+    Blocked, // Blocks of a ColorBuffer
+};
+
+// Color buffer covering pixels [0, width) x [0, height) with
+// ColorLayout::Blocked. Pixels use the same BGRA packing as a linear color
+// buffer.
+struct ColorBuffer {
+    uint32_t* pixels; // Blocks in row-major order, pixels within a block as well
+    uint32_t width;
+    uint32_t height;
+    uint32_t blocks_x;
+    uint32_t blocks_y;
+};
+
+ColorBuffer createColorBuffer(uint32_t width, uint32_t height);
+
+void destroyColorBuffer(ColorBuffer& color_buffer);
+
+void clearColorBuffer(ColorBuffer& color_buffer, uint32_t color);
+
+// Position of pixel (x, y) in ColorBuffer::pixels
+inline uint32_t colorBufferIndex(const ColorBuffer& color_buffer, uint32_t x, uint32_t y) {
+    uint32_t block = (y / COLOR_BLOCK_SIZE) * color_buffer.blocks_x + x / COLOR_BLOCK_SIZE;
+    return block * COLOR_BLOCK_SIZE * COLOR_BLOCK_SIZE + (y % COLOR_BLOCK_SIZE) * COLOR_BLOCK_SIZE +
+           x % COLOR_BLOCK_SIZE;
+}
+
+// Copies the pixels into a row-major image with the BGRA pixels of a linear
+// color buffer, for presentation. Rows of the image are pitch_bytes apart.
+void resolveColorBuffer(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes);
+
+// Same as resolveColorBuffer() with 3 bytes per pixel in RGB order, as used
+// by PPM and most image formats
+void resolveColorBufferRGB(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes);
+
+} // namespace cascade
+
+#endif
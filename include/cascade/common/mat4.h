@@ -0,0 +1,15 @@
+#ifndef CASCADE_MAT4_H_
+#define CASCADE_MAT4_H_
+
+namespace cascade {
+
+// Column-major 4x4 matrix, so element (row, column) is m[column * 4 + row].
+// Vectors are treated as columns and multiplied from the right.
+template <typename T>
+struct Mat4 {
+    T m[16];
+};
+
+} // namespace cascade
+
+#endif
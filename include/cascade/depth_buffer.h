@@ -0,0 +1,72 @@
+#ifndef CASCADE_DEPTH_BUFFER_H_
+#define CASCADE_DEPTH_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cascade {
+
+// Depth values are stored in blocks of DEPTH_BLOCK_SIZE x DEPTH_BLOCK_SIZE
+// pixels so that the pixels the rasterizer classifies together are contiguous
+// in memory. The blocks and the tiles they are grouped into are aligned to the
+// origin of the screen and match the ones used by the rasterizer.
+constexpr uint32_t DEPTH_BLOCK_SIZE = 8;
+constexpr uint32_t DEPTH_TILE_SIZE = 64;
+
+// Depth buffer covering pixels [0, width) x [0, height). Smaller depth values
+// are closer to the viewer.
+//
+// Besides the per-pixel depth it keeps the range of depth values stored in
+// every block and every tile, which lets the rasterizer reject geometry hidden
+// behind what has already been drawn without testing individual pixels. The
+// maximum of a range may be larger than the largest stored value, but never
+// smaller, and the minimum is always exact.
+struct DepthBuffer {
+    float* depth; // Blocks in row-major order, pixels within a block as well
+    float* block_min;
+    float* block_max;
+    float* tile_min;
+    float* tile_max;
+    uint32_t width;
+    uint32_t height;
+    uint32_t blocks_x;
+    uint32_t blocks_y;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+};
+
+DepthBuffer createDepthBuffer(uint32_t width, uint32_t height);
+
+void destroyDepthBuffer(DepthBuffer& depth_buffer);
+
+// Number of bytes placeDepthBuffer() needs for a depth buffer of the given size
+size_t depthBufferBytes(uint32_t width, uint32_t height);
+
+// Same as createDepthBuffer() with the arrays placed in memory owned by the
+// caller, which must be aligned to 4 bytes and at least depthBufferBytes()
+// long. The result must not be passed to destroyDepthBuffer().
+DepthBuffer placeDepthBuffer(void* memory, uint32_t width, uint32_t height);
+
+// Sets every pixel to the given depth, usually the far plane
+void clearDepthBuffer(DepthBuffer& depth_buffer, float depth);
+
+// Same as clearDepthBuffer() for the pixels of tile (tile_x, tile_y) only
+void clearDepthBufferTile(DepthBuffer& depth_buffer, uint32_t tile_x, uint32_t tile_y, float depth);
+
+// Recomputes the depth range of a block from its pixels. Must be called after
+// the pixels of the block have been written before the range is used again.
+void refreshDepthBlock(DepthBuffer& depth_buffer, uint32_t block_x, uint32_t block_y);
+
+// Recomputes the depth range of a tile from the ranges of its blocks
+void refreshDepthTile(DepthBuffer& depth_buffer, uint32_t tile_x, uint32_t tile_y);
+
+// Position of the depth value of pixel (x, y) in DepthBuffer::depth
+inline uint32_t depthBufferIndex(const DepthBuffer& depth_buffer, uint32_t x, uint32_t y) {
+    uint32_t block = (y / DEPTH_BLOCK_SIZE) * depth_buffer.blocks_x + x / DEPTH_BLOCK_SIZE;
+    return block * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE + (y % DEPTH_BLOCK_SIZE) * DEPTH_BLOCK_SIZE +
+           x % DEPTH_BLOCK_SIZE;
+}
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef CASCADE_DETAIL_COLOR_H_
+#define CASCADE_DETAIL_COLOR_H_
+
+#include <cstdint>
+
+// Color packing shared by the fragment operations and the stages of
+// pipeline.h
+
+namespace cascade::detail {
+
+// Quantization truncates and maps NaN to 0, which is what the vectorized
+// kernels compute with min(max(color, 0), 1) * 255
+inline static uint8_t quantizeColor(float color) {
+    if (!(color > 0.0f)) {
+        return 0;
+    }
+    if (color > 1.0f) {
+        return 255;
+    }
+    return static_cast<uint8_t>(color * 255.0f);
+}
+
+// The memory layout that is used for the colors is BGRA
+// Since we assume a little-endian machine this means that b must be the
+// least significant byte
+inline static uint32_t packColor(float frag_r, float frag_g, float frag_b, float frag_a) {
+    uint8_t r = quantizeColor(frag_r);
+    uint8_t g = quantizeColor(frag_g);
+    uint8_t b = quantizeColor(frag_b);
+    uint8_t a = quantizeColor(frag_a);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+} // namespace cascade::detail
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef CASCADE_DETAIL_PRIMITIVE_ASSEMBLY_H_
+#define CASCADE_DETAIL_PRIMITIVE_ASSEMBLY_H_
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+namespace cascade::detail {
+
+// Walks the triangles of an index buffer in order. Every index is read once:
+// strips and fans keep the indices that the next triangle shares with the
+// previous one instead of reading them again.
+struct PrimitiveAssembler {
+    const void* indices;
+    IndexType index_type;
+    PrimitiveTopology topology;
+    bool primitive_restart;
+    uint32_t next;     // Position of the next index to read
+    uint32_t end;      // Position after the last index of the last triangle
+    uint32_t length;   // Indices of the current strip or fan read so far
+    uint32_t first;    // With strips the index read before the previous one, with fans the first one
+    uint32_t previous; // Index read last
+};
+
+inline static uint32_t readIndex(const void* indices, IndexType index_type, uint32_t position) {
+    if (index_type == IndexType::UInt16) {
+        return static_cast<const uint16_t*>(indices)[position];
+    }
+    return static_cast<const uint32_t*>(indices)[position];
+}
+
+inline static bool isRestartIndex(IndexType index_type, uint32_t index) {
+    return index == (index_type == IndexType::UInt16 ? RESTART_INDEX_16 : RESTART_INDEX);
+}
+
+// Takes the index at the next position into the strip or fan without forming
+// a triangle. Returns false if it is a restart index.
+inline static bool takeIndex(PrimitiveAssembler& assembler, uint32_t index) {
+    ++assembler.next;
+    if (assembler.primitive_restart && isRestartIndex(assembler.index_type, index)) {
+        assembler.length = 0;
+        return false;
+    }
+    if (assembler.topology == PrimitiveTopology::TriangleStrip || assembler.length == 0) {
+        assembler.first = assembler.previous;
+    }
+    if (assembler.topology == PrimitiveTopology::TriangleFan && assembler.length == 0) {
+        assembler.first = index;
+    }
+    assembler.previous = index;
+    ++assembler.length;
+    return true;
+}
+
+// Assembles the triangles with numbers [first_triangle, last_triangle), which
+// must not be larger than primitiveCount()
+inline static PrimitiveAssembler makePrimitiveAssembler(const void* indices, IndexType index_type,
+                                                        PrimitiveTopology topology, bool primitive_restart,
+                                                        uint32_t first_triangle, uint32_t last_triangle) {
+    PrimitiveAssembler assembler = {indices, index_type, topology, primitive_restart, 0, 0, 0, 0, 0};
+    if (topology == PrimitiveTopology::TriangleList) {
+        assembler.next = 3 * first_triangle;
+        assembler.end = 3 * last_triangle;
+        return assembler;
+    }
+    if (last_triangle <= first_triangle) {
+        return assembler;
+    }
+    assembler.end = last_triangle + 2;
+
+    // Triangle first_triangle ends at position first_triangle + 2. The strip
+    // or fan it belongs to starts after the last restart index before that.
+    uint32_t start = 0;
+    if (primitive_restart) {
+        start = first_triangle + 2;
+        while (start > 0 && !isRestartIndex(index_type, readIndex(indices, index_type, start - 1))) {
+            --start;
+        }
+    }
+    // Resuming it only takes the two indices before the triangle and the
+    // first index of a fan
+    const uint32_t resume = first_triangle > start ? first_triangle : start;
+    assembler.next = resume;
+    assembler.length = resume - start;
+    if (topology == PrimitiveTopology::TriangleFan && resume > start) {
+        assembler.first = readIndex(indices, index_type, start);
+    }
+    while (assembler.next < first_triangle + 2) {
+        takeIndex(assembler, readIndex(indices, index_type, assembler.next));
+    }
+    return assembler;
+}
+
+inline static PrimitiveAssembler makePrimitiveAssembler(const RasterizerInput& input) {
+    return makePrimitiveAssembler(input.indices, input.index_type, input.topology, input.primitive_restart, 0,
+                                  primitiveCount(input.topology, input.index_count));
+}
+
+// Finds the next triangle and writes its indices in winding order to v and its
+// number to triangle. Returns false once there are no triangles left.
+inline static bool nextTriangle(PrimitiveAssembler& assembler, uint32_t* v, uint32_t& triangle) {
+    if (assembler.topology == PrimitiveTopology::TriangleList) {
+        if (assembler.next + 3 > assembler.end) {
+            return false;
+        }
+        v[0] = readIndex(assembler.indices, assembler.index_type, assembler.next);
+        v[1] = readIndex(assembler.indices, assembler.index_type, assembler.next + 1);
+        v[2] = readIndex(assembler.indices, assembler.index_type, assembler.next + 2);
+        triangle = assembler.next / 3;
+        assembler.next += 3;
+        return true;
+    }
+
+    while (assembler.next < assembler.end) {
+        const uint32_t position = assembler.next;
+        const uint32_t first = assembler.first;
+        const uint32_t previous = assembler.previous;
+        if (!takeIndex(assembler, readIndex(assembler.indices, assembler.index_type, position)) ||
+            assembler.length < 3) {
+            continue;
+        }
+        // Every second triangle of a strip runs the other way around
+        const bool swap = assembler.topology == PrimitiveTopology::TriangleStrip && assembler.length % 2 == 0;
+        v[0] = swap ? previous : first;
+        v[1] = swap ? first : previous;
+        v[2] = assembler.previous;
+        triangle = position - 2;
+        return true;
+    }
+    return false;
+}
+
+} // namespace cascade::detail
+
+#endif
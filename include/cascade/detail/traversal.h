@@ -0,0 +1,319 @@
+#ifndef CASCADE_DETAIL_TRAVERSAL_H_
+#define CASCADE_DETAIL_TRAVERSAL_H_
+
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+#include <cascade/detail/triangle_setup.h>
+#include <cascade/statistics.h>
+
+namespace cascade::detail {
+
+inline static int min2(int a, int b) {
+    return a < b ? a : b;
+}
+
+inline static int max2(int a, int b) {
+    return a > b ? a : b;
+}
+
+// Run of pixels x0..x1 on row y. e holds the edge function values at the
+// center of pixel (x0, y).
+struct Span {
+    int32_t e[3];
+    int x0;
+    int x1;
+    int y;
+    bool covered;      // All pixels are known to be inside, so the test is skipped
+    bool depth_passes; // All pixels are known to pass the depth test, so only the depth is written
+};
+
+// The traversal below finds the pixels a triangle covers and hands them to an
+// emitter in runs, which decides what becomes of them. The library's emitter
+// writes fragments into the fragment buffer and the one of pipeline.h shades
+// them right away. An emitter provides
+//
+//   bool quads()                  Runs cover rows y and y + 1 and are aligned
+//                                 to whole 2x2 quads, see FragmentLayout::Quads
+//   DepthBuffer* depthBuffer()    Optional. Its depth ranges are used to skip
+//                                 hidden blocks and are refreshed after writes.
+//   uint32_t depthWrites()        Changes whenever a depth value is stored
+//   void emit(const TriangleSetup& tri, const Span& span, const PixelRect& clip)
+//                                 Handles the covered pixels of the span that
+//                                 also lie within clip. With a depth buffer it
+//                                 performs the early depth test, and all of its
+//                                 pixels pass if span.depth_passes is set.
+
+enum class BlockCoverage : uint8_t {
+    Outside,
+    Inside,
+    Partial,
+};
+
+// Classifies a rectangle of pixels whose top left and bottom left pixels have
+// edge function values e_top and e_bottom. The edge functions are linear, so
+// the rectangle is outside of an edge if all four corners are and inside of it
+// if all four corners are. With multisampling the corners are tested at the
+// samples closest to the edge and farthest from it.
+inline static BlockCoverage classifyRect(const TriangleSetup& tri, const int32_t* e_top, const int32_t* e_bottom,
+                                         int32_t width) {
+    bool inside = true;
+    for (int edge = 0; edge < 3; ++edge) {
+        int32_t right_offset = (width - 1) * tri.step_x[edge];
+        int32_t corners[4] = {e_top[edge], e_top[edge] + right_offset, e_bottom[edge],
+                              e_bottom[edge] + right_offset};
+        int32_t near = tri.sample_min[edge];
+        int32_t far = tri.sample_max[edge];
+        int corners_touched = (corners[0] + near <= 0) + (corners[1] + near <= 0) + (corners[2] + near <= 0) +
+                              (corners[3] + near <= 0);
+        if (corners_touched == 0) {
+            return BlockCoverage::Outside;
+        }
+        inside = inside && corners[0] + far <= 0 && corners[1] + far <= 0 && corners[2] + far <= 0 &&
+                 corners[3] + far <= 0;
+    }
+    return inside ? BlockCoverage::Inside : BlockCoverage::Partial;
+}
+
+// Number of blocks of the block grid that overlap the given pixel rectangle
+inline static uint64_t countBlocks(int min_x, int min_y, int max_x, int max_y) {
+    return static_cast<uint64_t>(floorDiv(max_x, BLOCK_SIZE) - floorDiv(min_x, BLOCK_SIZE) + 1) *
+           static_cast<uint64_t>(floorDiv(max_y, BLOCK_SIZE) - floorDiv(min_y, BLOCK_SIZE) + 1);
+}
+
+// Moves edge function values from one pixel to another one in the same row
+inline static void stepEdgeValues(const TriangleSetup& tri, const int32_t* e, int32_t dx, int32_t* result) {
+    result[0] = e[0] + dx * tri.step_x[0];
+    result[1] = e[1] + dx * tri.step_x[1];
+    result[2] = e[2] + dx * tri.step_x[2];
+}
+
+// Traverses the part of a tile crossed by an edge block by block. Rows span
+// span_x..span_end and tile_y..tile_y_end. Also used for tiles inside the
+// triangle whose depth range has to be tested block by block.
+template <typename Emitter>
+inline static void traversePartialTile(const TriangleSetup& tri, Emitter& emitter, const PixelRect& clip, int span_x,
+                                       int span_end, int tile_y, int tile_y_end, TraversalStats& stats) {
+    constexpr int BLOCKS_PER_TILE = TILE_SIZE / BLOCK_SIZE;
+    DepthBuffer* depth_buffer = emitter.depthBuffer();
+
+    for (int block_y = tile_y; block_y <= tile_y_end;) {
+        int block_y_end = min2(tile_y_end, (floorDiv(block_y, BLOCK_SIZE) + 1) * BLOCK_SIZE - 1);
+        int rows = block_y_end - block_y + 1;
+
+        // Edge function values at the first pixel of the span for every row
+        // of the block row. The inner rows are only needed if some block
+        // turns out not to be outside the triangle.
+        int32_t e_span[BLOCK_SIZE][3];
+        edgeValuesAt(tri, span_x, block_y, e_span[0]);
+        edgeValuesAt(tri, span_x, block_y_end, e_span[rows - 1]);
+
+        // Classify the blocks of the block row
+        BlockCoverage coverage[BLOCKS_PER_TILE];
+        bool depth_passes[BLOCKS_PER_TILE];
+        int block_x_ends[BLOCKS_PER_TILE];
+        int block_count = 0;
+        bool any_visible = false;
+        for (int block_x = span_x; block_x <= span_end; ++block_count) {
+            int block_x_end = min2(span_end, (floorDiv(block_x, BLOCK_SIZE) + 1) * BLOCK_SIZE - 1);
+            int32_t e_top[3];
+            int32_t e_bottom[3];
+            stepEdgeValues(tri, e_span[0], block_x - span_x, e_top);
+            stepEdgeValues(tri, e_span[rows - 1], block_x - span_x, e_bottom);
+            coverage[block_count] = classifyRect(tri, e_top, e_bottom, block_x_end - block_x + 1);
+            depth_passes[block_count] = false;
+            block_x_ends[block_count] = block_x_end;
+
+            uint64_t pixels = static_cast<uint64_t>(block_x_end - block_x + 1) * rows;
+
+            // The triangle is behind every pixel of the block or in front of
+            // every pixel of it. The viewport lies within the depth buffer, so
+            // the coordinates are not negative.
+            if (depth_buffer != nullptr && coverage[block_count] != BlockCoverage::Outside) {
+                uint32_t block = static_cast<uint32_t>(block_y / BLOCK_SIZE) * depth_buffer->blocks_x +
+                                 static_cast<uint32_t>(block_x / BLOCK_SIZE);
+                if (tri.min_z >= depth_buffer->block_max[block]) {
+                    coverage[block_count] = BlockCoverage::Outside;
+                    addStatistic(stats.blocks_occluded, 1);
+                    addStatistic(stats.pixels_occluded, pixels);
+                    block_x = block_x_end + 1;
+                    continue;
+                }
+                depth_passes[block_count] = tri.max_z < depth_buffer->block_min[block];
+            }
+
+            switch (coverage[block_count]) {
+                case BlockCoverage::Outside:
+                    addStatistic(stats.blocks_rejected, 1);
+                    addStatistic(stats.pixels_rejected, pixels);
+                    break;
+                case BlockCoverage::Inside:
+                    addStatistic(stats.blocks_accepted, 1);
+                    addStatistic(stats.pixels_accepted, pixels);
+                    any_visible = true;
+                    break;
+                case BlockCoverage::Partial:
+                    addStatistic(stats.blocks_partial, 1);
+                    addStatistic(stats.pixels_tested, pixels);
+                    any_visible = true;
+                    break;
+            }
+
+            block_x = block_x_end + 1;
+        }
+
+        if (any_visible) {
+            const uint32_t depth_writes = emitter.depthWrites();
+
+            for (int row = 1; row < rows - 1; ++row) {
+                edgeValuesAt(tri, span_x, block_y + row, e_span[row]);
+            }
+
+            // Hand the rows over to the emitter, merging neighbouring blocks
+            // with the same coverage into a single span. Quads take two rows
+            // at a time.
+            for (int row = 0; row < rows; row += emitter.quads() ? 2 : 1) {
+                int block = 0;
+                int block_x = span_x;
+                while (block < block_count) {
+                    if (coverage[block] == BlockCoverage::Outside) {
+                        block_x = block_x_ends[block++] + 1;
+                        continue;
+                    }
+
+                    BlockCoverage run_coverage = coverage[block];
+                    bool run_depth_passes = depth_passes[block];
+                    int run_x = block_x;
+                    while (block < block_count && coverage[block] == run_coverage &&
+                           depth_passes[block] == run_depth_passes) {
+                        block_x = block_x_ends[block++] + 1;
+                    }
+
+                    Span span = {
+                        {}, run_x, block_x - 1, block_y + row, run_coverage == BlockCoverage::Inside, run_depth_passes};
+                    stepEdgeValues(tri, e_span[row], run_x - span_x, span.e);
+                    emitter.emit(tri, span, clip);
+                }
+            }
+
+            // The depth ranges of the blocks must be up to date before the
+            // next triangle is traversed
+            if (emitter.depthWrites() != depth_writes) {
+                for (int block_x = span_x; block_x <= span_end; block_x += BLOCK_SIZE - block_x % BLOCK_SIZE) {
+                    refreshDepthBlock(*depth_buffer, block_x / BLOCK_SIZE, block_y / BLOCK_SIZE);
+                }
+            }
+        }
+
+        block_y = block_y_end + 1;
+    }
+}
+
+// The traversal is hierarchical. The part of each tile covered by the bounding
+// box is classified first and only tiles crossed by an edge are divided into
+// blocks. Blocks that are crossed by an edge are then tested pixel by pixel.
+//
+// With a depth buffer the depth range of the triangle is compared with the
+// depth range of each tile and block as well. Parts of the triangle that are
+// hidden are skipped and parts that are in front of everything drawn so far
+// skip the per-pixel depth comparison.
+template <typename Emitter>
+inline static void traverseTriangle(const TriangleSetup& tri, const PixelRect& rect, Emitter& emitter,
+                                    TraversalStats& stats) {
+    DepthBuffer* depth_buffer = emitter.depthBuffer();
+    const PixelRect clip = {max2(tri.bounds.min_x, rect.min_x), max2(tri.bounds.min_y, rect.min_y),
+                            min2(tri.bounds.max_x, rect.max_x), min2(tri.bounds.max_y, rect.max_y)};
+    int min_x = clip.min_x;
+    int min_y = clip.min_y;
+    int max_x = clip.max_x;
+    int max_y = clip.max_y;
+
+    // Quads are aligned to even coordinates, so the traversal is extended to
+    // whole quads. Tiles and blocks are aligned to even coordinates as well,
+    // so this never crosses into another tile.
+    if (emitter.quads()) {
+        min_x &= ~1;
+        min_y &= ~1;
+        max_x |= 1;
+        max_y |= 1;
+    }
+
+    for (int tile_y = min_y; tile_y <= max_y;) {
+        int tile_y_end = min2(max_y, (floorDiv(tile_y, TILE_SIZE) + 1) * TILE_SIZE - 1);
+
+        for (int span_x = min_x; span_x <= max_x;) {
+            // The span ends at the tile boundary or the end of the row,
+            // whichever comes first
+            int span_end = min2(max_x, (floorDiv(span_x, TILE_SIZE) + 1) * TILE_SIZE - 1);
+
+            uint64_t pixels = static_cast<uint64_t>(span_end - span_x + 1) * (tile_y_end - tile_y + 1);
+            uint32_t tile = 0;
+            bool depth_passes = false;
+            if (depth_buffer != nullptr) {
+                tile = static_cast<uint32_t>(tile_y / TILE_SIZE) * depth_buffer->tiles_x +
+                       static_cast<uint32_t>(span_x / TILE_SIZE);
+                if (tri.min_z >= depth_buffer->tile_max[tile]) {
+                    addStatistic(stats.blocks_occluded, countBlocks(span_x, tile_y, span_end, tile_y_end));
+                    addStatistic(stats.pixels_occluded, pixels);
+                    span_x = span_end + 1;
+                    continue;
+                }
+                depth_passes = tri.max_z < depth_buffer->tile_min[tile];
+            }
+            const uint32_t depth_writes = emitter.depthWrites();
+
+            int32_t e_top[3];
+            int32_t e_bottom[3];
+            edgeValuesAt(tri, span_x, tile_y, e_top);
+            edgeValuesAt(tri, span_x, tile_y_end, e_bottom);
+
+            BlockCoverage tile_coverage = classifyRect(tri, e_top, e_bottom, span_end - span_x + 1);
+
+            // Parts of the tile may still be hidden, which only the blocks
+            // can tell
+            if (tile_coverage == BlockCoverage::Inside && depth_buffer != nullptr && !depth_passes) {
+                tile_coverage = BlockCoverage::Partial;
+            }
+
+            switch (tile_coverage) {
+                case BlockCoverage::Outside:
+                    addStatistic(stats.blocks_rejected, countBlocks(span_x, tile_y, span_end, tile_y_end));
+                    addStatistic(stats.pixels_rejected, pixels);
+                    break;
+                case BlockCoverage::Inside:
+                    addStatistic(stats.blocks_accepted, countBlocks(span_x, tile_y, span_end, tile_y_end));
+                    addStatistic(stats.pixels_accepted, pixels);
+                    for (int j = tile_y; j <= tile_y_end; j += emitter.quads() ? 2 : 1) {
+                        Span span = {{}, span_x, span_end, j, true, depth_passes};
+                        edgeValuesAt(tri, span_x, j, span.e);
+                        emitter.emit(tri, span, clip);
+                    }
+                    if (depth_buffer != nullptr && emitter.depthWrites() != depth_writes) {
+                        for (int block_y = tile_y; block_y <= tile_y_end;
+                             block_y += BLOCK_SIZE - block_y % BLOCK_SIZE) {
+                            for (int block_x = span_x; block_x <= span_end;
+                                 block_x += BLOCK_SIZE - block_x % BLOCK_SIZE) {
+                                refreshDepthBlock(*depth_buffer, block_x / BLOCK_SIZE, block_y / BLOCK_SIZE);
+                            }
+                        }
+                    }
+                    break;
+                case BlockCoverage::Partial:
+                    traversePartialTile(tri, emitter, clip, span_x, span_end, tile_y, tile_y_end, stats);
+                    break;
+            }
+
+            if (depth_buffer != nullptr && emitter.depthWrites() != depth_writes) {
+                refreshDepthTile(*depth_buffer, span_x / TILE_SIZE, tile_y / TILE_SIZE);
+            }
+
+            span_x = span_end + 1;
+        }
+
+        tile_y = tile_y_end + 1;
+    }
+}
+
+} // namespace cascade::detail
+
+#endif
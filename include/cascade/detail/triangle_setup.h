@@ -0,0 +1,194 @@
+#ifndef CASCADE_DETAIL_TRIANGLE_SETUP_H_
+#define CASCADE_DETAIL_TRIANGLE_SETUP_H_
+
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+#include <cascade/multisample.h>
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+// Parts of the rasterizer shared by the library and the template pipeline
+// of pipeline.h. Nothing here is meant to be used directly.
+
+namespace cascade::detail {
+
+constexpr uint32_t VERTEX_COORD_SIZE = 4 * sizeof(float); // (x, y, z, w)
+
+// Screen-space tiles are aligned to multiples of TILE_SIZE starting at the
+// origin
+constexpr int TILE_SIZE = 64;
+
+// Tiles are further divided into blocks that are classified as a whole
+// against the edges of the triangle
+constexpr int BLOCK_SIZE = 8;
+
+// The depth buffer keeps depth ranges for the same blocks and tiles
+static_assert(DEPTH_TILE_SIZE == TILE_SIZE && DEPTH_BLOCK_SIZE == BLOCK_SIZE);
+
+// The rasterizer is compiled separately for the attribute counts of common
+// vertex formats, so that the loops over the attributes have a constant trip
+// count. DYNAMIC_ATTRIBUTES stands for the generic version that reads the count
+// at runtime and handles every other vertex format.
+constexpr uint32_t DYNAMIC_ATTRIBUTES = UINT32_MAX;
+
+// Number of attributes seen by the code specialized for NumAttributes
+template <uint32_t NumAttributes>
+inline static uint32_t attributeCount(uint32_t num_attributes) {
+    return NumAttributes == DYNAMIC_ATTRIBUTES ? num_attributes : NumAttributes;
+}
+
+// Inclusive rectangle of pixels
+struct PixelRect {
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+// Everything that is needed to traverse a triangle and interpolate its
+// attributes. Computed once per triangle and shared by all tiles that the
+// triangle touches.
+//
+// The edge function of edge k at the center of pixel (x, y) is
+// e_origin[k] + x * step_x[k] + y * step_y[k]. It is exact and already
+// includes the fill rule bias, so a pixel is covered if and only if all three
+// values are <= 0. Because the arithmetic is exact the values don't depend on
+// the order in which pixels are visited.
+struct TriangleSetup {
+    int32_t e_origin[3]; // Value at pixel (0, 0)
+    int32_t step_x[3];
+    int32_t step_y[3];
+    // The integer values are offset from the exact edge function scaled down
+    // to the same units by these amounts, which barycentric coordinates have
+    // to correct for
+    float bary_offset[3];
+    float inv_area2;
+    float inv_w[3];
+    float z_over_w[3];
+    // Range of the vertex depths. Interpolated depth is clamped to it, so it
+    // bounds the depth of every fragment of the triangle.
+    float min_z;
+    float max_z;
+    const float* A_over_w; // 3 * num_attributes values
+    PixelRect bounds;      // Bounding box clipped to the viewport
+    uint32_t triangle;     // Written to visibility fragments, set by the caller of setupTriangle()
+    // With multisampling the edge function of edge k at sample s of a pixel is
+    // its value at the center plus sample_offset[s][k], which is just as exact
+    bool multisample;
+    int32_t sample_offset[MSAA_SAMPLE_COUNT][3];
+    // Smallest and largest of the offsets of each edge, 0 without
+    // multisampling. Rectangles are classified with the corner values moved
+    // by these, so that they cover all samples rather than the centers.
+    int32_t sample_min[3];
+    int32_t sample_max[3];
+};
+
+inline static int floorDiv(int a, int b) {
+    int q = a / b;
+    return q - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// Edge function values at the center of pixel (x, y)
+inline static void edgeValuesAt(const TriangleSetup& tri, int x, int y, int32_t* e) {
+    for (int edge = 0; edge < 3; ++edge) {
+        e[edge] = static_cast<int32_t>(static_cast<int64_t>(tri.e_origin[edge]) +
+                                       static_cast<int64_t>(x) * tri.step_x[edge] +
+                                       static_cast<int64_t>(y) * tri.step_y[edge]);
+    }
+}
+
+// Interpolated depth can stray slightly outside of the range of the vertex
+// depths due to rounding. Clamping it keeps the depth range of the triangle
+// exact, which the depth tests of whole blocks rely on. The comparisons match
+// the semantics of the SIMD min and max instructions.
+inline static float clampDepth(const TriangleSetup& tri, float z) {
+    z = z > tri.min_z ? z : tri.min_z;
+    return z < tri.max_z ? z : tri.max_z;
+}
+
+// Perspective-correct depth at the pixel whose edge function values are e.
+// Computed exactly like in interpolateFragment().
+inline static float interpolateDepth(const TriangleSetup& tri, const int32_t* e) {
+    float lambda0 = (static_cast<float>(e[1]) - tri.bary_offset[1]) * tri.inv_area2;
+    float lambda1 = (static_cast<float>(e[2]) - tri.bary_offset[2]) * tri.inv_area2;
+    float lambda2 = (static_cast<float>(e[0]) - tri.bary_offset[0]) * tri.inv_area2;
+
+    float one_over_w_interp = lambda0 * tri.inv_w[0] + lambda1 * tri.inv_w[1] + lambda2 * tri.inv_w[2];
+    float inv_one_over_w_interp = 1.0f / one_over_w_interp;
+
+    float z_over_w_interp = lambda0 * tri.z_over_w[0] + lambda1 * tri.z_over_w[1] + lambda2 * tri.z_over_w[2];
+    return clampDepth(tri, z_over_w_interp * inv_one_over_w_interp);
+}
+
+// Computes the perspective-correct depth and attributes of the pixel whose
+// edge function values are e. Attribute k is written to
+// attribs[k * attrib_stride].
+template <uint32_t NumAttributes>
+inline static void interpolateFragment(const TriangleSetup& tri, uint32_t num_attributes, const int32_t* e, float* z,
+                                       float* attribs, uint32_t attrib_stride) {
+    const float* A_over_w = tri.A_over_w;
+    const uint32_t attribute_count = attributeCount<NumAttributes>(num_attributes);
+
+    // Compute screen-space barycentric coordinates for the center of the
+    // fragment
+    float lambda0 = (static_cast<float>(e[1]) - tri.bary_offset[1]) * tri.inv_area2; // Coordinate for v0 computed
+                                                                                     // based on the edge v1 -> v2
+    float lambda1 = (static_cast<float>(e[2]) - tri.bary_offset[2]) * tri.inv_area2; // Coordinate for v1 computed
+                                                                                     // based on the edge v2 -> v0
+    float lambda2 = (static_cast<float>(e[0]) - tri.bary_offset[0]) * tri.inv_area2; // Coordinate for v2 computed
+                                                                                     // based on the edge v0 -> v1
+
+    // Precompute 1/w interpolation in screen-space for
+    // perspective-correct interpolation
+    float one_over_w_interp = lambda0 * tri.inv_w[0] + lambda1 * tri.inv_w[1] + lambda2 * tri.inv_w[2];
+    float inv_one_over_w_interp = 1.0f / one_over_w_interp;
+
+    // Compute and write perspective-correct depth
+    float z_over_w_interp = lambda0 * tri.z_over_w[0] + lambda1 * tri.z_over_w[1] + lambda2 * tri.z_over_w[2];
+    *z = clampDepth(tri, z_over_w_interp * inv_one_over_w_interp);
+
+    // Compute and write perspective-correct value for the rest of the
+    // attributes
+    for (uint32_t attrib = 0; attrib < attribute_count; ++attrib) {
+        float A_over_w_interp =
+            lambda0 * A_over_w[3 * attrib] + lambda1 * A_over_w[3 * attrib + 1] + lambda2 * A_over_w[3 * attrib + 2];
+        attribs[attrib * attrib_stride] = A_over_w_interp * inv_one_over_w_interp;
+    }
+}
+
+// Part of the setup that only depends on a single vertex
+struct SetupVertex {
+    uint32_t index;
+    bool in_guard_band;
+    Vec2<int32_t> position; // Snapped to the sub-pixel grid, only set within the guard band
+    float z;
+    float inv_w;
+    float z_over_w;
+    const float* attributes;
+};
+
+// Vertices of the last triangle set up with the window. The next triangle
+// takes the ones it shares with it over instead of reading them from the
+// vertex data again, which saves two of the three reads for every triangle of
+// a strip or fan and for neighboring triangles of a list. Starts out empty.
+struct VertexWindow {
+    SetupVertex vertices[3];
+    uint32_t count;
+};
+
+// Prepares the triangle formed by the given indices for traversal. A_over_w
+// must have space for 3 * num_attributes values and is referenced by the
+// resulting setup. Returns false if the triangle does not need to be
+// traversed, counting the reason in stats.
+//
+// The library instantiates it for 0, 2, 4 and 8 attributes and for
+// DYNAMIC_ATTRIBUTES, whose version is the only one that reads num_attributes.
+template <uint32_t NumAttributes>
+bool setupTriangle(const RasterizerInput& input, uint32_t v0_ind, uint32_t v1_ind, uint32_t v2_ind,
+                   VertexWindow& window, uint32_t num_attributes, float* A_over_w, TriangleSetup& tri,
+                   PipelineStatistics& stats);
+
+} // namespace cascade::detail
+
+#endif
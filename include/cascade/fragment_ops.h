@@ -3,16 +3,109 @@
 
 #include <cstdint>
 
+#include <cascade/color_buffer.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/multisample.h>
+#include <cascade/statistics.h>
+#include <cascade/texture.h>
+
 namespace cascade {
 
+// How the blending operations combine the color of a fragment with the color
+// in the color buffer. Channels are fractions of 255 and results saturate at
+// 255. The alpha of the result is alpha + destination alpha * (1 - alpha),
+// except with Additive where the two are simply added.
+enum class BlendMode : uint32_t {
+    Over,          // color * alpha + destination * (1 - alpha)
+    Additive,      // color * alpha + destination
+    Premultiplied, // color + destination * (1 - alpha), for colors already multiplied by alpha
+};
+
 struct OutputContext {
     void* color_buffer;
     uint32_t fragment_stride;
     uint32_t width;
+    DepthBuffer* depth_buffer = nullptr; // Required by processFragmentsWithDepth()
+    // Optional. Accumulated into if set and the library is built with
+    // pipeline statistics. It is updated atomically, so the context can be
+    // shared by the workers of rasterizeTiled().
+    PipelineStatistics* statistics = nullptr;
+    // With ColorLayout::Blocked color_buffer and width are the pixels and the
+    // width of a ColorBuffer
+    ColorLayout color_layout = ColorLayout::Linear;
+    BlendMode blend_mode = BlendMode::Over; // Used by the blending operations
 };
 
 void processFragmentsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
 
+// Writes the color of the fragments that pass the depth test against the
+// depth buffer of the context and updates it. Fragments pass if they are not
+// farther than the stored depth, so the ones that have already passed the
+// early depth test of the rasterizer against the same depth buffer are kept
+// unless something closer has been drawn over them since.
+void processFragmentsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Variants of the above for fragment buffers with FragmentLayout::Quads. The
+// fragment stride of the context is the size of a quad record.
+void processFragmentQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+void processFragmentQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Blends the color of the fragments into the color buffer of the context with
+// its blend mode, in the order in which they were emitted. If the context has
+// a depth buffer the fragments are tested against it without updating it, so
+// that blended surfaces don't hide anything drawn behind them afterwards.
+// Fragments that are fully opaque or fully transparent skip reading the color
+// buffer.
+void processBlendedFragments(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Variant of the above for fragment buffers with FragmentLayout::Quads
+void processBlendedFragmentQuads(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Output of the textured fragment operations, which write the color sampled
+// from the texture at the interpolated texture coordinates of each fragment.
+// Coordinates of [0, 1] cover the texture once.
+struct TexturedOutputContext {
+    void* color_buffer;
+    uint32_t fragment_stride; // Size of a quad record
+    uint32_t width;
+    const Texture* texture;
+    uint32_t texcoord_attribute; // Attribute holding u, followed by v
+    TextureFilter filter = TextureFilter::Trilinear;
+    TextureAddressMode address_mode = TextureAddressMode::Repeat;
+    DepthBuffer* depth_buffer = nullptr;            // Required by processTexturedQuadsWithDepth()
+    PipelineStatistics* statistics = nullptr;       // Same as OutputContext::statistics
+    ColorLayout color_layout = ColorLayout::Linear; // Same as OutputContext::color_layout
+};
+
+// The level of detail is computed from the differences of the texture
+// coordinates between the pixels of a quad, so these only accept fragment
+// buffers with FragmentLayout::Quads. Uncovered pixels of a quad still carry
+// extrapolated texture coordinates, so the differences are also available on
+// the edges of triangles.
+void processTexturedQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+void processTexturedQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Output of the multisample fragment operations. Each pixel is shaded once
+// with the color of the first four attributes, like the other color
+// operations, and the color is written to every covered sample of the pixel.
+struct MultisampleOutputContext {
+    MultisampleBuffer* target;
+    uint32_t fragment_stride;                 // Size of a quad record
+    PipelineStatistics* statistics = nullptr; // Same as OutputContext::statistics
+};
+
+// These accept the fragment buffers of a multisampled rasterization, which
+// have FragmentLayout::Quads
+void processMultisampleQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
+// Depth tests every covered sample against the depth of the multisample buffer
+// with the same rule as processFragmentsWithDepth(). The depth of a sample is
+// extrapolated from the depth at the pixel center with the differences of
+// depth between the pixels of the quad.
+void processMultisampleQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context);
+
 } // namespace cascade
 
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef CASCADE_IMAGE_EXPORT_H_
+#define CASCADE_IMAGE_EXPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace cascade {
+
+// Byte order of exported pixels
+enum class PixelFormat : uint32_t {
+    RGB,  // Three bytes per pixel, alpha is dropped
+    RGBA, // Four bytes per pixel
+};
+
+// Converts count BGRA pixels of a linear color buffer to bytes in the given
+// format
+void convertPixels(const uint32_t* src, PixelFormat format, void* dst, uint32_t count);
+
+enum class ImageFormat : uint32_t {
+    PPM,     // Binary portable pixmap (P6) with RGB pixels
+    PAM,     // Portable arbitrary map (P7) with RGBA pixels
+    RawRGB,  // RGB pixels without a header
+    RawRGBA, // RGBA pixels without a header
+};
+
+// Writes width x height BGRA pixels of a linear color buffer, with rows
+// pitch_bytes apart, to a new file at path. The pixels are converted straight
+// into a memory mapping of the file where the platform supports it and into a
+// single buffer that is written at once otherwise. Returns false if the file
+// could not be created or written.
+bool writeImage(const char* path, ImageFormat format, const void* pixels, uint32_t width, uint32_t height,
+                uint32_t pitch_bytes);
+
+enum class VideoFormat : uint32_t {
+    // YUV4MPEG2 with 4:4:4 frames in limited range BT.601 YCbCr, which ffmpeg
+    // and most players read directly
+    Y4M,
+    RawRGB,  // RGB frames one after another without headers
+    RawRGBA, // RGBA frames one after another without headers
+};
+
+// Appends frames of the same size to a single video file, which stays open
+// between them. Each frame is converted into a buffer owned by the writer and
+// written with one call.
+struct VideoWriter {
+    std::FILE* file; // nullptr if the file could not be created
+    uint8_t* frame;  // Conversion buffer holding a whole frame with its header
+    size_t frame_bytes;
+    uint32_t width;
+    uint32_t height;
+    VideoFormat format;
+    uint32_t frame_count;
+};
+
+// frame_rate is only recorded by formats with a header
+VideoWriter openVideoWriter(const char* path, VideoFormat format, uint32_t width, uint32_t height, uint32_t frame_rate);
+
+// Appends width x height BGRA pixels of a linear color buffer, with rows
+// pitch_bytes apart. Returns false if the frame could not be written.
+bool writeVideoFrame(VideoWriter& writer, const void* pixels, uint32_t pitch_bytes);
+
+// Returns false if buffered frames could not be written
+bool closeVideoWriter(VideoWriter& writer);
+
+} // namespace cascade
+
+#endif
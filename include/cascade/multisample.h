@@ -0,0 +1,54 @@
+#ifndef CASCADE_MULTISAMPLE_H_
+#define CASCADE_MULTISAMPLE_H_
+
+#include <cstdint>
+
+namespace cascade {
+
+// Number of coverage samples per pixel with multisampling
+constexpr uint32_t MSAA_SAMPLE_COUNT = 4;
+
+// Positions of the samples relative to the pixel center in 1/16 of a pixel.
+// This is the standard rotated grid pattern, which gives every sample a
+// different row and column, so near-horizontal and near-vertical edges get
+// four coverage steps per pixel.
+constexpr int32_t MSAA_SAMPLE_POSITIONS[MSAA_SAMPLE_COUNT][2] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+
+// Color and depth of every sample of pixels [0, width) x [0, height). The
+// samples of a pixel are consecutive and pixels are in row-major order.
+// Colors use the same BGRA packing as a linear color buffer.
+struct MultisampleBuffer {
+    uint32_t* color;
+    float* depth;
+    uint32_t width;
+    uint32_t height;
+};
+
+MultisampleBuffer createMultisampleBuffer(uint32_t width, uint32_t height);
+
+void destroyMultisampleBuffer(MultisampleBuffer& buffer);
+
+void clearMultisampleBuffer(MultisampleBuffer& buffer, uint32_t color, float depth);
+
+// Position of the first sample of pixel (x, y) in MultisampleBuffer::color and
+// MultisampleBuffer::depth
+inline uint32_t multisampleIndex(const MultisampleBuffer& buffer, uint32_t x, uint32_t y) {
+    return (y * buffer.width + x) * MSAA_SAMPLE_COUNT;
+}
+
+enum class ResolveFilter : uint32_t {
+    // Average of the samples of the pixel
+    Box,
+    // Samples within one pixel of the center of the pixel, weighted by their
+    // distance from it. Smoother edges than Box at the cost of slightly
+    // blurring the inside of triangles.
+    Tent,
+};
+
+// Filters the samples into a row-major image with the BGRA pixels of a linear
+// color buffer. Rows of the image are pitch_bytes apart.
+void resolveMultisampleBuffer(const MultisampleBuffer& buffer, ResolveFilter filter, void* dst, uint32_t pitch_bytes);
+
+} // namespace cascade
+
+#endif
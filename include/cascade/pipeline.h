@@ -0,0 +1,205 @@
+#ifndef CASCADE_PIPELINE_H_
+#define CASCADE_PIPELINE_H_
+
+#include <cassert>
+#include <cstdint>
+
+#include <cascade/color_buffer.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/detail/color.h>
+#include <cascade/detail/primitive_assembly.h>
+#include <cascade/detail/traversal.h>
+#include <cascade/detail/triangle_setup.h>
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+namespace cascade {
+
+// Alternative to rasterize() for fragment processing known at compile time.
+// The depth test, the shader and the output are stages passed to
+// drawTriangles() as policy types or callables, and they are compiled into the
+// traversal loop, which is inlined from this header. Every covered pixel is
+// shaded right after its attributes are interpolated, without a fragment
+// buffer or a flush callback in between. Triangle setup is not inlined: it
+// calls the instances of setupTriangle() compiled into the library, so the
+// library still has to be linked.
+//
+// The traversal and interpolation are compiled with the flags of the including
+// translation unit, so the values match the ones of rasterize() bit for bit
+// only if floating-point contraction is disabled there too, like in the
+// library.
+
+// What the shader gets for every covered pixel
+template <uint32_t NumAttributes>
+struct PipelineFragment {
+    int x;
+    int y;
+    float z;
+    float attributes[NumAttributes > 0 ? NumAttributes : 1];
+};
+
+// Depth stages. test() gets the depth of every covered pixel before it is
+// shaded and returns whether to shade it, storing the depth if so. passes is
+// set for pixels already known to be closer than what is stored. The traversal
+// uses the depth ranges of depthBuffer() to skip hidden blocks, if it has one.
+
+// Shades every covered pixel
+struct NoDepthTest {
+    DepthBuffer* depthBuffer() const {
+        return nullptr;
+    }
+
+    bool test(int, int, float, bool) {
+        return true;
+    }
+};
+
+// Same early depth test as RasterizerInput::depth_buffer. The depth buffer
+// must cover the viewport.
+struct LessDepthTest {
+    DepthBuffer* depth_buffer;
+
+    DepthBuffer* depthBuffer() const {
+        return depth_buffer;
+    }
+
+    bool test(int x, int y, float z, bool passes) {
+        float& stored = depth_buffer->depth[depthBufferIndex(*depth_buffer, x, y)];
+        if (passes || z < stored) {
+            stored = z;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Shader that turns the first four attributes into a BGRA color, like the
+// color fragment operations. Shaders are called with the PipelineFragment of
+// every pixel that passes the depth test and return what the output stage
+// takes.
+struct VertexColorShader {
+    template <uint32_t NumAttributes>
+    uint32_t operator()(const PipelineFragment<NumAttributes>& fragment) const {
+        static_assert(NumAttributes >= 4, "the color is read from the first four attributes");
+        const float* color = fragment.attributes;
+        return detail::packColor(color[0], color[1], color[2], color[3]);
+    }
+};
+
+// Output stages, called with the pixel and the result of the shader
+
+// Writes to a linear color buffer like processFragmentsWithoutDepth()
+struct LinearColorOutput {
+    uint32_t* color_buffer;
+    uint32_t width;
+
+    void operator()(int x, int y, uint32_t color) const {
+        color_buffer[static_cast<uint32_t>(y) * width + static_cast<uint32_t>(x)] = color;
+    }
+};
+
+// Same as LinearColorOutput for a ColorBuffer
+struct BlockedColorOutput {
+    ColorBuffer* color_buffer;
+
+    void operator()(int x, int y, uint32_t color) const {
+        color_buffer->pixels[colorBufferIndex(*color_buffer, x, y)] = color;
+    }
+};
+
+namespace detail {
+
+// Emitter of the traversal that runs the stages on the pixels of every span
+template <uint32_t NumAttributes, typename DepthTest, typename Shader, typename Output>
+struct ShadingEmitter {
+    DepthTest& depth_test;
+    Shader& shader;
+    Output& output;
+    uint32_t depth_writes;
+
+    bool quads() const {
+        return false;
+    }
+
+    DepthBuffer* depthBuffer() const {
+        return depth_test.depthBuffer();
+    }
+
+    uint32_t depthWrites() const {
+        return depth_writes;
+    }
+
+    void emit(const TriangleSetup& tri, const Span& span, const PixelRect&) {
+        DepthBuffer* depth_buffer = depthBuffer();
+        int32_t e[3] = {span.e[0], span.e[1], span.e[2]};
+
+        for (int x = span.x0; x <= span.x1; ++x) {
+            // The attributes are only interpolated for pixels that pass the
+            // depth test
+            if ((span.covered || (e[0] <= 0 && e[1] <= 0 && e[2] <= 0)) &&
+                (depth_buffer == nullptr ||
+                 depth_test.test(x, span.y, interpolateDepth(tri, e), span.depth_passes))) {
+                depth_writes += depth_buffer != nullptr;
+
+                PipelineFragment<NumAttributes> fragment;
+                fragment.x = x;
+                fragment.y = span.y;
+                interpolateFragment<NumAttributes>(tri, NumAttributes, e, &fragment.z, fragment.attributes, 1);
+                output(x, span.y, shader(fragment));
+            }
+
+            e[0] += tri.step_x[0];
+            e[1] += tri.step_x[1];
+            e[2] += tri.step_x[2];
+        }
+    }
+};
+
+// Attribute count of the setupTriangle() instantiation used for NumAttributes
+template <uint32_t NumAttributes>
+constexpr uint32_t SETUP_ATTRIBUTES =
+    NumAttributes == 0 || NumAttributes == 2 || NumAttributes == 4 || NumAttributes == 8 ? NumAttributes
+                                                                                         : DYNAMIC_ATTRIBUTES;
+
+} // namespace detail
+
+// Rasterizes the triangles of input like rasterize() and runs the stages on
+// every covered pixel in the same order in which rasterize() emits the
+// fragments. The vertices must have exactly NumAttributes attributes.
+// input.depth_buffer is ignored in favor of the depth stage and multisampling
+// is not supported. Only the triangle and traversal counters of the statistics
+// are updated.
+template <uint32_t NumAttributes, typename DepthTest, typename Shader, typename Output>
+void drawTriangles(const RasterizerInput& input, DepthTest depth_test, Shader shader, Output output) {
+    assert(input.stride_bytes == detail::VERTEX_COORD_SIZE + NumAttributes * sizeof(float));
+    assert(!input.multisample);
+    assert(viewportInGuardBand(input.bounds));
+    assert(depth_test.depthBuffer() == nullptr ||
+           (input.bounds.top_left.x >= 0 && input.bounds.top_left.y >= 0 &&
+            input.bounds.bottom_right.x < static_cast<int64_t>(depth_test.depthBuffer()->width) &&
+            input.bounds.bottom_right.y < static_cast<int64_t>(depth_test.depthBuffer()->height)));
+
+    PipelineStatistics unused_stats = {};
+    PipelineStatistics& stats = input.statistics != nullptr ? *input.statistics : unused_stats;
+
+    detail::ShadingEmitter<NumAttributes, DepthTest, Shader, Output> emitter = {depth_test, shader, output, 0};
+    detail::PrimitiveAssembler assembler = detail::makePrimitiveAssembler(input);
+    detail::VertexWindow window = {};
+    detail::TriangleSetup tri;
+    // Padded by one element since arrays cannot be empty
+    float A_over_w[3 * NumAttributes + 1];
+    uint32_t v[3];
+    uint32_t triangle;
+    while (detail::nextTriangle(assembler, v, triangle)) {
+        addStatistic(stats.triangles_input, 1);
+        if (detail::setupTriangle<detail::SETUP_ATTRIBUTES<NumAttributes>>(input, v[0], v[1], v[2], window,
+                                                                           NumAttributes, A_over_w, tri, stats)) {
+            tri.triangle = triangle;
+            detail::traverseTriangle(tri, tri.bounds, emitter, stats.traversal);
+        }
+    }
+}
+
+} // namespace cascade
+
+#endif
@@ -4,31 +4,193 @@
 #include <cstdint>
 
 #include <cascade/common/vec2.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/multisample.h>
+#include <cascade/statistics.h>
 
 namespace cascade {
 
+struct TileHistory;
+
+// Number of fractional bits of the fixed-point screen-space positions, set
+// when the library is built
+#ifndef CASCADE_SUBPIXEL_BITS
+#define CASCADE_SUBPIXEL_BITS 4
+#endif
+
+// Edge functions are evaluated in 32-bit fixed point, which limits the
+// screen-space coordinates the rasterizer can represent to
+// [-GUARD_BAND, GUARD_BAND), [-4096, 4096) with the default 4 sub-pixel bits.
+// The viewport must lie within this range. Triangles with a vertex outside of
+// it are culled and counted in PipelineStatistics::triangles_outside_guard_band,
+// so positions that may leave it must be clipped first, as transformVertices()
+// does.
+constexpr int32_t GUARD_BAND = 1 << (31 - 3 - CASCADE_SUBPIXEL_BITS) / 2;
+
+// Pixels from top_left to bottom_right, both inclusive
 struct ViewportBounds {
     Vec2<int32_t> top_left;
     Vec2<int32_t> bottom_right;
 };
 
+inline bool viewportInGuardBand(const ViewportBounds& bounds) {
+    return bounds.top_left.x >= -GUARD_BAND && bounds.top_left.y >= -GUARD_BAND &&
+           bounds.bottom_right.x < GUARD_BAND && bounds.bottom_right.y < GUARD_BAND;
+}
+
+// Size of the elements of an index buffer
+enum class IndexType : uint32_t {
+    UInt32,
+    UInt16,
+};
+
+// How the indices of an index buffer form triangles. Triangles keep the
+// winding of the order of their indices, which strips and fans carry over
+// from their first triangle.
+//
+// Every triangle has a number that is below primitiveCount() and increases in
+// the order in which the triangles are drawn. For lists it is the position of
+// the first index of the triangle divided by 3 and otherwise the position of
+// its last index minus 2, which leaves the numbers next to restart indices
+// without a triangle.
+enum class PrimitiveTopology : uint32_t {
+    // Every three indices form a triangle
+    TriangleList,
+    // Every index after the first two forms a triangle with the two before
+    // it. The first two vertices of every second triangle are swapped, so
+    // that all triangles keep the winding of the first one.
+    TriangleStrip,
+    // Every index after the first two forms a triangle with the index before
+    // it and the first index of the fan
+    TriangleFan,
+};
+
+// With primitive restart an index with all bits set, 0xFFFF for 16-bit
+// indices, ends the current strip or fan and the next one starts right after
+// it. It has no effect on triangle lists.
+constexpr uint32_t RESTART_INDEX = UINT32_MAX;
+constexpr uint16_t RESTART_INDEX_16 = UINT16_MAX;
+
+// Number that the numbers of all triangles formed by index_count indices are
+// below
+inline uint32_t primitiveCount(PrimitiveTopology topology, uint32_t index_count) {
+    if (topology == PrimitiveTopology::TriangleList) {
+        return index_count / 3;
+    }
+    return index_count >= 2 ? index_count - 2 : 0;
+}
+
+inline uint32_t indexSize(IndexType index_type) {
+    return index_type == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 struct RasterizerInput {
     const float* vertex_data;
-    const uint32_t* indices;
+    const void* indices; // Elements of index_type
     uint32_t index_count;
     uint32_t stride_bytes;
-    ViewportBounds bounds;
+    ViewportBounds bounds; // Must lie within the guard band, see GUARD_BAND
+    // Optional. Accumulated into if set and the library is built with
+    // pipeline statistics.
+    PipelineStatistics* statistics = nullptr;
+    // Optional. If set, fragments are depth tested against it before their
+    // attributes are interpolated and only the ones closer than the stored
+    // depth are emitted, updating it. It must cover the viewport.
+    DepthBuffer* depth_buffer = nullptr;
+    // Tests coverage at the MSAA_SAMPLE_COUNT sample positions of every pixel
+    // instead of its center. A pixel is emitted once if any of its samples is
+    // covered, with its attributes still interpolated at the center, and the
+    // fragment carries the covered samples in FragmentQuadHeader::samples, so
+    // it needs FragmentLayout::Quads. The early depth test keeps a single depth
+    // per pixel, so depth_buffer must not be set. The multisample fragment
+    // operations test the depth of every sample instead.
+    bool multisample = false;
+    // Optional. Only used by rasterizeTiled(), which then skips the tiles that
+    // would be drawn the same as in the previous frame. See tile_history.h.
+    TileHistory* tile_history = nullptr;
+    IndexType index_type = IndexType::UInt32;
+    PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+    bool primitive_restart = false; // See RESTART_INDEX
 };
 
+// How fragments are laid out in the fragment buffer
+enum class FragmentLayout : uint32_t {
+    // Fragments one after another, each made of uint32_t x, uint32_t y,
+    // float z and the attributes
+    Packed,
+    // 2x2 pixel quads aligned to even coordinates. Each record is made of a
+    // FragmentQuadHeader followed by the depth of the four pixels and then the
+    // four values of every attribute, so every value of the record starts a
+    // 16-byte aligned group of four lanes. Pixel k of the quad is
+    // (x + k % 2, y + k / 2). Pixels that are not covered still get values
+    // extrapolated from the triangle, which can be used for derivatives but
+    // are not necessarily finite. The buffer must be 16-byte aligned.
+    Quads,
+    // VisibilityFragment records that only name the triangle covering the
+    // pixel, without depth or attributes. With a depth buffer only the
+    // fragments that pass the early depth test are emitted, so the last
+    // fragment of every pixel is the visible one. The viewport must not
+    // extend to negative coordinates. See visibility_buffer.h.
+    Visibility,
+};
+
+struct FragmentQuadHeader {
+    uint32_t x;
+    uint32_t y;
+    uint32_t mask;    // Bit k is set if pixel k of the quad is covered
+    uint32_t samples; // With multisampling bit 4 * k + s is set if sample s of pixel k is covered, otherwise 0
+};
+
+struct VisibilityFragment {
+    uint16_t x;
+    uint16_t y;
+    uint32_t triangle; // Number of the triangle, see PrimitiveTopology
+};
+
+// Size of a quad record in bytes
+inline uint32_t fragmentQuadSize(uint32_t num_attributes) {
+    return sizeof(FragmentQuadHeader) + (num_attributes + 1) * 4 * sizeof(float);
+}
+
 struct FragmentBufferInfo {
     void* buffer;
-    uint32_t size_bytes;
+    uint32_t size_bytes; // Must fit at least one fragment, or one quad record with FragmentLayout::Quads
     void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
     void* context;
+    FragmentLayout layout = FragmentLayout::Packed;
+    // Number of fragment buffers of size_bytes each that follow one another
+    // starting at buffer. With two or more the flush callback runs on a
+    // separate thread while the rasterizer fills the next buffer, so the two
+    // stages overlap. The callback still sees the buffers one at a time and in
+    // the same order as with a single buffer, but it must not touch anything
+    // the rasterizer uses, such as the depth buffer of the input. Early depth
+    // testing in the rasterizer alone already gives the right result, so
+    // processFragmentsWithoutDepth() can be used instead of
+    // processFragmentsWithDepth().
+    uint32_t buffer_count = 1;
 };
 
 void rasterize(const RasterizerInput& input, const FragmentBufferInfo& fbi);
 
+// Sort-middle variant of rasterize() that distributes the work over
+// worker_count threads. Triangles are first binned into screen-space tiles and
+// the tiles are then rasterized in parallel. Each worker writes into its own
+// fragment buffer described by worker_buffers[worker], so the flush callbacks
+// may be invoked concurrently, but never for the same pixel. The fragments of
+// every pixel are emitted in the same order as with rasterize().
+void rasterizeTiled(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers, uint32_t worker_count);
+
+// Variants of rasterize() and rasterizeTiled() for vertex formats with exactly
+// NumAttributes attributes, which must match input.stride_bytes. They are
+// available for 0, 2, 4 and 8 attributes, which the plain functions dispatch
+// to on their own, and are compiled with the loops over the attributes fully
+// unrolled. Other vertex formats are handled by generic code.
+template <uint32_t NumAttributes>
+void rasterize(const RasterizerInput& input, const FragmentBufferInfo& fbi);
+
+template <uint32_t NumAttributes>
+void rasterizeTiled(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers, uint32_t worker_count);
+
 } // namespace cascade
 
 #endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef CASCADE_RENDER_CONTEXT_H_
+#define CASCADE_RENDER_CONTEXT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+#include <cascade/detail/triangle_setup.h>
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+namespace cascade {
+
+struct RenderContextInfo {
+    uint32_t width;
+    uint32_t height;
+    uint32_t max_attributes;                   // Largest attribute count of the vertex formats drawn with the context
+    uint32_t fragment_buffer_size = 64 * 1024; // Must fit a quad record with max_attributes attributes
+    uint32_t fragment_buffer_count = 1;        // See FragmentBufferInfo::buffer_count
+};
+
+// Everything a sequence of draws needs besides the vertices: the render
+// targets, the fragment buffers and the scratch space of triangle setup. All
+// of it is carved out of a single arena allocated when the context is created,
+// so drawing with the context doesn't allocate and the fragment buffers are
+// shared by all the draws of a command buffer.
+struct RenderContext {
+    void* arena;
+    uint32_t* color_buffer; // Linear BGRA pixels, row-major
+    DepthBuffer depth_buffer;
+    void* fragment_buffers; // 64-byte aligned, one after another
+    uint32_t fragment_buffer_size;
+    uint32_t fragment_buffer_count;
+    detail::TriangleSetup* setups; // Scratch space for one batch of triangles
+    float* A_over_w;
+    uint32_t width;
+    uint32_t height;
+    uint32_t max_attributes;
+};
+
+RenderContext createRenderContext(const RenderContextInfo& info);
+
+void destroyRenderContext(RenderContext& render_context);
+
+// Sets every pixel of the color buffer to color and of the depth buffer to
+// depth
+void clearRenderContext(RenderContext& render_context, uint32_t color, float depth);
+
+// One draw of a command buffer. Indices [first_index, first_index +
+// index_count) of indices are drawn over the whole render context. Consecutive
+// draws with the same flush callback, context and fragment size share fragment
+// buffers, so the callback may see the fragments of several draws at once, in
+// the order in which they were recorded. With FragmentLayout::Visibility the
+// triangles of every draw are numbered from 0, starting at first_index.
+struct DrawCommand {
+    const float* vertex_data;
+    const void* indices; // Elements of index_type
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t stride_bytes;
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
+    void* context;
+    FragmentLayout layout = FragmentLayout::Packed;
+    // Early depth test against the depth buffer of the render context, like
+    // RasterizerInput::depth_buffer
+    bool depth_test = false;
+    IndexType index_type = IndexType::UInt32;
+    PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+    bool primitive_restart = false;
+};
+
+// Draws recorded once and executed together, so the fragment buffers, the
+// flush thread and the setup scratch space are set up once for all of them
+// instead of once per rasterize() call
+struct CommandBuffer {
+    DrawCommand* draws;
+    uint32_t draw_count;
+    uint32_t draw_capacity;
+};
+
+CommandBuffer createCommandBuffer(uint32_t draw_capacity);
+
+void destroyCommandBuffer(CommandBuffer& command_buffer);
+
+// Forgets the recorded draws and keeps the memory for the next ones
+void resetCommandBuffer(CommandBuffer& command_buffer);
+
+// Appends a draw, growing the buffer if needed. Nothing the draw points to is
+// read before the command buffer is executed.
+void recordDraw(CommandBuffer& command_buffer, const DrawCommand& draw);
+
+// Rasterizes the recorded draws in order into the fragment buffers of the
+// render context, flushing them only when they are full or the output of the
+// draws changes. The vertex formats must have at most max_attributes
+// attributes. With more than one fragment buffer the same restrictions as for
+// FragmentBufferInfo::buffer_count apply to every callback.
+void executeCommandBuffer(const CommandBuffer& command_buffer, RenderContext& render_context,
+                          PipelineStatistics* statistics = nullptr);
+
+} // namespace cascade
+
+#endif
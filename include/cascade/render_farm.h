@@ -0,0 +1,81 @@
+#ifndef CASCADE_RENDER_FARM_H_
+#define CASCADE_RENDER_FARM_H_
+
+#include <cstdint>
+
+#include <cascade/detail/triangle_setup.h>
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+namespace cascade {
+
+struct RenderFarmInfo {
+    uint32_t worker_count;                     // Including the thread calling renderFrames()
+    uint32_t max_attributes;                   // Largest attribute count of the vertex formats of the frames
+    uint32_t fragment_buffer_size = 64 * 1024; // Must fit a quad record with max_attributes attributes
+};
+
+// Everything a worker needs to render a frame besides the frame itself
+struct RenderFarmWorker {
+    void* fragment_buffer; // 64-byte aligned
+    detail::TriangleSetup* setups; // Scratch space for one batch of triangles
+    float* A_over_w;
+};
+
+// Threads of the workers and the state of the batch they work on, see
+// render_farm.cpp
+struct RenderFarmState;
+
+// Renders batches of independent frames, one frame per thread at a time. This
+// pays off for many small frames, which have too little work to be split into
+// tiles like rasterizeTiled() does. The buffers of every worker are carved out
+// of a single arena allocated when the farm is created and reused from frame
+// to frame, so rendering doesn't allocate. The threads of the workers are
+// started with the farm as well and wait for the next batch in between, so a
+// batch doesn't start any threads either.
+struct RenderFarm {
+    void* arena;
+    RenderFarmWorker* workers;
+    RenderFarmState* state;
+    uint32_t worker_count;
+    uint32_t max_attributes;
+    uint32_t fragment_buffer_size;
+};
+
+RenderFarm createRenderFarm(const RenderFarmInfo& info);
+
+// Stops the threads of the workers. No batch may be in progress.
+void destroyRenderFarm(RenderFarm& render_farm);
+
+// A frame of a batch. input is rasterized into the fragment buffer of the
+// worker that picks the frame up, which is flushed with flush and context,
+// typically one of the fragment operations with the OutputContext of the
+// target of the frame.
+struct FrameJob {
+    RasterizerInput input;
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
+    void* context;
+    FragmentLayout layout = FragmentLayout::Packed;
+    // Optional. Called with context on the worker right before the frame is
+    // rasterized, for example to clear its target
+    void (*begin)(void* context) = nullptr;
+};
+
+// Renders the frames on the workers of the farm and returns once all of them
+// are done. Each worker starts with an equal share of consecutive frames and
+// steals half of the remaining frames of another worker when it runs out, so
+// frames of uneven cost still keep every worker busy. The calling thread acts
+// as the first worker and only one batch can be rendered on a farm at a time.
+//
+// Every frame is rendered by a single worker exactly as rasterize() would with
+// one fragment buffer of the size of the farm, so the result is the same as
+// rendering the frames one after another. Frames run concurrently, so frames
+// must not share targets, depth buffers or anything else their callbacks
+// write to. The statistics of the inputs are ignored in favor of statistics,
+// which is accumulated into once for the whole batch.
+void renderFrames(RenderFarm& render_farm, const FrameJob* jobs, uint32_t job_count,
+                  PipelineStatistics* statistics = nullptr);
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CASCADE_STATISTICS_H_
+#define CASCADE_STATISTICS_H_
+
+#include <cstdint>
+#include <type_traits>
+
+namespace cascade {
+
+// Statistics are only collected if the library is built with the
+// CASCADE_PIPELINE_STATISTICS option. Otherwise the code that updates the
+// counters is compiled out and the structures below are never written to.
+#if defined(CASCADE_PIPELINE_STATISTICS)
+constexpr bool PIPELINE_STATISTICS_ENABLED = true;
+#else
+constexpr bool PIPELINE_STATISTICS_ENABLED = false;
+#endif
+
+// Counters describing how much work the hierarchical traversal saved. Each
+// triangle's bounding box is divided into 8x8 pixel blocks that are classified
+// using the edge functions at their corners and the depth range of the
+// triangle before any pixel is tested.
+struct TraversalStats {
+    uint64_t blocks_rejected; // Blocks outside the triangle, skipped entirely
+    uint64_t blocks_accepted; // Blocks inside the triangle, emitted without edge tests
+    uint64_t blocks_partial;  // Blocks crossed by an edge, tested pixel by pixel
+    uint64_t blocks_occluded; // Blocks behind the contents of the depth buffer, skipped entirely
+    uint64_t pixels_rejected;
+    uint64_t pixels_accepted;
+    uint64_t pixels_tested;
+    uint64_t pixels_occluded;
+};
+
+// Work done by the stages of the pipeline, similar to the pipeline statistics
+// queries of GPU APIs. The rasterizer and the fragment operations add to the
+// counters of the structure they are given, so it has to be zeroed before the
+// first use.
+//
+// Times are in nanoseconds of wall-clock time per thread, so the times of the
+// workers of rasterizeTiled() add up.
+struct PipelineStatistics {
+    // Triangle setup
+    uint64_t triangles_input;
+    uint64_t vertices_fetched;             // Read from the vertex data, the rest are shared with the previous triangle
+    uint64_t triangles_outside_guard_band; // Culled because a vertex can't be represented in fixed point
+    uint64_t triangles_backfacing;         // Culled because they face away from the viewer
+    uint64_t triangles_degenerate;         // Culled because their area is zero after snapping
+    uint64_t triangles_empty;              // Culled because they don't cover any pixel center within the viewport
+    uint64_t triangles_rasterized;
+    uint64_t setup_ns;
+
+    // Traversal
+    TraversalStats traversal;
+    uint64_t fragments_emitted;
+    uint64_t traversal_ns; // Not including the time spent in the flush callback
+
+    // Fragment buffer flushes
+    uint64_t flush_calls;
+    uint64_t flush_bytes;
+    uint64_t flush_ns; // Includes the fragment operations if they are the flush callback
+
+    // Fragment operations
+    uint64_t fragments_processed;
+    uint64_t fragments_depth_failed;
+    uint64_t fragments_written;
+    uint64_t fragment_ops_ns;
+};
+
+// Adds to one of the counters above. Does nothing unless statistics are
+// enabled, so the call and the computation of the value disappear from the hot
+// paths otherwise.
+template <typename T>
+inline void addStatistic(T& counter, std::type_identity_t<T> value) {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        counter += value;
+    }
+}
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef CASCADE_TEXTURE_H_
+#define CASCADE_TEXTURE_H_
+
+#include <cstdint>
+
+namespace cascade {
+
+// Texels are stored in tiles of TEXTURE_TILE_SIZE x TEXTURE_TILE_SIZE texels,
+// which is exactly one 64-byte cache line. The tiles of a level are in
+// row-major order and the texels within a tile in Morton (Z) order, so texels
+// that are close to each other in any direction are close in memory as well.
+// Row-major storage would touch a new cache line for every row, which is
+// expensive when the texture is sampled along a diagonal.
+constexpr uint32_t TEXTURE_TILE_SIZE = 4;
+constexpr uint32_t MAX_TEXTURE_LEVELS = 16;
+
+struct TextureLevel {
+    uint32_t offset; // Position of the first texel of the level in Texture::texels
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles_x;
+};
+
+// RGBA8 texture with a full mip chain. Texels use the same packing as the
+// color buffer.
+struct Texture {
+    uint32_t* texels; // All levels, each padded to whole tiles
+    uint32_t level_count;
+    TextureLevel levels[MAX_TEXTURE_LEVELS];
+};
+
+// How texture coordinates outside of [0, 1] are handled
+enum class TextureAddressMode : uint32_t {
+    Repeat,
+    Clamp,
+};
+
+enum class TextureFilter : uint32_t {
+    Bilinear,  // Bilinear filtering within the mip level closest to the level of detail
+    Trilinear, // Bilinear filtering within the two closest mip levels, blended by the level of detail
+};
+
+// Creates a texture from width x height row-major pixels and generates its
+// mip levels down to 1x1 with a box filter. Both dimensions must be powers of
+// two no larger than 2^(MAX_TEXTURE_LEVELS - 1).
+Texture createTexture(const uint32_t* pixels, uint32_t width, uint32_t height);
+void destroyTexture(Texture& texture);
+
+// Position of texel (x, y) of the given level in Texture::texels
+inline uint32_t textureTexelIndex(const Texture& texture, uint32_t level, uint32_t x, uint32_t y) {
+    const TextureLevel& l = texture.levels[level];
+    uint32_t tile = (y / TEXTURE_TILE_SIZE) * l.tiles_x + x / TEXTURE_TILE_SIZE;
+    uint32_t morton = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+    return l.offset + tile * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + morton;
+}
+
+} // namespace cascade
+
+#endif
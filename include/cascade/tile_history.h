@@ -0,0 +1,53 @@
+#ifndef CASCADE_TILE_HISTORY_H_
+#define CASCADE_TILE_HISTORY_H_
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+namespace cascade {
+
+// Record of what rasterizeTiled() drew into the screen-space tiles of a
+// viewport in the previous frame, for scenes in which little changes from one
+// frame to the next. Every tile keeps a hash of the vertex data of the
+// triangles that touch it, in the order in which they were submitted, and of
+// their numbers with FragmentLayout::Visibility, whose fragments carry them.
+// Tiles whose hash is the same as in the previous frame are skipped, and only
+// the others are cleared and rasterized again.
+//
+// Skipped tiles keep what the previous frame left in the render targets, so
+// the targets and the fragment operations must stay the same from frame to
+// frame. Changes the hashes can't see, such as a different texture or blend
+// mode, need invalidateTileHistory().
+struct TileHistory {
+    uint64_t* hashes; // One per tile in row-major order, 0 if the tile has to be redrawn
+    ViewportBounds bounds;
+    int32_t first_tile_x;
+    int32_t first_tile_y;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    // Optional. Called before anything is drawn into a tile that is redrawn,
+    // with the pixels of the tile that lie within the viewport, to reset them
+    // in the render targets and in the depth buffer of the input if it has
+    // one. It is called by the worker that redraws the tile, so calls may run
+    // concurrently, but never for the same tile.
+    void (*clear)(const ViewportBounds& rect, void* context);
+    void* context;
+    // Regions redrawn by the last frame, made of runs of horizontally adjacent
+    // tiles limited to the viewport, in row-major order
+    ViewportBounds* dirty_rects;
+    uint32_t dirty_count;
+};
+
+// Every tile is redrawn in the first frame. The history can only be used with
+// inputs that have the same viewport.
+TileHistory createTileHistory(const ViewportBounds& bounds);
+
+void destroyTileHistory(TileHistory& history);
+
+// Redraws every tile in the next frame
+void invalidateTileHistory(TileHistory& history);
+
+} // namespace cascade
+
+#endif
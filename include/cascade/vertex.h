@@ -0,0 +1,73 @@
+#ifndef CASCADE_VERTEX_H_
+#define CASCADE_VERTEX_H_
+
+#include <cstdint>
+
+#include <cascade/common/mat4.h>
+#include <cascade/rasterizer.h>
+
+namespace cascade {
+
+struct VertexInput {
+    const float* vertex_data; // Object-space (x, y, z, w) position followed by the attributes
+    const void* indices; // Elements of index_type
+    uint32_t index_count;
+    uint32_t stride_bytes;
+    // Model-view-projection matrix taking positions to clip space, where the
+    // visible volume is -w <= x <= w, -w <= y <= w and 0 <= z <= w
+    Mat4<float> transform;
+    // Pixels that normalized device coordinates are mapped to. x = -1 maps to
+    // the left edge of the leftmost pixels and y = 1 to the top edge of the
+    // topmost ones.
+    ViewportBounds bounds;
+    IndexType index_type = IndexType::UInt32;
+    PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+    bool primitive_restart = false; // See RESTART_INDEX
+};
+
+// Post-transform vertex cache. Holds the transformed vertices of the last
+// draw, laid out the way the rasterizer expects them, and remembers which of
+// them have been transformed, so every vertex referenced by a draw is
+// transformed once no matter how many triangles share it. The cache is reused
+// from draw to draw without being cleared.
+struct VertexCache {
+    // Transformed vertices with the same stride as the input, followed by the
+    // vertices created by clipping
+    float* vertex_data;
+    uint32_t* indices;    // Triangles of the last draw that survived clipping
+    uint32_t* stamps;     // Draw during which each vertex was last transformed
+    uint32_t* pending;    // Vertices of the current draw that still need the transform
+    uint16_t* outcodes;   // Sides of the clip planes that each vertex lies on
+    float* clip_vertices; // Scratch space for clipping
+    uint32_t vertex_count;
+    uint32_t vertex_capacity; // Including the vertices created by clipping
+    uint32_t index_capacity;
+    uint32_t stride_bytes;
+    uint32_t draw;
+};
+
+// The cache holds vertices with indices [0, vertex_count) of the given stride
+VertexCache createVertexCache(uint32_t vertex_count, uint32_t stride_bytes);
+
+void destroyVertexCache(VertexCache& cache);
+
+// Transforms the vertices referenced by the indices of the input into the
+// cache and returns the rasterizer input that draws them straight from it.
+// Positions are multiplied by the transform, divided by w and mapped to the
+// viewport, while the clip-space z and w as well as the attributes are passed
+// through.
+//
+// Triangles are clipped on the way. Those that lie entirely on the invisible
+// side of one of the planes of the visible volume are dropped. The rest are
+// kept as they are unless they cross the near plane or leave the guard band,
+// the region around the viewport that the rasterizer can handle, in which
+// case they are clipped against both. Parts of triangles beyond the far
+// plane are left to the depth test. Strips and fans come out as a list of
+// 32-bit indices.
+//
+// The result is valid until the next call with the same cache.
+RasterizerInput transformVertices(const VertexInput& input, VertexCache& cache);
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef CASCADE_VISIBILITY_BUFFER_H_
+#define CASCADE_VISIBILITY_BUFFER_H_
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+namespace cascade {
+
+// Stored for pixels that no triangle covers
+constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+// Triangle visible at every pixel of [0, width) x [0, height), for deferred
+// attribute interpolation. The scene is rasterized with
+// FragmentLayout::Visibility and processVisibilityFragments() as the flush
+// callback, which emits 8 bytes per fragment instead of the depth and all the
+// attributes. resolveVisibilityBuffer() then interpolates the attributes once
+// for every covered pixel, so hidden fragments never get to cost more than
+// their coverage and depth test.
+struct VisibilityBuffer {
+    uint32_t* triangles; // Row-major, pixel (x, y) at y * width + x
+    uint32_t width;
+    uint32_t height;
+};
+
+VisibilityBuffer createVisibilityBuffer(uint32_t width, uint32_t height);
+
+void destroyVisibilityBuffer(VisibilityBuffer& visibility_buffer);
+
+// Sets every pixel to NO_TRIANGLE
+void clearVisibilityBuffer(VisibilityBuffer& visibility_buffer);
+
+// Flush callback for fragment buffers with FragmentLayout::Visibility whose
+// context is a VisibilityBuffer covering the viewport. Stores the triangle of
+// every fragment at its pixel, so the last fragment of a pixel wins.
+void processVisibilityFragments(const void* frag_buf, uint32_t used_bytes, const void* visibility_buffer);
+
+// Emits one fragment for every pixel of the viewport of input that holds a
+// triangle, with the depth and the attributes of that triangle interpolated
+// exactly like rasterize() does, in row-major order. input must describe the
+// same vertices and indices that filled the buffer and fbi must have
+// FragmentLayout::Packed. The depth buffer of the input is not used, since the
+// fragments are already known to be visible. Only the fragment and flush
+// counters of the statistics are updated.
+void resolveVisibilityBuffer(const VisibilityBuffer& visibility_buffer, const RasterizerInput& input,
+                             const FragmentBufferInfo& fbi);
+
+} // namespace cascade
+
+#endif
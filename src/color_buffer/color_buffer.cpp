@@ -0,0 +1,81 @@
+#include <cascade/color_buffer.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "color_buffer/resolve_kernels.h"
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+
+namespace cascade {
+
+ColorBuffer createColorBuffer(uint32_t width, uint32_t height) {
+    ColorBuffer color_buffer;
+    color_buffer.width = width;
+    color_buffer.height = height;
+    color_buffer.blocks_x = (width + COLOR_BLOCK_SIZE - 1) / COLOR_BLOCK_SIZE;
+    color_buffer.blocks_y = (height + COLOR_BLOCK_SIZE - 1) / COLOR_BLOCK_SIZE;
+
+    // Same as the depth buffer, blocks on the right and bottom border are
+    // allocated whole and the allocation is padded by one element
+    const size_t block_count = static_cast<size_t>(color_buffer.blocks_x) * color_buffer.blocks_y;
+    color_buffer.pixels =
+        static_cast<uint32_t*>(std::malloc((block_count * COLOR_BLOCK_SIZE * COLOR_BLOCK_SIZE + 1) * sizeof(uint32_t)));
+    assert(color_buffer.pixels != nullptr);
+
+    return color_buffer;
+}
+
+void destroyColorBuffer(ColorBuffer& color_buffer) {
+    std::free(color_buffer.pixels);
+    color_buffer = {};
+}
+
+void clearColorBuffer(ColorBuffer& color_buffer, uint32_t color) {
+    const size_t pixel_count =
+        static_cast<size_t>(color_buffer.blocks_x) * color_buffer.blocks_y * COLOR_BLOCK_SIZE * COLOR_BLOCK_SIZE;
+    for (size_t i = 0; i < pixel_count; ++i) {
+        color_buffer.pixels[i] = color;
+    }
+}
+
+void resolveColorBuffer(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes) {
+    // Rows of a block are copied whole, which the compiler does with vector
+    // moves. Only the blocks on the right border may be cut short.
+    for (uint32_t y = 0; y < color_buffer.height; ++y) {
+        uint32_t* row_ptr = uint32_ptr(char_ptr(dst) + static_cast<size_t>(y) * pitch_bytes);
+        for (uint32_t x = 0; x < color_buffer.width; x += COLOR_BLOCK_SIZE) {
+            uint32_t count = color_buffer.width - x < COLOR_BLOCK_SIZE ? color_buffer.width - x : COLOR_BLOCK_SIZE;
+            std::memcpy(row_ptr + x, color_buffer.pixels + colorBufferIndex(color_buffer, x, y),
+                        count * sizeof(uint32_t));
+        }
+    }
+}
+
+static void resolveColorBufferRGBScalar(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes) {
+    resolveBlockRowsRGB(color_buffer, dst, pitch_bytes,
+                        [](const uint32_t* src, uint8_t* dst) { convertPixelsRGB(src, dst, COLOR_BLOCK_SIZE); });
+}
+
+static ResolveKernel selectResolveKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return resolveColorBufferRGBAVX2;
+        case SimdLevel::SSE41:
+            return resolveColorBufferRGBSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return resolveColorBufferRGBScalar;
+}
+
+void resolveColorBufferRGB(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes) {
+    static const ResolveKernel resolve_kernel = selectResolveKernel();
+    resolve_kernel(color_buffer, dst, pitch_bytes);
+}
+
+} // namespace cascade
@@ -0,0 +1,140 @@
+#include <cascade/multisample.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "color_buffer/resolve_kernels.h"
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+
+namespace cascade {
+
+MultisampleBuffer createMultisampleBuffer(uint32_t width, uint32_t height) {
+    MultisampleBuffer buffer;
+    buffer.width = width;
+    buffer.height = height;
+
+    // Same as the other buffers, the allocations are padded by one element
+    const size_t sample_count = static_cast<size_t>(width) * height * MSAA_SAMPLE_COUNT;
+    buffer.color = static_cast<uint32_t*>(std::malloc((sample_count + 1) * sizeof(uint32_t)));
+    assert(buffer.color != nullptr);
+    buffer.depth = static_cast<float*>(std::malloc((sample_count + 1) * sizeof(float)));
+    assert(buffer.depth != nullptr);
+
+    return buffer;
+}
+
+void destroyMultisampleBuffer(MultisampleBuffer& buffer) {
+    std::free(buffer.color);
+    std::free(buffer.depth);
+    buffer = {};
+}
+
+void clearMultisampleBuffer(MultisampleBuffer& buffer, uint32_t color, float depth) {
+    const size_t sample_count = static_cast<size_t>(buffer.width) * buffer.height * MSAA_SAMPLE_COUNT;
+    for (size_t i = 0; i < sample_count; ++i) {
+        buffer.color[i] = color;
+        buffer.depth[i] = depth;
+    }
+}
+
+// Sample of a pixel next to the resolved one that the tent filter reads
+struct TentTap {
+    int32_t dx; // Offset of the pixel from the resolved one
+    int32_t dy;
+    uint32_t sample;
+    uint32_t weight;
+};
+
+struct TentTaps {
+    TentTap taps[9 * MSAA_SAMPLE_COUNT];
+    uint32_t count;
+    uint32_t total_weight;
+};
+
+// The tent has a radius of one pixel along both axes, so only the samples of
+// the 3x3 pixels around the resolved one can have a non-zero weight. Weights
+// are products of the distances from the edge of the tent in 1/16 of a pixel,
+// which keeps the filter in integer arithmetic.
+static constexpr TentTaps makeTentTaps() {
+    TentTaps result = {};
+    for (int32_t dy = -1; dy <= 1; ++dy) {
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                int32_t x = 16 * dx + MSAA_SAMPLE_POSITIONS[s][0];
+                int32_t y = 16 * dy + MSAA_SAMPLE_POSITIONS[s][1];
+                int32_t weight_x = 16 - (x < 0 ? -x : x);
+                int32_t weight_y = 16 - (y < 0 ? -y : y);
+                if (weight_x > 0 && weight_y > 0) {
+                    uint32_t weight = static_cast<uint32_t>(weight_x * weight_y);
+                    result.taps[result.count++] = {dx, dy, s, weight};
+                    result.total_weight += weight;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+static constexpr TentTaps TENT_TAPS = makeTentTaps();
+
+// Pixels on the border of the buffer reuse their own samples in place of the
+// missing neighbors
+static void resolveTent(const MultisampleBuffer& buffer, void* dst, uint32_t pitch_bytes) {
+    const int32_t max_x = static_cast<int32_t>(buffer.width) - 1;
+    const int32_t max_y = static_cast<int32_t>(buffer.height) - 1;
+    for (int32_t y = 0; y <= max_y; ++y) {
+        uint32_t* row_ptr = uint32_ptr(char_ptr(dst) + static_cast<size_t>(y) * pitch_bytes);
+        for (int32_t x = 0; x <= max_x; ++x) {
+            uint32_t sums[4] = {};
+            for (uint32_t t = 0; t < TENT_TAPS.count; ++t) {
+                const TentTap& tap = TENT_TAPS.taps[t];
+                int32_t tap_x = x + tap.dx;
+                int32_t tap_y = y + tap.dy;
+                tap_x = tap_x < 0 ? 0 : (tap_x > max_x ? max_x : tap_x);
+                tap_y = tap_y < 0 ? 0 : (tap_y > max_y ? max_y : tap_y);
+                uint32_t sample = buffer.color[multisampleIndex(buffer, tap_x, tap_y) + tap.sample];
+                for (uint32_t c = 0; c < 4; ++c) {
+                    sums[c] += ((sample >> (8 * c)) & 0xFF) * tap.weight;
+                }
+            }
+
+            uint32_t pixel = 0;
+            for (uint32_t c = 0; c < 4; ++c) {
+                pixel |= ((sums[c] + TENT_TAPS.total_weight / 2) / TENT_TAPS.total_weight) << (8 * c);
+            }
+            row_ptr[x] = pixel;
+        }
+    }
+}
+
+static SampleResolveKernel selectSampleResolveKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return averageSamplesAVX2;
+        case SimdLevel::SSE41:
+            return averageSamplesSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return averageSamples;
+}
+
+void resolveMultisampleBuffer(const MultisampleBuffer& buffer, ResolveFilter filter, void* dst, uint32_t pitch_bytes) {
+    if (filter == ResolveFilter::Tent) {
+        resolveTent(buffer, dst, pitch_bytes);
+        return;
+    }
+
+    static const SampleResolveKernel resolve_kernel = selectSampleResolveKernel();
+    for (uint32_t y = 0; y < buffer.height; ++y) {
+        uint32_t* row_ptr = uint32_ptr(char_ptr(dst) + static_cast<size_t>(y) * pitch_bytes);
+        resolve_kernel(buffer.color + multisampleIndex(buffer, 0, y), row_ptr, buffer.width);
+    }
+}
+
+} // namespace cascade
@@ -0,0 +1,72 @@
+#include "color_buffer/resolve_kernels.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace cascade {
+
+// The shuffle works within each half of the vector, so the 12 RGB bytes of
+// each half are joined by a permute afterwards. The 24 bytes of a row of a
+// block are then stored as 16 and 8 bytes.
+static void convertBlockRowRGB(const uint32_t* src, uint8_t* dst) {
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+                                           10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m256i shuffled = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), order);
+    __m256i packed = _mm256_permutevar8x32_epi32(shuffled, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), _mm256_extracti128_si256(packed, 1));
+}
+
+void resolveColorBufferRGBAVX2(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes) {
+    resolveBlockRowsRGB(color_buffer, dst, pitch_bytes, convertBlockRowRGB);
+}
+
+// Groups of eight pixels are converted like the row of a block
+void convertPixelsRGBAVX2(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; count - i >= COLOR_BLOCK_SIZE; i += COLOR_BLOCK_SIZE) {
+        convertBlockRowRGB(src + i, dst + 3 * i);
+    }
+    convertPixelsRGB(src + i, dst + 3 * i, count - i);
+}
+
+void convertPixelsRGBAAVX2(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4,
+                                           7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t i = 0;
+    for (; count - i >= 8; i += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i), _mm256_shuffle_epi8(pixels, order));
+    }
+    convertPixelsRGBA(src + i, dst + 4 * i, count - i);
+}
+
+// Same as the SSE4.1 version with a pixel in each half of the vector. The sums
+// of the channels end up in the low four lanes of each half.
+inline static __m256i sumSamples(const uint32_t* samples) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples));
+    __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi8(pixels, zero), _mm256_unpackhi_epi8(pixels, zero));
+    return _mm256_add_epi16(sum, _mm256_srli_si256(sum, 8));
+}
+
+// The unpacks and the pack work within each half of the vector, so the halves
+// hold the even and the odd pixels until the final permute puts them in order
+void averageSamplesAVX2(const uint32_t* samples, uint32_t* dst, uint32_t count) {
+    const __m256i rounding = _mm256_set1_epi16(2);
+    uint32_t i = 0;
+    for (; count - i >= 8; i += 8) {
+        const uint32_t* pixel_samples = samples + MSAA_SAMPLE_COUNT * i;
+        __m256i low = _mm256_unpacklo_epi64(sumSamples(pixel_samples), sumSamples(pixel_samples + 8));
+        __m256i high = _mm256_unpacklo_epi64(sumSamples(pixel_samples + 16), sumSamples(pixel_samples + 24));
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, rounding), 2);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, rounding), 2);
+        __m256i packed = _mm256_packus_epi16(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+    }
+    averageSamples(samples + MSAA_SAMPLE_COUNT * i, dst + i, count - i);
+}
+
+} // namespace cascade
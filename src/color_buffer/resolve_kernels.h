@@ -0,0 +1,103 @@
+#ifndef CASCADE_RESOLVE_KERNELS_H_
+#define CASCADE_RESOLVE_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <cascade/color_buffer.h>
+#include <cascade/multisample.h>
+
+#include "detail/ptr_utils.h"
+
+namespace cascade {
+
+// Converts BGRA pixels to RGB bytes, dropping alpha
+inline static void convertPixelsRGB(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        dst[3 * i] = static_cast<uint8_t>(src[i] >> 16);
+        dst[3 * i + 1] = static_cast<uint8_t>(src[i] >> 8);
+        dst[3 * i + 2] = static_cast<uint8_t>(src[i]);
+    }
+}
+
+// Converts BGRA pixels to RGBA bytes
+inline static void convertPixelsRGBA(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        dst[4 * i] = static_cast<uint8_t>(src[i] >> 16);
+        dst[4 * i + 1] = static_cast<uint8_t>(src[i] >> 8);
+        dst[4 * i + 2] = static_cast<uint8_t>(src[i]);
+        dst[4 * i + 3] = static_cast<uint8_t>(src[i] >> 24);
+    }
+}
+
+// Walks the image a row of a block at a time. Convert handles the
+// COLOR_BLOCK_SIZE pixels of a full row and the blocks on the right border
+// that extend past the width of the buffer are converted pixel by pixel.
+template <typename Convert>
+inline static void resolveBlockRowsRGB(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes,
+                                       Convert convert) {
+    const uint32_t full_blocks = color_buffer.width / COLOR_BLOCK_SIZE;
+    const uint32_t remainder = color_buffer.width % COLOR_BLOCK_SIZE;
+    for (uint32_t y = 0; y < color_buffer.height; ++y) {
+        uint8_t* row_ptr = uint8_ptr(dst) + static_cast<size_t>(y) * pitch_bytes;
+        for (uint32_t block_x = 0; block_x < full_blocks; ++block_x) {
+            const uint32_t* src = color_buffer.pixels + colorBufferIndex(color_buffer, block_x * COLOR_BLOCK_SIZE, y);
+            convert(src, row_ptr + 3 * block_x * COLOR_BLOCK_SIZE);
+        }
+        if (remainder > 0) {
+            const uint32_t* src =
+                color_buffer.pixels + colorBufferIndex(color_buffer, full_blocks * COLOR_BLOCK_SIZE, y);
+            convertPixelsRGB(src, row_ptr + 3 * full_blocks * COLOR_BLOCK_SIZE, remainder);
+        }
+    }
+}
+
+// Averages the MSAA_SAMPLE_COUNT samples of each of count pixels. Every
+// channel is rounded to the nearest value, with halves rounded up.
+inline static void averageSamples(const uint32_t* samples, uint32_t* dst, uint32_t count) {
+    static_assert(MSAA_SAMPLE_COUNT == 4);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t* pixel_samples = samples + MSAA_SAMPLE_COUNT * i;
+        uint32_t pixel = 0;
+        for (uint32_t c = 0; c < 4; ++c) {
+            uint32_t sum = 0;
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                sum += (pixel_samples[s] >> (8 * c)) & 0xFF;
+            }
+            pixel |= ((sum + 2) / 4) << (8 * c);
+        }
+        dst[i] = pixel;
+    }
+}
+
+using ResolveKernel = void (*)(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes);
+
+// Conversion of count consecutive pixels, same as convertPixelsRGB() or
+// convertPixelsRGBA()
+using PixelConvertKernel = void (*)(const uint32_t* src, uint8_t* dst, uint32_t count);
+
+// Box filter of a row of count pixels of a multisample buffer, same as
+// averageSamples()
+using SampleResolveKernel = void (*)(const uint32_t* samples, uint32_t* dst, uint32_t count);
+
+#if defined(CASCADE_X86_SIMD)
+void resolveColorBufferRGBSSE41(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes);
+
+void resolveColorBufferRGBAVX2(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes);
+
+void convertPixelsRGBSSE41(const uint32_t* src, uint8_t* dst, uint32_t count);
+
+void convertPixelsRGBASSE41(const uint32_t* src, uint8_t* dst, uint32_t count);
+
+void convertPixelsRGBAVX2(const uint32_t* src, uint8_t* dst, uint32_t count);
+
+void convertPixelsRGBAAVX2(const uint32_t* src, uint8_t* dst, uint32_t count);
+
+void averageSamplesSSE41(const uint32_t* samples, uint32_t* dst, uint32_t count);
+
+void averageSamplesAVX2(const uint32_t* samples, uint32_t* dst, uint32_t count);
+#endif
+
+} // namespace cascade
+
+#endif
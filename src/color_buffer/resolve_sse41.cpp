@@ -0,0 +1,69 @@
+#include "color_buffer/resolve_kernels.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace cascade {
+
+// Moves the RGB bytes of four pixels to the low 12 bytes of the vector
+inline static __m128i shufflePixelsRGB(__m128i pixels) {
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    return _mm_shuffle_epi8(pixels, order);
+}
+
+// The 24 bytes of a row of a block are stored as 16 and 8 bytes
+static void convertBlockRowRGB(const uint32_t* src, uint8_t* dst) {
+    __m128i low = shufflePixelsRGB(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    __m128i high = shufflePixelsRGB(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(low, _mm_slli_si128(high, 12)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), _mm_srli_si128(high, 4));
+}
+
+void resolveColorBufferRGBSSE41(const ColorBuffer& color_buffer, void* dst, uint32_t pitch_bytes) {
+    resolveBlockRowsRGB(color_buffer, dst, pitch_bytes, convertBlockRowRGB);
+}
+
+// Groups of eight pixels are converted like the row of a block
+void convertPixelsRGBSSE41(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; count - i >= COLOR_BLOCK_SIZE; i += COLOR_BLOCK_SIZE) {
+        convertBlockRowRGB(src + i, dst + 3 * i);
+    }
+    convertPixelsRGB(src + i, dst + 3 * i, count - i);
+}
+
+void convertPixelsRGBASSE41(const uint32_t* src, uint8_t* dst, uint32_t count) {
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t i = 0;
+    for (; count - i >= 4; i += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), _mm_shuffle_epi8(pixels, order));
+    }
+    convertPixelsRGBA(src + i, dst + 4 * i, count - i);
+}
+
+// The four samples of a pixel fill the vector. Widening the two halves to 16
+// bits and adding them twice leaves the sums of the channels in the low four
+// lanes.
+inline static __m128i sumSamples(const uint32_t* samples) {
+    __m128i pixel = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+    __m128i sum = _mm_add_epi16(_mm_cvtepu8_epi16(pixel), _mm_cvtepu8_epi16(_mm_srli_si128(pixel, 8)));
+    return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+}
+
+void averageSamplesSSE41(const uint32_t* samples, uint32_t* dst, uint32_t count) {
+    const __m128i rounding = _mm_set1_epi16(2);
+    uint32_t i = 0;
+    for (; count - i >= 4; i += 4) {
+        const uint32_t* pixel_samples = samples + MSAA_SAMPLE_COUNT * i;
+        __m128i low = _mm_unpacklo_epi64(sumSamples(pixel_samples), sumSamples(pixel_samples + 4));
+        __m128i high = _mm_unpacklo_epi64(sumSamples(pixel_samples + 8), sumSamples(pixel_samples + 12));
+        low = _mm_srli_epi16(_mm_add_epi16(low, rounding), 2);
+        high = _mm_srli_epi16(_mm_add_epi16(high, rounding), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+    averageSamples(samples + MSAA_SAMPLE_COUNT * i, dst + i, count - i);
+}
+
+} // namespace cascade
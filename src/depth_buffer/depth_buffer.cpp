@@ -0,0 +1,164 @@
+#include <cascade/depth_buffer.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "depth_buffer/depth_pyramid.h"
+
+namespace cascade {
+
+inline static uint32_t min2(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+// Fills in the size of the buffer and of its grids of blocks and tiles
+static DepthBuffer makeDepthBuffer(uint32_t width, uint32_t height) {
+    DepthBuffer depth_buffer = {};
+    depth_buffer.width = width;
+    depth_buffer.height = height;
+    depth_buffer.blocks_x = (width + DEPTH_BLOCK_SIZE - 1) / DEPTH_BLOCK_SIZE;
+    depth_buffer.blocks_y = (height + DEPTH_BLOCK_SIZE - 1) / DEPTH_BLOCK_SIZE;
+    depth_buffer.tiles_x = (width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    depth_buffer.tiles_y = (height + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    return depth_buffer;
+}
+
+DepthBuffer createDepthBuffer(uint32_t width, uint32_t height) {
+    DepthBuffer depth_buffer = makeDepthBuffer(width, height);
+
+    // Blocks on the right and bottom border are allocated whole even if part
+    // of them lies outside of the buffer. Allocations are padded by one
+    // element so that empty buffers don't request zero bytes.
+    const size_t block_count = static_cast<size_t>(depth_buffer.blocks_x) * depth_buffer.blocks_y;
+    const size_t tile_count = static_cast<size_t>(depth_buffer.tiles_x) * depth_buffer.tiles_y;
+    depth_buffer.depth =
+        static_cast<float*>(std::malloc((block_count * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE + 1) * sizeof(float)));
+    depth_buffer.block_min = static_cast<float*>(std::malloc((block_count + 1) * sizeof(float)));
+    depth_buffer.block_max = static_cast<float*>(std::malloc((block_count + 1) * sizeof(float)));
+    depth_buffer.tile_min = static_cast<float*>(std::malloc((tile_count + 1) * sizeof(float)));
+    depth_buffer.tile_max = static_cast<float*>(std::malloc((tile_count + 1) * sizeof(float)));
+    assert(depth_buffer.depth != nullptr && depth_buffer.block_min != nullptr && depth_buffer.block_max != nullptr);
+    assert(depth_buffer.tile_min != nullptr && depth_buffer.tile_max != nullptr);
+
+    return depth_buffer;
+}
+
+void destroyDepthBuffer(DepthBuffer& depth_buffer) {
+    std::free(depth_buffer.depth);
+    std::free(depth_buffer.block_min);
+    std::free(depth_buffer.block_max);
+    std::free(depth_buffer.tile_min);
+    std::free(depth_buffer.tile_max);
+    depth_buffer = {};
+}
+
+size_t depthBufferBytes(uint32_t width, uint32_t height) {
+    const DepthBuffer depth_buffer = makeDepthBuffer(width, height);
+    const size_t block_count = static_cast<size_t>(depth_buffer.blocks_x) * depth_buffer.blocks_y;
+    const size_t tile_count = static_cast<size_t>(depth_buffer.tiles_x) * depth_buffer.tiles_y;
+    return (block_count * (DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE + 2) + tile_count * 2) * sizeof(float);
+}
+
+DepthBuffer placeDepthBuffer(void* memory, uint32_t width, uint32_t height) {
+    assert(reinterpret_cast<uintptr_t>(memory) % alignof(float) == 0);
+    DepthBuffer depth_buffer = makeDepthBuffer(width, height);
+
+    // Laid out in the same order as the arrays of the structure
+    const size_t block_count = static_cast<size_t>(depth_buffer.blocks_x) * depth_buffer.blocks_y;
+    const size_t tile_count = static_cast<size_t>(depth_buffer.tiles_x) * depth_buffer.tiles_y;
+    depth_buffer.depth = static_cast<float*>(memory);
+    depth_buffer.block_min = depth_buffer.depth + block_count * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE;
+    depth_buffer.block_max = depth_buffer.block_min + block_count;
+    depth_buffer.tile_min = depth_buffer.block_max + block_count;
+    depth_buffer.tile_max = depth_buffer.tile_min + tile_count;
+
+    return depth_buffer;
+}
+
+void clearDepthBuffer(DepthBuffer& depth_buffer, float depth) {
+    const size_t block_count = static_cast<size_t>(depth_buffer.blocks_x) * depth_buffer.blocks_y;
+    const size_t tile_count = static_cast<size_t>(depth_buffer.tiles_x) * depth_buffer.tiles_y;
+
+    const size_t pixel_count = block_count * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE;
+    for (size_t i = 0; i < pixel_count; ++i) {
+        depth_buffer.depth[i] = depth;
+    }
+    for (size_t i = 0; i < block_count; ++i) {
+        depth_buffer.block_min[i] = depth;
+        depth_buffer.block_max[i] = depth;
+    }
+    for (size_t i = 0; i < tile_count; ++i) {
+        depth_buffer.tile_min[i] = depth;
+        depth_buffer.tile_max[i] = depth;
+    }
+}
+
+void clearDepthBufferTile(DepthBuffer& depth_buffer, uint32_t tile_x, uint32_t tile_y, float depth) {
+    constexpr uint32_t BLOCKS_PER_TILE = DEPTH_TILE_SIZE / DEPTH_BLOCK_SIZE;
+    const uint32_t first_block_x = tile_x * BLOCKS_PER_TILE;
+    const uint32_t first_block_y = tile_y * BLOCKS_PER_TILE;
+    const uint32_t last_block_x = min2(first_block_x + BLOCKS_PER_TILE, depth_buffer.blocks_x);
+    const uint32_t last_block_y = min2(first_block_y + BLOCKS_PER_TILE, depth_buffer.blocks_y);
+
+    for (uint32_t block_y = first_block_y; block_y < last_block_y; ++block_y) {
+        for (uint32_t block_x = first_block_x; block_x < last_block_x; ++block_x) {
+            uint32_t block = block_y * depth_buffer.blocks_x + block_x;
+            float* block_depth = depth_buffer.depth + static_cast<size_t>(block) * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE;
+            for (uint32_t i = 0; i < DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE; ++i) {
+                block_depth[i] = depth;
+            }
+            depth_buffer.block_min[block] = depth;
+            depth_buffer.block_max[block] = depth;
+        }
+    }
+    const uint32_t tile = tile_y * depth_buffer.tiles_x + tile_x;
+    depth_buffer.tile_min[tile] = depth;
+    depth_buffer.tile_max[tile] = depth;
+}
+
+void refreshDepthBlock(DepthBuffer& depth_buffer, uint32_t block_x, uint32_t block_y) {
+    const uint32_t block = block_y * depth_buffer.blocks_x + block_x;
+    const float* depth = depth_buffer.depth + static_cast<size_t>(block) * DEPTH_BLOCK_SIZE * DEPTH_BLOCK_SIZE;
+
+    // Pixels of border blocks that lie outside of the buffer are never
+    // written, so they are left out of the range
+    const uint32_t columns = min2(DEPTH_BLOCK_SIZE, depth_buffer.width - block_x * DEPTH_BLOCK_SIZE);
+    const uint32_t rows = min2(DEPTH_BLOCK_SIZE, depth_buffer.height - block_y * DEPTH_BLOCK_SIZE);
+
+    float min_depth = depth[0];
+    float max_depth = depth[0];
+    for (uint32_t row = 0; row < rows; ++row) {
+        for (uint32_t column = 0; column < columns; ++column) {
+            float value = depth[row * DEPTH_BLOCK_SIZE + column];
+            min_depth = value < min_depth ? value : min_depth;
+            max_depth = value > max_depth ? value : max_depth;
+        }
+    }
+    depth_buffer.block_min[block] = min_depth;
+    depth_buffer.block_max[block] = max_depth;
+}
+
+void refreshDepthTile(DepthBuffer& depth_buffer, uint32_t tile_x, uint32_t tile_y) {
+    constexpr uint32_t BLOCKS_PER_TILE = DEPTH_TILE_SIZE / DEPTH_BLOCK_SIZE;
+    const uint32_t first_block_x = tile_x * BLOCKS_PER_TILE;
+    const uint32_t first_block_y = tile_y * BLOCKS_PER_TILE;
+    const uint32_t last_block_x = min2(first_block_x + BLOCKS_PER_TILE, depth_buffer.blocks_x);
+    const uint32_t last_block_y = min2(first_block_y + BLOCKS_PER_TILE, depth_buffer.blocks_y);
+
+    const uint32_t first_block = first_block_y * depth_buffer.blocks_x + first_block_x;
+    float min_depth = depth_buffer.block_min[first_block];
+    float max_depth = depth_buffer.block_max[first_block];
+    for (uint32_t block_y = first_block_y; block_y < last_block_y; ++block_y) {
+        for (uint32_t block_x = first_block_x; block_x < last_block_x; ++block_x) {
+            uint32_t block = block_y * depth_buffer.blocks_x + block_x;
+            min_depth = depth_buffer.block_min[block] < min_depth ? depth_buffer.block_min[block] : min_depth;
+            max_depth = depth_buffer.block_max[block] > max_depth ? depth_buffer.block_max[block] : max_depth;
+        }
+    }
+    const uint32_t tile = tile_y * depth_buffer.tiles_x + tile_x;
+    depth_buffer.tile_min[tile] = min_depth;
+    depth_buffer.tile_max[tile] = max_depth;
+}
+
+} // namespace cascade
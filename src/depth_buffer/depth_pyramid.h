@@ -0,0 +1,26 @@
+#ifndef CASCADE_DEPTH_PYRAMID_H_
+#define CASCADE_DEPTH_PYRAMID_H_
+
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+
+namespace cascade {
+
+// Keeps the minimum of the block and the tile of pixel (x, y) exact after
+// depth has been written there. The maximum is left as it is, which is
+// conservative since depth is only ever decreased.
+inline static void lowerDepthRange(DepthBuffer& depth_buffer, uint32_t x, uint32_t y, float depth) {
+    float& block_min = depth_buffer.block_min[(y / DEPTH_BLOCK_SIZE) * depth_buffer.blocks_x + x / DEPTH_BLOCK_SIZE];
+    if (depth < block_min) {
+        block_min = depth;
+    }
+    float& tile_min = depth_buffer.tile_min[(y / DEPTH_TILE_SIZE) * depth_buffer.tiles_x + x / DEPTH_TILE_SIZE];
+    if (depth < tile_min) {
+        tile_min = depth;
+    }
+}
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef CASCADE_CPU_FEATURES_H_
+#define CASCADE_CPU_FEATURES_H_
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(CASCADE_X86_SIMD) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace cascade {
+
+// Instruction set extensions that have dedicated kernels, ordered by
+// capability
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+};
+
+#if defined(CASCADE_X86_SIMD)
+inline static SimdLevel queryCpuSimdLevel() {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool has_sse41 = (regs[2] & (1 << 19)) != 0;
+    bool has_osxsave = (regs[2] & (1 << 27)) != 0;
+    bool has_avx = (regs[2] & (1 << 28)) != 0;
+    bool has_avx2 = false;
+    // AVX state must also be enabled by the OS
+    if (has_osxsave && has_avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(regs, 7, 0);
+        has_avx2 = (regs[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool has_sse41 = __builtin_cpu_supports("sse4.1");
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (has_avx2) {
+        return SimdLevel::AVX2;
+    }
+    if (has_sse41) {
+        return SimdLevel::SSE41;
+    }
+    return SimdLevel::Scalar;
+}
+#else
+inline static SimdLevel queryCpuSimdLevel() {
+    return SimdLevel::Scalar;
+}
+#endif
+
+// Returns the most capable instruction set supported by the CPU. The result
+// can be capped with the CASCADE_SIMD environment variable (scalar, sse4.1 or
+// avx2), which is useful for comparing the kernels against each other.
+inline static SimdLevel detectSimdLevel() {
+    SimdLevel level = queryCpuSimdLevel();
+
+    const char* cap = std::getenv("CASCADE_SIMD");
+    if (cap != nullptr) {
+        SimdLevel cap_level = level;
+        if (std::strcmp(cap, "scalar") == 0) {
+            cap_level = SimdLevel::Scalar;
+        } else if (std::strcmp(cap, "sse4.1") == 0) {
+            cap_level = SimdLevel::SSE41;
+        }
+        if (cap_level < level) {
+            level = cap_level;
+        }
+    }
+    return level;
+}
+
+} // namespace cascade
+
+#endif
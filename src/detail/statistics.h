@@ -0,0 +1,82 @@
+#ifndef CASCADE_DETAIL_STATISTICS_H_
+#define CASCADE_DETAIL_STATISTICS_H_
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+#include "detail/ptr_utils.h"
+
+namespace cascade {
+
+// Helpers for updating PipelineStatistics besides addStatistic(). They do
+// nothing unless statistics are enabled, so the calls and the computation of
+// their arguments disappear from the hot paths otherwise.
+
+// For counters that several threads may update at the same time
+inline void addStatisticAtomic(uint64_t& counter, uint64_t value) {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        std::atomic_ref<uint64_t>(counter).fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+// Nanoseconds since an arbitrary point in time
+inline uint64_t statisticsTimestamp() {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+    return 0;
+}
+
+// Number of fragments in a buffer of fragments laid out as given
+inline uint64_t countFragments(const void* frag_buf, uint32_t used_bytes, uint32_t fragment_stride,
+                               FragmentLayout layout) {
+    if (layout != FragmentLayout::Quads) {
+        return used_bytes / fragment_stride;
+    }
+    uint64_t fragments = 0;
+    for (uint32_t i = 0; i < used_bytes; i += fragment_stride) {
+        fragments += std::popcount(reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + i)->mask);
+    }
+    return fragments;
+}
+
+inline void accumulateTraversalStats(TraversalStats& dst, const TraversalStats& src) {
+    dst.blocks_rejected += src.blocks_rejected;
+    dst.blocks_accepted += src.blocks_accepted;
+    dst.blocks_partial += src.blocks_partial;
+    dst.blocks_occluded += src.blocks_occluded;
+    dst.pixels_rejected += src.pixels_rejected;
+    dst.pixels_accepted += src.pixels_accepted;
+    dst.pixels_tested += src.pixels_tested;
+    dst.pixels_occluded += src.pixels_occluded;
+}
+
+// Adds the counters of the rasterizer stages. The ones of the fragment
+// operations are updated by them directly.
+inline void accumulateRasterizerStatistics(PipelineStatistics& dst, const PipelineStatistics& src) {
+    dst.triangles_input += src.triangles_input;
+    dst.vertices_fetched += src.vertices_fetched;
+    dst.triangles_outside_guard_band += src.triangles_outside_guard_band;
+    dst.triangles_backfacing += src.triangles_backfacing;
+    dst.triangles_degenerate += src.triangles_degenerate;
+    dst.triangles_empty += src.triangles_empty;
+    dst.triangles_rasterized += src.triangles_rasterized;
+    dst.setup_ns += src.setup_ns;
+    accumulateTraversalStats(dst.traversal, src.traversal);
+    dst.fragments_emitted += src.fragments_emitted;
+    dst.traversal_ns += src.traversal_ns;
+    dst.flush_calls += src.flush_calls;
+    dst.flush_bytes += src.flush_bytes;
+    dst.flush_ns += src.flush_ns;
+}
+
+} // namespace cascade
+
+#endif
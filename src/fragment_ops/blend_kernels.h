@@ -0,0 +1,116 @@
+#ifndef CASCADE_BLEND_KERNELS_H_
+#define CASCADE_BLEND_KERNELS_H_
+
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+#include <cascade/fragment_ops.h>
+
+namespace cascade {
+
+// x * y / 255 rounded to the nearest integer for 8-bit x and y. The product
+// fits in 16 bits, so the vectorized kernels compute the same in 16-bit lanes.
+inline static uint32_t mulDiv255(uint32_t x, uint32_t y) {
+    uint32_t t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// Weights of the fragment and the destination in 1/255
+struct BlendFactors {
+    uint32_t src_color;
+    uint32_t dst_color;
+    uint32_t src_alpha;
+    uint32_t dst_alpha;
+};
+
+inline static BlendFactors blendFactors(BlendMode mode, uint32_t alpha) {
+    switch (mode) {
+        case BlendMode::Additive:
+            return {alpha, 255, 255, 255};
+        case BlendMode::Premultiplied:
+            return {255, 255 - alpha, 255, 255 - alpha};
+        case BlendMode::Over:
+            break;
+    }
+    return {alpha, 255 - alpha, 255, 255 - alpha};
+}
+
+// Blends the BGRA fragment color src into the BGRA pixel dst. The two
+// products of each channel are rounded separately and their sum saturates.
+inline static uint32_t blendPixel(BlendMode mode, uint32_t src, uint32_t dst) {
+    const BlendFactors factors = blendFactors(mode, src >> 24);
+    uint32_t result = 0;
+    for (uint32_t c = 0; c < 4; ++c) {
+        uint32_t src_factor = c == 3 ? factors.src_alpha : factors.src_color;
+        uint32_t dst_factor = c == 3 ? factors.dst_alpha : factors.dst_color;
+        uint32_t value =
+            mulDiv255((src >> (8 * c)) & 0xFF, src_factor) + mulDiv255((dst >> (8 * c)) & 0xFF, dst_factor);
+        result |= (value < 255 ? value : 255) << (8 * c);
+    }
+    return result;
+}
+
+// What blending a fragment does to the destination
+enum class BlendEffect : uint8_t {
+    Replace, // The result is the fragment color
+    Keep,    // The result is the destination
+    Blend,   // The destination has to be read
+};
+
+// blendPixel() gives exactly the fragment color for opaque fragments with Over
+// and Premultiplied and exactly the destination for transparent ones, so these
+// can skip reading the destination without changing the result. With
+// Premultiplied a fragment is only transparent if its color is zero as well.
+inline static BlendEffect blendEffect(BlendMode mode, uint32_t src) {
+    const uint32_t alpha = src >> 24;
+    if (alpha == 255 && mode != BlendMode::Additive) {
+        return BlendEffect::Replace;
+    }
+    if ((mode == BlendMode::Premultiplied ? src : alpha) == 0) {
+        return BlendEffect::Keep;
+    }
+    return BlendEffect::Blend;
+}
+
+inline static void blendIntoPixel(BlendMode mode, uint32_t src, uint32_t* pixel_ptr) {
+    switch (blendEffect(mode, src)) {
+        case BlendEffect::Replace:
+            *pixel_ptr = src;
+            break;
+        case BlendEffect::Keep:
+            break;
+        case BlendEffect::Blend:
+            *pixel_ptr = blendPixel(mode, src, *pixel_ptr);
+            break;
+    }
+}
+
+// Depth test of the blending operations, which leaves the depth buffer as it
+// is. Same comparison as testFragmentDepth().
+inline static bool passesFragmentDepth(const DepthBuffer& depth_buffer, uint32_t x, uint32_t y, float z) {
+    return z <= depth_buffer.depth[depthBufferIndex(depth_buffer, x, y)];
+}
+
+// Blends the fragments in the buffer into the color buffer of the context,
+// testing them against its depth buffer first if it has one. Returns the
+// number of fragments that passed if pipeline statistics are enabled and 0
+// otherwise.
+using BlendKernel = uint32_t (*)(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+uint32_t writeBlendedFragmentsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+uint32_t writeBlendedQuadsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+#if defined(CASCADE_X86_SIMD)
+uint32_t writeBlendedFragmentsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+uint32_t writeBlendedQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+uint32_t writeBlendedFragmentsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+
+uint32_t writeBlendedQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context);
+#endif
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,134 @@
+#include <cascade/fragment_ops.h>
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/blend_kernels.h"
+#include "fragment_ops/color_kernels.h"
+
+namespace cascade {
+
+uint32_t writeBlendedFragmentsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    uint32_t fragment_stride = context.fragment_stride;
+    uint32_t width = context.width;
+    ColorLayout color_layout = context.color_layout;
+    const DepthBuffer* depth_buffer = context.depth_buffer;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += fragment_stride) {
+        const uint32_t* coord_ptr = uint32_ptr(char_ptr(frag_buf) + i);
+        uint32_t x = coord_ptr[0];
+        uint32_t y = coord_ptr[1];
+        float z = *float_ptr(coord_ptr + 2);
+
+        if (depth_buffer != nullptr && !passesFragmentDepth(*depth_buffer, x, y, z)) {
+            continue;
+        }
+
+        const float* color_ptr = float_ptr(char_ptr(frag_buf) + i + FRAGMENT_COORD_SIZE);
+        uint32_t src = detail::packColor(color_ptr[0], color_ptr[1], color_ptr[2], color_ptr[3]);
+        blendIntoPixel(context.blend_mode, src, color_buf + colorPixelIndex(color_layout, width, x, y));
+        addStatistic(written, 1u);
+    }
+    return written;
+}
+
+uint32_t writeBlendedQuadsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    uint32_t quad_size = context.fragment_stride;
+    uint32_t width = context.width;
+    ColorLayout color_layout = context.color_layout;
+    const DepthBuffer* depth_buffer = context.depth_buffer;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += quad_size) {
+        const FragmentQuadHeader* header = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + i);
+        const float* values = float_ptr(char_ptr(frag_buf) + i + sizeof(FragmentQuadHeader));
+        // The attributes follow the depth of the four pixels
+        const float* color_ptr = values + 4;
+
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((header->mask & (1 << k)) == 0) {
+                continue;
+            }
+            uint32_t x = header->x + k % 2;
+            uint32_t y = header->y + k / 2;
+            if (depth_buffer != nullptr && !passesFragmentDepth(*depth_buffer, x, y, values[k])) {
+                continue;
+            }
+
+            uint32_t src = detail::packColor(color_ptr[k], color_ptr[4 + k], color_ptr[8 + k], color_ptr[12 + k]);
+            blendIntoPixel(context.blend_mode, src, color_buf + colorPixelIndex(color_layout, width, x, y));
+            addStatistic(written, 1u);
+        }
+    }
+    return written;
+}
+
+static BlendKernel selectFragmentBlendKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeBlendedFragmentsAVX2;
+        case SimdLevel::SSE41:
+            return writeBlendedFragmentsSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return writeBlendedFragmentsScalar;
+}
+
+static BlendKernel selectQuadBlendKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeBlendedQuadsAVX2;
+        case SimdLevel::SSE41:
+            return writeBlendedQuadsSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return writeBlendedQuadsScalar;
+}
+
+// Same as runColorKernel() in fragment_ops.cpp
+static void runBlendKernel(BlendKernel kernel, FragmentLayout layout, const void* frag_buf, uint32_t used_bytes,
+                           const OutputContext& context) {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        if (context.statistics != nullptr) {
+            uint64_t start = statisticsTimestamp();
+            uint64_t written = kernel(frag_buf, used_bytes, context);
+            uint64_t elapsed = statisticsTimestamp() - start;
+            uint64_t processed = countFragments(frag_buf, used_bytes, context.fragment_stride, layout);
+
+            PipelineStatistics& stats = *context.statistics;
+            addStatisticAtomic(stats.fragments_processed, processed);
+            addStatisticAtomic(stats.fragments_depth_failed, processed - written);
+            addStatisticAtomic(stats.fragments_written, written);
+            addStatisticAtomic(stats.fragment_ops_ns, elapsed);
+            return;
+        }
+    }
+    kernel(frag_buf, used_bytes, context);
+}
+
+void processBlendedFragments(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const BlendKernel blend_kernel = selectFragmentBlendKernel();
+    runBlendKernel(blend_kernel, FragmentLayout::Packed, frag_buf, used_bytes,
+                   *static_cast<const OutputContext*>(output_context));
+}
+
+void processBlendedFragmentQuads(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const BlendKernel blend_kernel = selectQuadBlendKernel();
+    runBlendKernel(blend_kernel, FragmentLayout::Quads, frag_buf, used_bytes,
+                   *static_cast<const OutputContext*>(output_context));
+}
+
+} // namespace cascade
@@ -0,0 +1,267 @@
+#ifndef CASCADE_BLEND_SIMD_H_
+#define CASCADE_BLEND_SIMD_H_
+
+#include <bit>
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/blend_kernels.h"
+#include "fragment_ops/color_kernels.h"
+#include "fragment_ops/color_simd.h"
+
+namespace cascade {
+
+// Same as mulDiv255() for every byte. The bytes are widened to 16-bit lanes,
+// which hold the products and the rounding without overflowing.
+template <typename Ops>
+inline static typename Ops::VecI mulDiv255Simd(typename Ops::VecI a, typename Ops::VecI b) {
+    using VecI = typename Ops::VecI;
+    const VecI rounding = Ops::set1i(0x00800080);
+    VecI low = Ops::add16(Ops::mul16(Ops::widenLow(a), Ops::widenLow(b)), rounding);
+    VecI high = Ops::add16(Ops::mul16(Ops::widenHigh(a), Ops::widenHigh(b)), rounding);
+    low = Ops::srli16(Ops::add16(low, Ops::srli16(low, 8)), 8);
+    high = Ops::srli16(Ops::add16(high, Ops::srli16(high, 8)), 8);
+    return Ops::narrow(low, high);
+}
+
+// Same as blendPixel() for every lane. The factors of blendFactors() are built
+// from the alpha byte copied to every channel.
+template <typename Ops>
+inline static typename Ops::VecI blendPixelsSimd(BlendMode mode, typename Ops::VecI src, typename Ops::VecI dst) {
+    using VecI = typename Ops::VecI;
+    const VecI all_ones = Ops::set1i(-1);
+    const VecI alpha_channel = Ops::set1i(static_cast<int32_t>(0xFF000000u));
+    const VecI alpha = Ops::broadcastAlpha(src);
+    const VecI inv_alpha = Ops::xori(alpha, all_ones);
+
+    VecI src_factor = Ops::ori(alpha, alpha_channel);
+    VecI dst_factor = inv_alpha;
+    if (mode == BlendMode::Additive) {
+        dst_factor = all_ones;
+    } else if (mode == BlendMode::Premultiplied) {
+        src_factor = all_ones;
+    }
+    return Ops::addsu8(mulDiv255Simd<Ops>(src, src_factor), mulDiv255Simd<Ops>(dst, dst_factor));
+}
+
+// Combined effect of the lanes set in mask, Blend if they differ
+template <int LANES>
+inline static BlendEffect groupBlendEffect(BlendMode mode, const uint32_t* src, int mask) {
+    bool replace = true;
+    bool keep = true;
+    for (int k = 0; k < LANES; ++k) {
+        if (mask & (1 << k)) {
+            BlendEffect effect = blendEffect(mode, src[k]);
+            replace = replace && effect == BlendEffect::Replace;
+            keep = keep && effect == BlendEffect::Keep;
+        }
+    }
+    return replace ? BlendEffect::Replace : (keep ? BlendEffect::Keep : BlendEffect::Blend);
+}
+
+// Vectorized blending of packed fragments shared by the SSE4.1 and AVX2
+// kernels, with the same requirements on Ops as the color kernels. Blending
+// reads the destination, so only runs of consecutive pixels, which cannot hit
+// a pixel twice, are blended as a vector. Other groups are blended one
+// fragment after another in their order.
+template <typename Ops>
+inline static uint32_t writeBlendedFragmentsSimd(const void* frag_buf, uint32_t used_bytes,
+                                                 const OutputContext& context) {
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+    constexpr int ALL_LANES = (1 << LANES) - 1;
+
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    const uint32_t fragment_stride = context.fragment_stride;
+    const uint32_t stride_floats = fragment_stride / sizeof(float);
+    const uint32_t width = context.width;
+    const ColorLayout color_layout = context.color_layout;
+    const BlendMode mode = context.blend_mode;
+    const DepthBuffer* depth_buffer = context.depth_buffer;
+    const uint32_t group_bytes = LANES * fragment_stride;
+
+    uint32_t written = 0;
+    uint32_t i = 0;
+    for (; used_bytes - i >= group_bytes; i += group_bytes) {
+        const char* group_ptr = char_ptr(frag_buf) + i;
+
+        uint32_t x[LANES];
+        uint32_t y[LANES];
+        bool run = true;
+        for (int k = 0; k < LANES; ++k) {
+            const uint32_t* coord_ptr = uint32_ptr(group_ptr + k * fragment_stride);
+            x[k] = coord_ptr[0];
+            y[k] = coord_ptr[1];
+            run = run && y[k] == y[0] && x[k] == x[0] + k;
+        }
+
+        int mask = ALL_LANES;
+        if (depth_buffer != nullptr) {
+            for (int k = 0; k < LANES; ++k) {
+                float z = *float_ptr(group_ptr + k * fragment_stride + 2 * sizeof(uint32_t));
+                if (!passesFragmentDepth(*depth_buffer, x[k], y[k], z)) {
+                    mask &= ~(1 << k);
+                }
+            }
+            if (mask == 0) {
+                continue;
+            }
+        }
+
+        const float* color_ptr = float_ptr(group_ptr + FRAGMENT_COORD_SIZE);
+        VecI src = Ops::packColors(
+            Ops::loadStrided(color_ptr, stride_floats), Ops::loadStrided(color_ptr + 1, stride_floats),
+            Ops::loadStrided(color_ptr + 2, stride_floats), Ops::loadStrided(color_ptr + 3, stride_floats));
+        addStatistic(written, static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(mask))));
+
+        alignas(32) uint32_t values[LANES];
+        Ops::store(values, src);
+        if (!run) {
+            for (int k = 0; k < LANES; ++k) {
+                if (mask & (1 << k)) {
+                    blendIntoPixel(mode, values[k], color_buf + colorPixelIndex(color_layout, width, x[k], y[k]));
+                }
+            }
+            continue;
+        }
+
+        const BlendEffect effect = groupBlendEffect<LANES>(mode, values, mask);
+        if (effect == BlendEffect::Keep) {
+            continue;
+        }
+        if (mask == ALL_LANES && color_layout == ColorLayout::Linear) {
+            uint32_t* run_ptr = color_buf + y[0] * width + x[0];
+            Ops::storeu(run_ptr,
+                        effect == BlendEffect::Replace ? src : blendPixelsSimd<Ops>(mode, src, Ops::loadu(run_ptr)));
+            continue;
+        }
+
+        // Lanes that failed the depth test still read a valid pixel, which is
+        // then left as it is
+        alignas(32) uint32_t pixels[LANES];
+        uint32_t indices[LANES];
+        for (int k = 0; k < LANES; ++k) {
+            indices[k] = colorPixelIndex(color_layout, width, x[k], y[0]);
+            pixels[k] = color_buf[indices[k]];
+        }
+        Ops::store(pixels, blendPixelsSimd<Ops>(mode, src, Ops::loadu(pixels)));
+        for (int k = 0; k < LANES; ++k) {
+            if (mask & (1 << k)) {
+                color_buf[indices[k]] = pixels[k];
+            }
+        }
+    }
+
+    // Fewer fragments than lanes are left
+    return written + writeBlendedFragmentsScalar(char_ptr(frag_buf) + i, used_bytes - i, context);
+}
+
+// Vectorized blending of quads. Each vector covers up to LANES / 4 quads like
+// writeQuadColorsSimd(), but a quad that covers the same pixels as an earlier
+// one of the group is left for the next group, so that it is blended over the
+// result of the earlier one.
+template <typename Ops>
+inline static uint32_t writeBlendedQuadsSimd(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+    constexpr int QUADS = LANES / 4;
+
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    const uint32_t quad_size = context.fragment_stride;
+    const uint32_t width = context.width;
+    const ColorLayout color_layout = context.color_layout;
+    const uint32_t row_pitch = colorRowPitch(color_layout, width);
+    const BlendMode mode = context.blend_mode;
+    const DepthBuffer* depth_buffer = context.depth_buffer;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes;) {
+        const FragmentQuadHeader* headers[QUADS] = {};
+        const float* values[QUADS] = {};
+        int masks[QUADS];
+        int quads = 0;
+        for (; quads < QUADS && i + quads * quad_size < used_bytes; ++quads) {
+            const char* quad_ptr = char_ptr(frag_buf) + i + quads * quad_size;
+            const FragmentQuadHeader* header = reinterpret_cast<const FragmentQuadHeader*>(quad_ptr);
+            bool repeated = false;
+            for (int q = 0; q < quads; ++q) {
+                repeated = repeated || (headers[q]->x == header->x && headers[q]->y == header->y);
+            }
+            if (repeated) {
+                break;
+            }
+            headers[quads] = header;
+            values[quads] = float_ptr(quad_ptr + sizeof(FragmentQuadHeader));
+            masks[quads] = static_cast<int>(header->mask);
+        }
+        // The remaining lanes repeat the first quad and are masked off
+        for (int q = quads; q < QUADS; ++q) {
+            headers[q] = headers[0];
+            values[q] = values[0];
+            masks[q] = 0;
+        }
+        i += quads * quad_size;
+
+        int any_passed = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            for (uint32_t k = 0; k < 4; ++k) {
+                if ((masks[q] & (1 << k)) && depth_buffer != nullptr &&
+                    !passesFragmentDepth(*depth_buffer, headers[q]->x + k % 2, headers[q]->y + k / 2, values[q][k])) {
+                    masks[q] &= ~(1 << k);
+                }
+            }
+            any_passed |= masks[q];
+            addStatistic(written, static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(masks[q]))));
+        }
+        if (any_passed == 0) {
+            continue;
+        }
+
+        // The attributes follow the depth of the four pixels
+        const float* channels[4][QUADS];
+        for (int q = 0; q < QUADS; ++q) {
+            for (int c = 0; c < 4; ++c) {
+                channels[c][q] = values[q] + 4 * (c + 1);
+            }
+        }
+        VecI src = Ops::packColors(Ops::loadQuads(channels[0]), Ops::loadQuads(channels[1]),
+                                   Ops::loadQuads(channels[2]), Ops::loadQuads(channels[3]));
+        alignas(32) uint32_t pixels[LANES];
+        Ops::store(pixels, src);
+
+        int lane_mask = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            lane_mask |= masks[q] << (4 * q);
+        }
+        const BlendEffect effect = groupBlendEffect<LANES>(mode, pixels, lane_mask);
+        if (effect == BlendEffect::Keep) {
+            continue;
+        }
+        if (effect == BlendEffect::Blend) {
+            // Both rows of a quad are pairs of neighbouring pixels. Pixels
+            // that are not covered may lie outside of the color buffer, so
+            // only the covered ones are read.
+            alignas(32) uint32_t dst[LANES] = {};
+            for (int q = 0; q < QUADS; ++q) {
+                const uint32_t* row_ptr =
+                    color_buf + colorPixelIndex(color_layout, width, headers[q]->x, headers[q]->y);
+                const uint32_t offsets[4] = {0, 1, row_pitch, row_pitch + 1};
+                for (int k = 0; k < 4; ++k) {
+                    if (masks[q] & (1 << k)) {
+                        dst[4 * q + k] = row_ptr[offsets[k]];
+                    }
+                }
+            }
+            Ops::store(pixels, blendPixelsSimd<Ops>(mode, src, Ops::loadu(dst)));
+        }
+        storeQuadPixels(color_buf, color_layout, width, headers, masks, pixels, QUADS);
+    }
+    return written;
+}
+
+} // namespace cascade
+
+#endif
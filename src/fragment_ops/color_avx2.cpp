@@ -0,0 +1,123 @@
+#include "fragment_ops/color_kernels.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "fragment_ops/blend_kernels.h"
+#include "fragment_ops/blend_simd.h"
+#include "fragment_ops/color_simd.h"
+#include "fragment_ops/texture_kernels.h"
+#include "fragment_ops/texture_simd.h"
+
+namespace cascade {
+
+struct AVX2ColorOps {
+    using Vec = __m256;
+    using VecI = __m256i;
+    static constexpr int LANES = 8;
+
+    static Vec loadStrided(const float* src, uint32_t stride) {
+        return _mm256_setr_ps(src[0], src[stride], src[2 * stride], src[3 * stride], src[4 * stride],
+                              src[5 * stride], src[6 * stride], src[7 * stride]);
+    }
+
+    // The lanes of quad 0 go to the lower half and those of quad 1 to the
+    // upper half
+    static Vec loadQuads(const float* const* src) {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(src[0])), _mm_load_ps(src[1]), 1);
+    }
+
+    static void store(uint32_t* dst, VecI a) { _mm256_store_si256(reinterpret_cast<VecI*>(dst), a); }
+    static void storeu(uint32_t* dst, VecI a) { _mm256_storeu_si256(reinterpret_cast<VecI*>(dst), a); }
+    static VecI loadu(const uint32_t* src) { return _mm256_loadu_si256(reinterpret_cast<const VecI*>(src)); }
+
+    // Same as quantizeColor(). max() returns its second operand for NaN.
+    static VecI quantize(Vec color) {
+        Vec clamped = _mm256_min_ps(_mm256_max_ps(color, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        return _mm256_cvttps_epi32(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)));
+    }
+
+    // Same as packColor()
+    static VecI packColors(Vec r, Vec g, Vec b, Vec a) {
+        VecI ar = _mm256_or_si256(_mm256_slli_epi32(quantize(a), 24), _mm256_slli_epi32(quantize(r), 16));
+        VecI gb = _mm256_or_si256(_mm256_slli_epi32(quantize(g), 8), quantize(b));
+        return _mm256_or_si256(ar, gb);
+    }
+
+    static Vec load(const float* src) { return _mm256_load_ps(src); }
+    static VecI loadi(const int32_t* src) { return _mm256_load_si256(reinterpret_cast<const VecI*>(src)); }
+    static Vec set1(float a) { return _mm256_set1_ps(a); }
+    static VecI set1i(int32_t a) { return _mm256_set1_epi32(a); }
+
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static Vec floor(Vec a) { return _mm256_floor_ps(a); }
+    static VecI toInt(Vec a) { return _mm256_cvttps_epi32(a); }
+    static Vec toFloat(VecI a) { return _mm256_cvtepi32_ps(a); }
+
+    static VecI addi(VecI a, VecI b) { return _mm256_add_epi32(a, b); }
+    static VecI mullo(VecI a, VecI b) { return _mm256_mullo_epi32(a, b); }
+    static VecI andi(VecI a, VecI b) { return _mm256_and_si256(a, b); }
+    static VecI ori(VecI a, VecI b) { return _mm256_or_si256(a, b); }
+    static VecI mini(VecI a, VecI b) { return _mm256_min_epi32(a, b); }
+    static VecI maxi(VecI a, VecI b) { return _mm256_max_epi32(a, b); }
+    static VecI slli(VecI a, int count) { return _mm256_slli_epi32(a, count); }
+    static VecI srli(VecI a, int count) { return _mm256_srli_epi32(a, count); }
+    static VecI xori(VecI a, VecI b) { return _mm256_xor_si256(a, b); }
+
+    // Bytes of the lower and upper half of each 128-bit lane in 16-bit lanes,
+    // which packus puts back in order
+    static VecI widenLow(VecI a) { return _mm256_unpacklo_epi8(a, _mm256_setzero_si256()); }
+    static VecI widenHigh(VecI a) { return _mm256_unpackhi_epi8(a, _mm256_setzero_si256()); }
+    static VecI narrow(VecI low, VecI high) { return _mm256_packus_epi16(low, high); }
+    static VecI add16(VecI a, VecI b) { return _mm256_add_epi16(a, b); }
+    static VecI mul16(VecI a, VecI b) { return _mm256_mullo_epi16(a, b); }
+    static VecI srli16(VecI a, int count) { return _mm256_srli_epi16(a, count); }
+    static VecI addsu8(VecI a, VecI b) { return _mm256_adds_epu8(a, b); }
+
+    // Copies the alpha byte of every pixel to its other channels. The shuffle
+    // works within 128-bit lanes, which hold whole pixels.
+    static VecI broadcastAlpha(VecI a) {
+        const VecI alpha_bytes = _mm256_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15, 3, 3, 3, 3, 7,
+                                                  7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+        return _mm256_shuffle_epi8(a, alpha_bytes);
+    }
+
+    static VecI gather(const uint32_t* base, VecI index) {
+        return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), index, 4);
+    }
+};
+
+uint32_t writeFragmentColorsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                 DepthBuffer* depth_buffer) {
+    return writeFragmentColorsSimd<AVX2ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeQuadColorsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                             DepthBuffer* depth_buffer) {
+    return writeQuadColorsSimd<AVX2ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeTexturedQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                DepthBuffer* depth_buffer) {
+    return writeTexturedQuadsSimd<AVX2ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeMultisampleQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                   bool depth_test) {
+    return writeMultisampleQuadsSimd<AVX2ColorOps>(frag_buf, used_bytes, context, depth_test);
+}
+
+uint32_t writeBlendedFragmentsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    return writeBlendedFragmentsSimd<AVX2ColorOps>(frag_buf, used_bytes, context);
+}
+
+uint32_t writeBlendedQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    return writeBlendedQuadsSimd<AVX2ColorOps>(frag_buf, used_bytes, context);
+}
+
+} // namespace cascade
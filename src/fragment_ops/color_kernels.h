@@ -0,0 +1,75 @@
+#ifndef CASCADE_COLOR_KERNELS_H_
+#define CASCADE_COLOR_KERNELS_H_
+
+#include <cstdint>
+
+#include <cascade/color_buffer.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/detail/color.h>
+#include <cascade/fragment_ops.h>
+
+#include "depth_buffer/depth_pyramid.h"
+
+namespace cascade {
+
+constexpr uint32_t FRAGMENT_COORD_SIZE = 2 * sizeof(uint32_t) + sizeof(float);
+
+// Position of pixel (x, y) in a color buffer with the given layout and width
+inline static uint32_t colorPixelIndex(ColorLayout layout, uint32_t width, uint32_t x, uint32_t y) {
+    if (layout == ColorLayout::Blocked) {
+        uint32_t blocks_x = (width + COLOR_BLOCK_SIZE - 1) / COLOR_BLOCK_SIZE;
+        uint32_t block = (y / COLOR_BLOCK_SIZE) * blocks_x + x / COLOR_BLOCK_SIZE;
+        return block * COLOR_BLOCK_SIZE * COLOR_BLOCK_SIZE + (y % COLOR_BLOCK_SIZE) * COLOR_BLOCK_SIZE +
+               x % COLOR_BLOCK_SIZE;
+    }
+    return y * width + x;
+}
+
+// Distance from a pixel to the one below it. Quads start on even rows, so
+// both rows of a quad are always in the same block.
+inline static uint32_t colorRowPitch(ColorLayout layout, uint32_t width) {
+    return layout == ColorLayout::Blocked ? COLOR_BLOCK_SIZE : width;
+}
+
+// Depth test of the fragment stage. Fragments pass if they are not farther
+// than the stored depth, which is then updated.
+inline static bool testFragmentDepth(DepthBuffer& depth_buffer, uint32_t x, uint32_t y, float z) {
+    float& stored = depth_buffer.depth[depthBufferIndex(depth_buffer, x, y)];
+    if (z <= stored) {
+        stored = z;
+        lowerDepthRange(depth_buffer, x, y, z);
+        return true;
+    }
+    return false;
+}
+
+// Writes the color of the fragments in the buffer to the color buffer of the
+// context. Fragments are depth tested first if depth_buffer is set. Returns
+// the number of fragments written if pipeline statistics are enabled and 0
+// otherwise.
+using ColorKernel = uint32_t (*)(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                 DepthBuffer* depth_buffer);
+
+uint32_t writeFragmentColorsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                   DepthBuffer* depth_buffer);
+
+uint32_t writeQuadColorsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                               DepthBuffer* depth_buffer);
+
+#if defined(CASCADE_X86_SIMD)
+uint32_t writeFragmentColorsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                  DepthBuffer* depth_buffer);
+
+uint32_t writeQuadColorsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                              DepthBuffer* depth_buffer);
+
+uint32_t writeFragmentColorsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                 DepthBuffer* depth_buffer);
+
+uint32_t writeQuadColorsAVX2(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                             DepthBuffer* depth_buffer);
+#endif
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef CASCADE_COLOR_SIMD_H_
+#define CASCADE_COLOR_SIMD_H_
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include <cascade/rasterizer.h>
+
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/color_kernels.h"
+#include "fragment_ops/multisample_kernels.h"
+
+namespace cascade {
+
+// Vectorized color output shared by the SSE4.1 and AVX2 kernels. Ops wraps the
+// vector types and operations of one instruction set, so this header must only
+// be included from translation units compiled for that instruction set.
+//
+// Every group of fragments is depth tested first and then written in order, so
+// a pixel that appears several times in a group ends up with the color of the
+// last fragment that passed, just like with the scalar kernels.
+template <typename Ops>
+inline static uint32_t writeFragmentColorsSimd(const void* frag_buf, uint32_t used_bytes,
+                                               const OutputContext& context, DepthBuffer* depth_buffer) {
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+    constexpr int ALL_LANES = (1 << LANES) - 1;
+
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    const uint32_t fragment_stride = context.fragment_stride;
+    const uint32_t stride_floats = fragment_stride / sizeof(float);
+    const uint32_t width = context.width;
+    const ColorLayout color_layout = context.color_layout;
+    const uint32_t group_bytes = LANES * fragment_stride;
+
+    uint32_t written = 0;
+    uint32_t i = 0;
+    for (; used_bytes - i >= group_bytes; i += group_bytes) {
+        const char* group_ptr = char_ptr(frag_buf) + i;
+
+        // The group is a run if its fragments are consecutive pixels of a
+        // single row, which is what the rasterizer emits for the inside of
+        // triangles
+        uint32_t x[LANES];
+        uint32_t y[LANES];
+        bool run = true;
+        for (int k = 0; k < LANES; ++k) {
+            const uint32_t* coord_ptr = uint32_ptr(group_ptr + k * fragment_stride);
+            x[k] = coord_ptr[0];
+            y[k] = coord_ptr[1];
+            run = run && y[k] == y[0] && x[k] == x[0] + k;
+        }
+
+        int mask = ALL_LANES;
+        if (depth_buffer != nullptr) {
+            for (int k = 0; k < LANES; ++k) {
+                float z = *float_ptr(group_ptr + k * fragment_stride + 2 * sizeof(uint32_t));
+                if (!testFragmentDepth(*depth_buffer, x[k], y[k], z)) {
+                    mask &= ~(1 << k);
+                }
+            }
+            if (mask == 0) {
+                continue;
+            }
+        }
+
+        const float* color_ptr = float_ptr(group_ptr + FRAGMENT_COORD_SIZE);
+        VecI pixels = Ops::packColors(
+            Ops::loadStrided(color_ptr, stride_floats), Ops::loadStrided(color_ptr + 1, stride_floats),
+            Ops::loadStrided(color_ptr + 2, stride_floats), Ops::loadStrided(color_ptr + 3, stride_floats));
+        addStatistic(written, static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(mask))));
+
+        if (run && mask == ALL_LANES && color_layout == ColorLayout::Linear) {
+            Ops::storeu(color_buf + y[0] * width + x[0], pixels);
+            continue;
+        }
+
+        alignas(32) uint32_t values[LANES];
+        Ops::store(values, pixels);
+        if (run && mask == ALL_LANES) {
+            // In a blocked color buffer a run is contiguous up to the end of
+            // the row of a block, so it is copied in at most two pieces
+            for (int k = 0; k < LANES;) {
+                uint32_t count = COLOR_BLOCK_SIZE - x[k] % COLOR_BLOCK_SIZE;
+                count = count < static_cast<uint32_t>(LANES - k) ? count : LANES - k;
+                std::memcpy(color_buf + colorPixelIndex(color_layout, width, x[k], y[0]), values + k,
+                            count * sizeof(uint32_t));
+                k += count;
+            }
+            continue;
+        }
+        for (int k = 0; k < LANES; ++k) {
+            if (mask & (1 << k)) {
+                color_buf[colorPixelIndex(color_layout, width, x[k], y[k])] = values[k];
+            }
+        }
+    }
+
+    // Fewer fragments than lanes are left
+    return written + writeFragmentColorsScalar(char_ptr(frag_buf) + i, used_bytes - i, context, depth_buffer);
+}
+
+// Clears the bits of the pixels of each quad that fail the depth test
+inline static void testQuadDepths(DepthBuffer& depth_buffer, const FragmentQuadHeader* const* headers,
+                                  const float* const* values, int* masks, int quads) {
+    for (int q = 0; q < quads; ++q) {
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((masks[q] & (1 << k)) &&
+                !testFragmentDepth(depth_buffer, headers[q]->x + k % 2, headers[q]->y + k / 2, values[q][k])) {
+                masks[q] &= ~(1 << k);
+            }
+        }
+    }
+}
+
+// Writes the pixels of each quad that are set in its mask, four consecutive
+// values per quad, and returns how many were written
+inline static uint32_t storeQuadPixels(uint32_t* color_buf, ColorLayout color_layout, uint32_t width,
+                                       const FragmentQuadHeader* const* headers, const int* masks,
+                                       const uint32_t* pixels, int quads) {
+    const uint32_t row_pitch = colorRowPitch(color_layout, width);
+    uint32_t written = 0;
+    for (int q = 0; q < quads; ++q) {
+        written += static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(masks[q])));
+        uint32_t* row_ptr = color_buf + colorPixelIndex(color_layout, width, headers[q]->x, headers[q]->y);
+        if (masks[q] == 0xF) {
+            // Both rows of the quad are written as a pair of pixels
+            std::memcpy(row_ptr, pixels + 4 * q, 2 * sizeof(uint32_t));
+            std::memcpy(row_ptr + row_pitch, pixels + 4 * q + 2, 2 * sizeof(uint32_t));
+            continue;
+        }
+        for (uint32_t k = 0; k < 4; ++k) {
+            if (masks[q] & (1 << k)) {
+                row_ptr[(k / 2) * row_pitch + k % 2] = pixels[4 * q + k];
+            }
+        }
+    }
+    return written;
+}
+
+// Quads already hold their values in groups of four lanes, so each vector
+// covers LANES / 4 quads and is loaded straight from the records
+template <typename Ops>
+inline static uint32_t writeQuadColorsSimd(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                           DepthBuffer* depth_buffer) {
+    constexpr int LANES = Ops::LANES;
+    constexpr int QUADS = LANES / 4;
+
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    const uint32_t quad_size = context.fragment_stride;
+    const uint32_t width = context.width;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += QUADS * quad_size) {
+        const FragmentQuadHeader* headers[QUADS];
+        const float* values[QUADS];
+        int masks[QUADS];
+        for (int q = 0; q < QUADS; ++q) {
+            // Lanes past the end of the buffer repeat the first quad and are
+            // masked off
+            uint32_t offset = i + q * quad_size < used_bytes ? i + q * quad_size : i;
+            headers[q] = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + offset);
+            values[q] = float_ptr(char_ptr(frag_buf) + offset + sizeof(FragmentQuadHeader));
+            masks[q] = i + q * quad_size < used_bytes ? static_cast<int>(headers[q]->mask) : 0;
+        }
+
+        if (depth_buffer != nullptr) {
+            testQuadDepths(*depth_buffer, headers, values, masks, QUADS);
+        }
+
+        // The attributes follow the depth of the four pixels
+        const float* channels[4][QUADS];
+        for (int q = 0; q < QUADS; ++q) {
+            for (int c = 0; c < 4; ++c) {
+                channels[c][q] = values[q] + 4 * (c + 1);
+            }
+        }
+        alignas(32) uint32_t pixels[LANES];
+        Ops::store(pixels, Ops::packColors(Ops::loadQuads(channels[0]), Ops::loadQuads(channels[1]),
+                                           Ops::loadQuads(channels[2]), Ops::loadQuads(channels[3])));
+
+        addStatistic(written, storeQuadPixels(color_buf, context.color_layout, width, headers, masks, pixels, QUADS));
+    }
+    return written;
+}
+
+// Multisample output with the shading of writeQuadColorsSimd(). The samples
+// are then depth tested and written with scalar code, since their number
+// varies from pixel to pixel.
+template <typename Ops>
+inline static uint32_t writeMultisampleQuadsSimd(const void* frag_buf, uint32_t used_bytes,
+                                                 const MultisampleOutputContext& context, bool depth_test) {
+    constexpr int LANES = Ops::LANES;
+    constexpr int QUADS = LANES / 4;
+
+    const uint32_t quad_size = context.fragment_stride;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += QUADS * quad_size) {
+        const FragmentQuadHeader* headers[QUADS];
+        const float* values[QUADS];
+        int quads = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            // Lanes past the end of the buffer repeat the first quad and are
+            // not stored
+            uint32_t offset = i + q * quad_size < used_bytes ? i + q * quad_size : i;
+            headers[q] = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + offset);
+            values[q] = float_ptr(char_ptr(frag_buf) + offset + sizeof(FragmentQuadHeader));
+            quads += i + q * quad_size < used_bytes;
+        }
+
+        // The attributes follow the depth of the four pixels
+        const float* channels[4][QUADS];
+        for (int q = 0; q < QUADS; ++q) {
+            for (int c = 0; c < 4; ++c) {
+                channels[c][q] = values[q] + 4 * (c + 1);
+            }
+        }
+        alignas(32) uint32_t pixels[LANES];
+        Ops::store(pixels, Ops::packColors(Ops::loadQuads(channels[0]), Ops::loadQuads(channels[1]),
+                                           Ops::loadQuads(channels[2]), Ops::loadQuads(channels[3])));
+
+        for (int q = 0; q < quads; ++q) {
+            addStatistic(written,
+                         storeQuadSamples(*context.target, *headers[q], values[q], pixels + 4 * q, depth_test));
+        }
+    }
+    return written;
+}
+
+} // namespace cascade
+
+#endif
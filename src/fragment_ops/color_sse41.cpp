@@ -0,0 +1,118 @@
+#include "fragment_ops/color_kernels.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "fragment_ops/blend_kernels.h"
+#include "fragment_ops/blend_simd.h"
+#include "fragment_ops/color_simd.h"
+#include "fragment_ops/texture_kernels.h"
+#include "fragment_ops/texture_simd.h"
+
+namespace cascade {
+
+struct SSE41ColorOps {
+    using Vec = __m128;
+    using VecI = __m128i;
+    static constexpr int LANES = 4;
+
+    static Vec loadStrided(const float* src, uint32_t stride) {
+        return _mm_setr_ps(src[0], src[stride], src[2 * stride], src[3 * stride]);
+    }
+
+    static Vec loadQuads(const float* const* src) { return _mm_load_ps(src[0]); }
+
+    static void store(uint32_t* dst, VecI a) { _mm_store_si128(reinterpret_cast<VecI*>(dst), a); }
+    static void storeu(uint32_t* dst, VecI a) { _mm_storeu_si128(reinterpret_cast<VecI*>(dst), a); }
+    static VecI loadu(const uint32_t* src) { return _mm_loadu_si128(reinterpret_cast<const VecI*>(src)); }
+
+    // Same as quantizeColor(). max() returns its second operand for NaN.
+    static VecI quantize(Vec color) {
+        Vec clamped = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        return _mm_cvttps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+    }
+
+    // Same as packColor()
+    static VecI packColors(Vec r, Vec g, Vec b, Vec a) {
+        VecI ar = _mm_or_si128(_mm_slli_epi32(quantize(a), 24), _mm_slli_epi32(quantize(r), 16));
+        VecI gb = _mm_or_si128(_mm_slli_epi32(quantize(g), 8), quantize(b));
+        return _mm_or_si128(ar, gb);
+    }
+
+    static Vec load(const float* src) { return _mm_load_ps(src); }
+    static VecI loadi(const int32_t* src) { return _mm_load_si128(reinterpret_cast<const VecI*>(src)); }
+    static Vec set1(float a) { return _mm_set1_ps(a); }
+    static VecI set1i(int32_t a) { return _mm_set1_epi32(a); }
+
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    static Vec floor(Vec a) { return _mm_floor_ps(a); }
+    static VecI toInt(Vec a) { return _mm_cvttps_epi32(a); }
+    static Vec toFloat(VecI a) { return _mm_cvtepi32_ps(a); }
+
+    static VecI addi(VecI a, VecI b) { return _mm_add_epi32(a, b); }
+    static VecI mullo(VecI a, VecI b) { return _mm_mullo_epi32(a, b); }
+    static VecI andi(VecI a, VecI b) { return _mm_and_si128(a, b); }
+    static VecI ori(VecI a, VecI b) { return _mm_or_si128(a, b); }
+    static VecI mini(VecI a, VecI b) { return _mm_min_epi32(a, b); }
+    static VecI maxi(VecI a, VecI b) { return _mm_max_epi32(a, b); }
+    static VecI slli(VecI a, int count) { return _mm_slli_epi32(a, count); }
+    static VecI srli(VecI a, int count) { return _mm_srli_epi32(a, count); }
+    static VecI xori(VecI a, VecI b) { return _mm_xor_si128(a, b); }
+
+    // Bytes of the lower and upper half in 16-bit lanes
+    static VecI widenLow(VecI a) { return _mm_unpacklo_epi8(a, _mm_setzero_si128()); }
+    static VecI widenHigh(VecI a) { return _mm_unpackhi_epi8(a, _mm_setzero_si128()); }
+    static VecI narrow(VecI low, VecI high) { return _mm_packus_epi16(low, high); }
+    static VecI add16(VecI a, VecI b) { return _mm_add_epi16(a, b); }
+    static VecI mul16(VecI a, VecI b) { return _mm_mullo_epi16(a, b); }
+    static VecI srli16(VecI a, int count) { return _mm_srli_epi16(a, count); }
+    static VecI addsu8(VecI a, VecI b) { return _mm_adds_epu8(a, b); }
+
+    // Copies the alpha byte of every pixel to its other channels
+    static VecI broadcastAlpha(VecI a) {
+        return _mm_shuffle_epi8(a, _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15));
+    }
+
+    // There is no gather instruction before AVX2
+    static VecI gather(const uint32_t* base, VecI index) {
+        return _mm_setr_epi32(static_cast<int>(base[_mm_cvtsi128_si32(index)]),
+                              static_cast<int>(base[_mm_extract_epi32(index, 1)]),
+                              static_cast<int>(base[_mm_extract_epi32(index, 2)]),
+                              static_cast<int>(base[_mm_extract_epi32(index, 3)]));
+    }
+};
+
+uint32_t writeFragmentColorsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                  DepthBuffer* depth_buffer) {
+    return writeFragmentColorsSimd<SSE41ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeQuadColorsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                              DepthBuffer* depth_buffer) {
+    return writeQuadColorsSimd<SSE41ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeTexturedQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                 DepthBuffer* depth_buffer) {
+    return writeTexturedQuadsSimd<SSE41ColorOps>(frag_buf, used_bytes, context, depth_buffer);
+}
+
+uint32_t writeMultisampleQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                    bool depth_test) {
+    return writeMultisampleQuadsSimd<SSE41ColorOps>(frag_buf, used_bytes, context, depth_test);
+}
+
+uint32_t writeBlendedFragmentsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    return writeBlendedFragmentsSimd<SSE41ColorOps>(frag_buf, used_bytes, context);
+}
+
+uint32_t writeBlendedQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const OutputContext& context) {
+    return writeBlendedQuadsSimd<SSE41ColorOps>(frag_buf, used_bytes, context);
+}
+
+} // namespace cascade
@@ -2,51 +2,146 @@
 
 #include <cstdint>
 
+#include <cascade/rasterizer.h>
+
+#include "detail/cpu_features.h"
 #include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/color_kernels.h"
 
 namespace cascade {
 
-constexpr uint32_t FRAGMENT_COORD_SIZE = 2 * sizeof(uint32_t) + sizeof(float);
-
-inline static uint8_t quantizeColor(float color) {
-    if (color < 0.0f) {
-        return 0;
-    }
-    if (color > 1.0f) {
-        return 255;
-    }
-    return static_cast<uint8_t>(color * 255.0f);
-}
-
-void processFragmentsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
-    const OutputContext* context = static_cast<const OutputContext*>(output_context);
-    void* color_buf = context->color_buffer;
-    uint32_t fragment_stride = context->fragment_stride;
-    uint32_t width = context->width;
+uint32_t writeFragmentColorsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                                   DepthBuffer* depth_buffer) {
+    void* color_buf = context.color_buffer;
+    uint32_t fragment_stride = context.fragment_stride;
+    uint32_t width = context.width;
+    ColorLayout color_layout = context.color_layout;
 
+    uint32_t written = 0;
     // CHECK: Will overflow if the memory used is over 4GB
     for (uint32_t i = 0; i < used_bytes; i += fragment_stride) {
         const uint32_t* coord_ptr = uint32_ptr(char_ptr(frag_buf) + i);
         uint32_t x = coord_ptr[0];
         uint32_t y = coord_ptr[1];
+        float z = *float_ptr(coord_ptr + 2);
+
+        if (depth_buffer != nullptr && !testFragmentDepth(*depth_buffer, x, y, z)) {
+            continue;
+        }
 
         const float* color_ptr = float_ptr(char_ptr(frag_buf) + i + FRAGMENT_COORD_SIZE);
-        float frag_r = color_ptr[0];
-        float frag_g = color_ptr[1];
-        float frag_b = color_ptr[2];
-        float frag_a = color_ptr[3];
-
-        uint8_t r = quantizeColor(frag_r);
-        uint8_t g = quantizeColor(frag_g);
-        uint8_t b = quantizeColor(frag_b);
-        uint8_t a = quantizeColor(frag_a);
-
-        // The memory layout that is used for the colors is BGRA
-        // Since we assume a little-endian machine this means that b must be the
-        // least significant byte
-        uint32_t* pixel_ptr = uint32_ptr(color_buf) + y * width + x;
-        *pixel_ptr = (a << 24) | (r << 16) | (g << 8) | b;
+        uint32_t* pixel_ptr = uint32_ptr(color_buf) + colorPixelIndex(color_layout, width, x, y);
+        *pixel_ptr = detail::packColor(color_ptr[0], color_ptr[1], color_ptr[2], color_ptr[3]);
+        addStatistic(written, 1u);
+    }
+    return written;
+}
+
+uint32_t writeQuadColorsScalar(const void* frag_buf, uint32_t used_bytes, const OutputContext& context,
+                               DepthBuffer* depth_buffer) {
+    void* color_buf = context.color_buffer;
+    uint32_t quad_size = context.fragment_stride;
+    uint32_t width = context.width;
+    ColorLayout color_layout = context.color_layout;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += quad_size) {
+        const FragmentQuadHeader* header = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + i);
+        const float* values = float_ptr(char_ptr(frag_buf) + i + sizeof(FragmentQuadHeader));
+        // The attributes follow the depth of the four pixels
+        const float* color_ptr = values + 4;
+
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((header->mask & (1 << k)) == 0) {
+                continue;
+            }
+            uint32_t x = header->x + k % 2;
+            uint32_t y = header->y + k / 2;
+            if (depth_buffer != nullptr && !testFragmentDepth(*depth_buffer, x, y, values[k])) {
+                continue;
+            }
+
+            uint32_t* pixel_ptr = uint32_ptr(color_buf) + colorPixelIndex(color_layout, width, x, y);
+            *pixel_ptr = detail::packColor(color_ptr[k], color_ptr[4 + k], color_ptr[8 + k], color_ptr[12 + k]);
+            addStatistic(written, 1u);
+        }
+    }
+    return written;
+}
+
+static ColorKernel selectFragmentKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeFragmentColorsAVX2;
+        case SimdLevel::SSE41:
+            return writeFragmentColorsSSE41;
+        case SimdLevel::Scalar:
+            break;
     }
+#endif
+    return writeFragmentColorsScalar;
+}
+
+static ColorKernel selectQuadKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeQuadColorsAVX2;
+        case SimdLevel::SSE41:
+            return writeQuadColorsSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return writeQuadColorsScalar;
+}
+
+// Runs the kernel and records its work in the statistics of the context if
+// there are any
+static void runColorKernel(ColorKernel kernel, FragmentLayout layout, const void* frag_buf, uint32_t used_bytes,
+                           const OutputContext& context, DepthBuffer* depth_buffer) {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        if (context.statistics != nullptr) {
+            uint64_t start = statisticsTimestamp();
+            uint64_t written = kernel(frag_buf, used_bytes, context, depth_buffer);
+            uint64_t elapsed = statisticsTimestamp() - start;
+            uint64_t processed = countFragments(frag_buf, used_bytes, context.fragment_stride, layout);
+
+            PipelineStatistics& stats = *context.statistics;
+            addStatisticAtomic(stats.fragments_processed, processed);
+            addStatisticAtomic(stats.fragments_depth_failed, processed - written);
+            addStatisticAtomic(stats.fragments_written, written);
+            addStatisticAtomic(stats.fragment_ops_ns, elapsed);
+            return;
+        }
+    }
+    kernel(frag_buf, used_bytes, context, depth_buffer);
+}
+
+void processFragmentsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const ColorKernel fragment_kernel = selectFragmentKernel();
+    runColorKernel(fragment_kernel, FragmentLayout::Packed, frag_buf, used_bytes,
+                   *static_cast<const OutputContext*>(output_context), nullptr);
+}
+
+void processFragmentsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const ColorKernel fragment_kernel = selectFragmentKernel();
+    const OutputContext* context = static_cast<const OutputContext*>(output_context);
+    runColorKernel(fragment_kernel, FragmentLayout::Packed, frag_buf, used_bytes, *context, context->depth_buffer);
+}
+
+void processFragmentQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const ColorKernel quad_kernel = selectQuadKernel();
+    runColorKernel(quad_kernel, FragmentLayout::Quads, frag_buf, used_bytes,
+                   *static_cast<const OutputContext*>(output_context), nullptr);
+}
+
+void processFragmentQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    static const ColorKernel quad_kernel = selectQuadKernel();
+    const OutputContext* context = static_cast<const OutputContext*>(output_context);
+    runColorKernel(quad_kernel, FragmentLayout::Quads, frag_buf, used_bytes, *context, context->depth_buffer);
 }
 
-} // namespace cascade
\ No newline at end of file
+} // namespace cascade
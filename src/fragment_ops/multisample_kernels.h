@@ -0,0 +1,86 @@
+#ifndef CASCADE_MULTISAMPLE_KERNELS_H_
+#define CASCADE_MULTISAMPLE_KERNELS_H_
+
+#include <cstdint>
+
+#include <cascade/fragment_ops.h>
+#include <cascade/multisample.h>
+#include <cascade/rasterizer.h>
+
+namespace cascade {
+
+// Writes the shaded color of each covered pixel of the quad to its covered
+// samples, testing their depth first if depth_test is set. Returns the number
+// of pixels that got at least one sample written.
+inline static uint32_t storeQuadSamples(MultisampleBuffer& target, const FragmentQuadHeader& header,
+                                        const float* depths, const uint32_t* pixels, bool depth_test) {
+    // Offsets of the sample depths from the pixel center. Pixel 1 is the right
+    // neighbor of pixel 0 and pixel 2 the one below it.
+    float sample_dz[MSAA_SAMPLE_COUNT];
+    if (depth_test) {
+        const float dz_dx = depths[1] - depths[0];
+        const float dz_dy = depths[2] - depths[0];
+        for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+            sample_dz[s] = (dz_dx * static_cast<float>(MSAA_SAMPLE_POSITIONS[s][0]) +
+                            dz_dy * static_cast<float>(MSAA_SAMPLE_POSITIONS[s][1])) *
+                           (1.0f / 16.0f);
+        }
+    }
+
+    uint32_t written = 0;
+    for (uint32_t k = 0; k < 4; ++k) {
+        const uint32_t samples = header.samples >> (MSAA_SAMPLE_COUNT * k);
+        if ((header.mask & (1 << k)) == 0) {
+            continue;
+        }
+
+        const uint32_t index = multisampleIndex(target, header.x + k % 2, header.y + k / 2);
+        // Pixels inside the triangle have every sample covered
+        if (!depth_test && (samples & 0xF) == 0xF) {
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                target.color[index + s] = pixels[k];
+            }
+            ++written;
+            continue;
+        }
+        bool any_written = false;
+        for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+            if ((samples & (1 << s)) == 0) {
+                continue;
+            }
+            if (depth_test) {
+                float z = depths[k] + sample_dz[s];
+                float& stored = target.depth[index + s];
+                if (!(z <= stored)) {
+                    continue;
+                }
+                stored = z;
+            }
+            target.color[index + s] = pixels[k];
+            any_written = true;
+        }
+        written += any_written;
+    }
+    return written;
+}
+
+// Writes the quads in the buffer to the multisample buffer of the context.
+// Returns the number of pixels written if pipeline statistics are enabled and
+// 0 otherwise.
+using MultisampleKernel = uint32_t (*)(const void* frag_buf, uint32_t used_bytes,
+                                       const MultisampleOutputContext& context, bool depth_test);
+
+uint32_t writeMultisampleQuadsScalar(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                     bool depth_test);
+
+#if defined(CASCADE_X86_SIMD)
+uint32_t writeMultisampleQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                    bool depth_test);
+
+uint32_t writeMultisampleQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                   bool depth_test);
+#endif
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,80 @@
+#include <cascade/fragment_ops.h>
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/color_kernels.h"
+#include "fragment_ops/multisample_kernels.h"
+
+namespace cascade {
+
+uint32_t writeMultisampleQuadsScalar(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                     bool depth_test) {
+    uint32_t quad_size = context.fragment_stride;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += quad_size) {
+        const FragmentQuadHeader* header = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + i);
+        const float* values = float_ptr(char_ptr(frag_buf) + i + sizeof(FragmentQuadHeader));
+        // The attributes follow the depth of the four pixels
+        const float* color_ptr = values + 4;
+
+        uint32_t pixels[4];
+        for (uint32_t k = 0; k < 4; ++k) {
+            pixels[k] = detail::packColor(color_ptr[k], color_ptr[4 + k], color_ptr[8 + k], color_ptr[12 + k]);
+        }
+        addStatistic(written, storeQuadSamples(*context.target, *header, values, pixels, depth_test));
+    }
+    return written;
+}
+
+static MultisampleKernel selectMultisampleKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeMultisampleQuadsAVX2;
+        case SimdLevel::SSE41:
+            return writeMultisampleQuadsSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return writeMultisampleQuadsScalar;
+}
+
+// Same as runColorKernel() in fragment_ops.cpp. Pixels count as written if
+// any of their samples is.
+static void runMultisampleKernel(const void* frag_buf, uint32_t used_bytes, const MultisampleOutputContext& context,
+                                 bool depth_test) {
+    static const MultisampleKernel multisample_kernel = selectMultisampleKernel();
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        if (context.statistics != nullptr) {
+            uint64_t start = statisticsTimestamp();
+            uint64_t written = multisample_kernel(frag_buf, used_bytes, context, depth_test);
+            uint64_t elapsed = statisticsTimestamp() - start;
+            uint64_t processed = countFragments(frag_buf, used_bytes, context.fragment_stride, FragmentLayout::Quads);
+
+            PipelineStatistics& stats = *context.statistics;
+            addStatisticAtomic(stats.fragments_processed, processed);
+            addStatisticAtomic(stats.fragments_depth_failed, processed - written);
+            addStatisticAtomic(stats.fragments_written, written);
+            addStatisticAtomic(stats.fragment_ops_ns, elapsed);
+            return;
+        }
+    }
+    multisample_kernel(frag_buf, used_bytes, context, depth_test);
+}
+
+void processMultisampleQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    runMultisampleKernel(frag_buf, used_bytes, *static_cast<const MultisampleOutputContext*>(output_context), false);
+}
+
+void processMultisampleQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    runMultisampleKernel(frag_buf, used_bytes, *static_cast<const MultisampleOutputContext*>(output_context), true);
+}
+
+} // namespace cascade
@@ -0,0 +1,145 @@
+#ifndef CASCADE_TEXTURE_KERNELS_H_
+#define CASCADE_TEXTURE_KERNELS_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <cascade/depth_buffer.h>
+#include <cascade/fragment_ops.h>
+#include <cascade/texture.h>
+
+namespace cascade {
+
+// Texel coordinates are clamped to this range before they are converted to
+// integers, which keeps the conversion defined for any texture coordinate.
+// Floats of this magnitude are still integers, so wrapping is unaffected.
+constexpr float TEXEL_COORD_LIMIT = 16777216.0f;
+
+// Mip levels a quad samples and the weight of the second one
+struct QuadLevels {
+    uint32_t first;
+    uint32_t second;
+    float blend;
+};
+
+// The level of detail is log2 of the number of texels of level 0 that one
+// pixel step covers along the screen axis that covers more of them. Pixel 1
+// of the quad is the right neighbor of pixel 0 and pixel 2 the one below it.
+// It is computed once per quad, so all kernels share this.
+inline static QuadLevels selectQuadLevels(const Texture& texture, TextureFilter filter, const float* u,
+                                          const float* v) {
+    const float width = static_cast<float>(texture.levels[0].width);
+    const float height = static_cast<float>(texture.levels[0].height);
+    float dudx = (u[1] - u[0]) * width;
+    float dvdx = (v[1] - v[0]) * height;
+    float dudy = (u[2] - u[0]) * width;
+    float dvdy = (v[2] - v[0]) * height;
+    float rho_x = dudx * dudx + dvdx * dvdx;
+    float rho_y = dudy * dudy + dvdy * dvdy;
+    float lod = 0.5f * std::log2(rho_x > rho_y ? rho_x : rho_y);
+
+    // Extrapolated coordinates of uncovered pixels can make it NaN, which
+    // ends up at level 0
+    const float max_lod = static_cast<float>(texture.level_count - 1);
+    if (!(lod > 0.0f)) {
+        lod = 0.0f;
+    }
+    if (lod > max_lod) {
+        lod = max_lod;
+    }
+
+    if (filter == TextureFilter::Bilinear) {
+        uint32_t level = static_cast<uint32_t>(lod + 0.5f);
+        return {level, level, 0.0f};
+    }
+    uint32_t first = static_cast<uint32_t>(lod);
+    uint32_t second = first + 1 < texture.level_count ? first + 1 : first;
+    return {first, second, lod - static_cast<float>(first)};
+}
+
+// Same as min(max(x, -TEXEL_COORD_LIMIT), TEXEL_COORD_LIMIT) with the vector
+// instructions, which return the second operand for NaN
+inline static float clampTexelCoord(float x) {
+    x = x > -TEXEL_COORD_LIMIT ? x : -TEXEL_COORD_LIMIT;
+    return x < TEXEL_COORD_LIMIT ? x : TEXEL_COORD_LIMIT;
+}
+
+// Maps a texel coordinate to [0, size). Sizes are powers of two, so repeating
+// only keeps the low bits.
+inline static uint32_t addressTexel(int32_t i, uint32_t size, TextureAddressMode address_mode) {
+    if (address_mode == TextureAddressMode::Repeat) {
+        return static_cast<uint32_t>(i) & (size - 1);
+    }
+    if (i < 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>(i) < size - 1 ? static_cast<uint32_t>(i) : size - 1;
+}
+
+// Bilinearly filtered channels of the texture at (u, v) in the given level,
+// starting from the least significant byte of the texels. The vectorized
+// kernels do the same operations in the same order, so they give the same
+// results.
+inline static void sampleBilinear(const Texture& texture, uint32_t level, TextureAddressMode address_mode, float u,
+                                  float v, float* channels) {
+    const TextureLevel& l = texture.levels[level];
+    // Texel centers are at half-integer coordinates
+    float x = clampTexelCoord(u * static_cast<float>(l.width) - 0.5f);
+    float y = clampTexelCoord(v * static_cast<float>(l.height) - 0.5f);
+    float x_floor = std::floor(x);
+    float y_floor = std::floor(y);
+    float fx = x - x_floor;
+    float fy = y - y_floor;
+    int32_t ix = static_cast<int32_t>(x_floor);
+    int32_t iy = static_cast<int32_t>(y_floor);
+
+    uint32_t x0 = addressTexel(ix, l.width, address_mode);
+    uint32_t x1 = addressTexel(ix + 1, l.width, address_mode);
+    uint32_t y0 = addressTexel(iy, l.height, address_mode);
+    uint32_t y1 = addressTexel(iy + 1, l.height, address_mode);
+    uint32_t t00 = texture.texels[textureTexelIndex(texture, level, x0, y0)];
+    uint32_t t10 = texture.texels[textureTexelIndex(texture, level, x1, y0)];
+    uint32_t t01 = texture.texels[textureTexelIndex(texture, level, x0, y1)];
+    uint32_t t11 = texture.texels[textureTexelIndex(texture, level, x1, y1)];
+
+    for (uint32_t c = 0; c < 4; ++c) {
+        float c00 = static_cast<float>((t00 >> (8 * c)) & 0xFF);
+        float c10 = static_cast<float>((t10 >> (8 * c)) & 0xFF);
+        float c01 = static_cast<float>((t01 >> (8 * c)) & 0xFF);
+        float c11 = static_cast<float>((t11 >> (8 * c)) & 0xFF);
+        float top = c00 + (c10 - c00) * fx;
+        float bottom = c01 + (c11 - c01) * fx;
+        channels[c] = top + (bottom - top) * fy;
+    }
+}
+
+// Rounds the filtered channels back to a texel
+inline static uint32_t packTexel(const float* channels) {
+    uint32_t texel = 0;
+    for (uint32_t c = 0; c < 4; ++c) {
+        texel |= static_cast<uint32_t>(channels[c] + 0.5f) << (8 * c);
+    }
+    return texel;
+}
+
+// Writes the texture color of the quads in the buffer to the color buffer of
+// the context. Pixels are depth tested first if depth_buffer is set. Returns
+// the number of pixels written if pipeline statistics are enabled and 0
+// otherwise.
+using TextureKernel = uint32_t (*)(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                   DepthBuffer* depth_buffer);
+
+uint32_t writeTexturedQuadsScalar(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                  DepthBuffer* depth_buffer);
+
+#if defined(CASCADE_X86_SIMD)
+uint32_t writeTexturedQuadsSSE41(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                 DepthBuffer* depth_buffer);
+
+uint32_t writeTexturedQuadsAVX2(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                DepthBuffer* depth_buffer);
+#endif
+
+} // namespace cascade
+
+#endif
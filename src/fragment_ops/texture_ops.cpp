@@ -0,0 +1,112 @@
+#include <cascade/fragment_ops.h>
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+#include <cascade/texture.h>
+
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/color_kernels.h"
+#include "fragment_ops/texture_kernels.h"
+
+namespace cascade {
+
+uint32_t writeTexturedQuadsScalar(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                                  DepthBuffer* depth_buffer) {
+    void* color_buf = context.color_buffer;
+    uint32_t quad_size = context.fragment_stride;
+    uint32_t width = context.width;
+    ColorLayout color_layout = context.color_layout;
+    const Texture& texture = *context.texture;
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += quad_size) {
+        const FragmentQuadHeader* header = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + i);
+        const float* values = float_ptr(char_ptr(frag_buf) + i + sizeof(FragmentQuadHeader));
+        // The attributes follow the depth of the four pixels
+        const float* u = values + 4 * (context.texcoord_attribute + 1);
+        const float* v = u + 4;
+
+        uint32_t mask = header->mask;
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((mask & (1 << k)) && depth_buffer != nullptr &&
+                !testFragmentDepth(*depth_buffer, header->x + k % 2, header->y + k / 2, values[k])) {
+                mask &= ~(1 << k);
+            }
+        }
+        if (mask == 0) {
+            continue;
+        }
+
+        QuadLevels levels = selectQuadLevels(texture, context.filter, u, v);
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((mask & (1 << k)) == 0) {
+                continue;
+            }
+            float channels[4];
+            sampleBilinear(texture, levels.first, context.address_mode, u[k], v[k], channels);
+            if (levels.blend != 0.0f) {
+                float second_channels[4];
+                sampleBilinear(texture, levels.second, context.address_mode, u[k], v[k], second_channels);
+                for (uint32_t c = 0; c < 4; ++c) {
+                    channels[c] = channels[c] + (second_channels[c] - channels[c]) * levels.blend;
+                }
+            }
+
+            uint32_t* pixel_ptr =
+                uint32_ptr(color_buf) + colorPixelIndex(color_layout, width, header->x + k % 2, header->y + k / 2);
+            *pixel_ptr = packTexel(channels);
+            addStatistic(written, 1u);
+        }
+    }
+    return written;
+}
+
+static TextureKernel selectTextureKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return writeTexturedQuadsAVX2;
+        case SimdLevel::SSE41:
+            return writeTexturedQuadsSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return writeTexturedQuadsScalar;
+}
+
+// Same as runColorKernel() in fragment_ops.cpp
+static void runTextureKernel(const void* frag_buf, uint32_t used_bytes, const TexturedOutputContext& context,
+                             DepthBuffer* depth_buffer) {
+    static const TextureKernel texture_kernel = selectTextureKernel();
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        if (context.statistics != nullptr) {
+            uint64_t start = statisticsTimestamp();
+            uint64_t written = texture_kernel(frag_buf, used_bytes, context, depth_buffer);
+            uint64_t elapsed = statisticsTimestamp() - start;
+            uint64_t processed = countFragments(frag_buf, used_bytes, context.fragment_stride, FragmentLayout::Quads);
+
+            PipelineStatistics& stats = *context.statistics;
+            addStatisticAtomic(stats.fragments_processed, processed);
+            addStatisticAtomic(stats.fragments_depth_failed, processed - written);
+            addStatisticAtomic(stats.fragments_written, written);
+            addStatisticAtomic(stats.fragment_ops_ns, elapsed);
+            return;
+        }
+    }
+    texture_kernel(frag_buf, used_bytes, context, depth_buffer);
+}
+
+void processTexturedQuadsWithoutDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    runTextureKernel(frag_buf, used_bytes, *static_cast<const TexturedOutputContext*>(output_context), nullptr);
+}
+
+void processTexturedQuadsWithDepth(const void* frag_buf, uint32_t used_bytes, const void* output_context) {
+    const TexturedOutputContext* context = static_cast<const TexturedOutputContext*>(output_context);
+    runTextureKernel(frag_buf, used_bytes, *context, context->depth_buffer);
+}
+
+} // namespace cascade
@@ -0,0 +1,210 @@
+#ifndef CASCADE_TEXTURE_SIMD_H_
+#define CASCADE_TEXTURE_SIMD_H_
+
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+#include <cascade/texture.h>
+
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "fragment_ops/color_simd.h"
+#include "fragment_ops/texture_kernels.h"
+
+namespace cascade {
+
+// Parameters of the mip level sampled by each lane. Quads can select
+// different levels, so these are loaded as vectors.
+template <int LANES>
+struct TextureLevelLanes {
+    alignas(32) float width[LANES];
+    alignas(32) float height[LANES];
+    alignas(32) int32_t offset[LANES];
+    alignas(32) int32_t tiles_x[LANES];
+    alignas(32) int32_t max_x[LANES]; // Width - 1, which is also the mask for repeating
+    alignas(32) int32_t max_y[LANES];
+};
+
+template <int LANES>
+inline static void setQuadLevel(TextureLevelLanes<LANES>& lanes, const Texture& texture, int quad, uint32_t level) {
+    const TextureLevel& l = texture.levels[level];
+    for (int k = 4 * quad; k < 4 * quad + 4; ++k) {
+        lanes.width[k] = static_cast<float>(l.width);
+        lanes.height[k] = static_cast<float>(l.height);
+        lanes.offset[k] = static_cast<int32_t>(l.offset);
+        lanes.tiles_x[k] = static_cast<int32_t>(l.tiles_x);
+        lanes.max_x[k] = static_cast<int32_t>(l.width - 1);
+        lanes.max_y[k] = static_cast<int32_t>(l.height - 1);
+    }
+}
+
+// Same as addressTexel()
+template <typename Ops>
+inline static typename Ops::VecI addressTexelsSimd(typename Ops::VecI i, typename Ops::VecI max,
+                                                   TextureAddressMode address_mode) {
+    if (address_mode == TextureAddressMode::Repeat) {
+        return Ops::andi(i, max);
+    }
+    return Ops::mini(Ops::maxi(i, Ops::set1i(0)), max);
+}
+
+// Same as textureTexelIndex()
+template <typename Ops>
+inline static typename Ops::VecI texelIndicesSimd(typename Ops::VecI offset, typename Ops::VecI tiles_x,
+                                                  typename Ops::VecI x, typename Ops::VecI y) {
+    using VecI = typename Ops::VecI;
+    const VecI one = Ops::set1i(1);
+    const VecI two = Ops::set1i(2);
+    VecI tile = Ops::addi(Ops::mullo(Ops::srli(y, 2), tiles_x), Ops::srli(x, 2));
+    VecI morton = Ops::ori(Ops::ori(Ops::andi(x, one), Ops::slli(Ops::andi(y, one), 1)),
+                           Ops::ori(Ops::slli(Ops::andi(x, two), 1), Ops::slli(Ops::andi(y, two), 2)));
+    return Ops::addi(Ops::addi(offset, Ops::slli(tile, 4)), morton);
+}
+
+// Same as sampleBilinear() for every lane
+template <typename Ops>
+inline static void sampleBilinearSimd(const Texture& texture, const TextureLevelLanes<Ops::LANES>& lanes,
+                                      TextureAddressMode address_mode, typename Ops::Vec u, typename Ops::Vec v,
+                                      typename Ops::Vec* channels) {
+    using Vec = typename Ops::Vec;
+    using VecI = typename Ops::VecI;
+    const Vec half = Ops::set1(0.5f);
+    const Vec min_coord = Ops::set1(-TEXEL_COORD_LIMIT);
+    const Vec max_coord = Ops::set1(TEXEL_COORD_LIMIT);
+
+    Vec x = Ops::min(Ops::max(Ops::sub(Ops::mul(u, Ops::load(lanes.width)), half), min_coord), max_coord);
+    Vec y = Ops::min(Ops::max(Ops::sub(Ops::mul(v, Ops::load(lanes.height)), half), min_coord), max_coord);
+    Vec x_floor = Ops::floor(x);
+    Vec y_floor = Ops::floor(y);
+    Vec fx = Ops::sub(x, x_floor);
+    Vec fy = Ops::sub(y, y_floor);
+    VecI ix = Ops::toInt(x_floor);
+    VecI iy = Ops::toInt(y_floor);
+
+    const VecI one = Ops::set1i(1);
+    const VecI max_x = Ops::loadi(lanes.max_x);
+    const VecI max_y = Ops::loadi(lanes.max_y);
+    VecI x0 = addressTexelsSimd<Ops>(ix, max_x, address_mode);
+    VecI x1 = addressTexelsSimd<Ops>(Ops::addi(ix, one), max_x, address_mode);
+    VecI y0 = addressTexelsSimd<Ops>(iy, max_y, address_mode);
+    VecI y1 = addressTexelsSimd<Ops>(Ops::addi(iy, one), max_y, address_mode);
+
+    const VecI offset = Ops::loadi(lanes.offset);
+    const VecI tiles_x = Ops::loadi(lanes.tiles_x);
+    VecI t00 = Ops::gather(texture.texels, texelIndicesSimd<Ops>(offset, tiles_x, x0, y0));
+    VecI t10 = Ops::gather(texture.texels, texelIndicesSimd<Ops>(offset, tiles_x, x1, y0));
+    VecI t01 = Ops::gather(texture.texels, texelIndicesSimd<Ops>(offset, tiles_x, x0, y1));
+    VecI t11 = Ops::gather(texture.texels, texelIndicesSimd<Ops>(offset, tiles_x, x1, y1));
+
+    const VecI byte_mask = Ops::set1i(0xFF);
+    for (int c = 0; c < 4; ++c) {
+        Vec c00 = Ops::toFloat(Ops::andi(Ops::srli(t00, 8 * c), byte_mask));
+        Vec c10 = Ops::toFloat(Ops::andi(Ops::srli(t10, 8 * c), byte_mask));
+        Vec c01 = Ops::toFloat(Ops::andi(Ops::srli(t01, 8 * c), byte_mask));
+        Vec c11 = Ops::toFloat(Ops::andi(Ops::srli(t11, 8 * c), byte_mask));
+        Vec top = Ops::add(c00, Ops::mul(Ops::sub(c10, c00), fx));
+        Vec bottom = Ops::add(c01, Ops::mul(Ops::sub(c11, c01), fx));
+        channels[c] = Ops::add(top, Ops::mul(Ops::sub(bottom, top), fy));
+    }
+}
+
+// Same as packTexel() for every lane
+template <typename Ops>
+inline static typename Ops::VecI packTexelsSimd(const typename Ops::Vec* channels) {
+    using VecI = typename Ops::VecI;
+    const typename Ops::Vec half = Ops::set1(0.5f);
+    VecI texels = Ops::toInt(Ops::add(channels[0], half));
+    for (int c = 1; c < 4; ++c) {
+        texels = Ops::ori(texels, Ops::slli(Ops::toInt(Ops::add(channels[c], half)), 8 * c));
+    }
+    return texels;
+}
+
+// Vectorized textured output shared by the SSE4.1 and AVX2 kernels, with the
+// same requirements on Ops as the color kernels. Each vector covers LANES / 4
+// quads like writeQuadColorsSimd(). The level of detail is still selected per
+// quad with scalar code since it only takes a few operations per quad, and the
+// sampling then works on the parameters of the selected levels loaded per
+// lane.
+template <typename Ops>
+inline static uint32_t writeTexturedQuadsSimd(const void* frag_buf, uint32_t used_bytes,
+                                              const TexturedOutputContext& context, DepthBuffer* depth_buffer) {
+    using Vec = typename Ops::Vec;
+    constexpr int LANES = Ops::LANES;
+    constexpr int QUADS = LANES / 4;
+
+    uint32_t* color_buf = uint32_ptr(context.color_buffer);
+    const uint32_t quad_size = context.fragment_stride;
+    const uint32_t width = context.width;
+    const Texture& texture = *context.texture;
+    // The attributes follow the depth of the four pixels
+    const uint32_t texcoord_offset = 4 * (context.texcoord_attribute + 1);
+
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < used_bytes; i += QUADS * quad_size) {
+        const FragmentQuadHeader* headers[QUADS];
+        const float* values[QUADS];
+        int masks[QUADS];
+        for (int q = 0; q < QUADS; ++q) {
+            // Lanes past the end of the buffer repeat the first quad and are
+            // masked off
+            uint32_t offset = i + q * quad_size < used_bytes ? i + q * quad_size : i;
+            headers[q] = reinterpret_cast<const FragmentQuadHeader*>(char_ptr(frag_buf) + offset);
+            values[q] = float_ptr(char_ptr(frag_buf) + offset + sizeof(FragmentQuadHeader));
+            masks[q] = i + q * quad_size < used_bytes ? static_cast<int>(headers[q]->mask) : 0;
+        }
+
+        if (depth_buffer != nullptr) {
+            testQuadDepths(*depth_buffer, headers, values, masks, QUADS);
+        }
+        int any_covered = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            any_covered |= masks[q];
+        }
+        if (any_covered == 0) {
+            continue;
+        }
+
+        const float* u[QUADS];
+        const float* v[QUADS];
+        TextureLevelLanes<LANES> first;
+        TextureLevelLanes<LANES> second;
+        alignas(32) float blend[LANES];
+        bool blended = false;
+        for (int q = 0; q < QUADS; ++q) {
+            u[q] = values[q] + texcoord_offset;
+            v[q] = u[q] + 4;
+            QuadLevels levels = selectQuadLevels(texture, context.filter, u[q], v[q]);
+            setQuadLevel(first, texture, q, levels.first);
+            setQuadLevel(second, texture, q, levels.second);
+            for (int k = 0; k < 4; ++k) {
+                blend[4 * q + k] = levels.blend;
+            }
+            blended = blended || levels.blend != 0.0f;
+        }
+
+        const Vec u_lanes = Ops::loadQuads(u);
+        const Vec v_lanes = Ops::loadQuads(v);
+        Vec channels[4];
+        sampleBilinearSimd<Ops>(texture, first, context.address_mode, u_lanes, v_lanes, channels);
+        // A blend weight of 0 gives the first level exactly, so the second
+        // level is only sampled if some quad actually needs it
+        if (blended) {
+            Vec second_channels[4];
+            sampleBilinearSimd<Ops>(texture, second, context.address_mode, u_lanes, v_lanes, second_channels);
+            const Vec weight = Ops::load(blend);
+            for (int c = 0; c < 4; ++c) {
+                channels[c] = Ops::add(channels[c], Ops::mul(Ops::sub(second_channels[c], channels[c]), weight));
+            }
+        }
+
+        alignas(32) uint32_t pixels[LANES];
+        Ops::store(pixels, packTexelsSimd<Ops>(channels));
+        addStatistic(written, storeQuadPixels(color_buf, context.color_layout, width, headers, masks, pixels, QUADS));
+    }
+    return written;
+}
+
+} // namespace cascade
+
+#endif
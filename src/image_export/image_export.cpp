@@ -0,0 +1,242 @@
+#include <cascade/image_export.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "color_buffer/resolve_kernels.h"
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+
+namespace cascade {
+
+// Longest header of the image and video formats
+constexpr size_t MAX_HEADER_SIZE = 128;
+
+// Written before every frame of a Y4M file
+constexpr char Y4M_FRAME_HEADER[] = "FRAME\n";
+constexpr size_t Y4M_FRAME_HEADER_SIZE = sizeof(Y4M_FRAME_HEADER) - 1;
+
+static PixelConvertKernel selectConvertKernel(PixelFormat format) {
+    const bool rgb = format == PixelFormat::RGB;
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return rgb ? convertPixelsRGBAVX2 : convertPixelsRGBAAVX2;
+        case SimdLevel::SSE41:
+            return rgb ? convertPixelsRGBSSE41 : convertPixelsRGBASSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return rgb ? convertPixelsRGB : convertPixelsRGBA;
+}
+
+void convertPixels(const uint32_t* src, PixelFormat format, void* dst, uint32_t count) {
+    static const PixelConvertKernel rgb_kernel = selectConvertKernel(PixelFormat::RGB);
+    static const PixelConvertKernel rgba_kernel = selectConvertKernel(PixelFormat::RGBA);
+    (format == PixelFormat::RGB ? rgb_kernel : rgba_kernel)(src, uint8_ptr(dst), count);
+}
+
+inline static uint32_t bytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::RGB ? 3 : 4;
+}
+
+// Converts the rows of the image into consecutive rows of dst
+static void convertImage(const void* pixels, uint32_t width, uint32_t height, uint32_t pitch_bytes, PixelFormat format,
+                         uint8_t* dst) {
+    const size_t row_bytes = static_cast<size_t>(width) * bytesPerPixel(format);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t* row_ptr = uint32_ptr(char_ptr(pixels) + static_cast<size_t>(y) * pitch_bytes);
+        convertPixels(row_ptr, format, dst + y * row_bytes, width);
+    }
+}
+
+// Converts the image to the three planes of a 4:4:4 frame, one after another.
+// Limited range BT.601 in 8-bit fixed point, with the coefficients used by
+// most software encoders.
+static void convertImageYCbCr(const void* pixels, uint32_t width, uint32_t height, uint32_t pitch_bytes, uint8_t* dst) {
+    const size_t plane_size = static_cast<size_t>(width) * height;
+    uint8_t* y_plane = dst;
+    uint8_t* cb_plane = dst + plane_size;
+    uint8_t* cr_plane = dst + 2 * plane_size;
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t* row_ptr = uint32_ptr(char_ptr(pixels) + static_cast<size_t>(y) * pitch_bytes);
+        const size_t row_start = static_cast<size_t>(y) * width;
+        for (uint32_t x = 0; x < width; ++x) {
+            int32_t r = static_cast<int32_t>((row_ptr[x] >> 16) & 0xFF);
+            int32_t g = static_cast<int32_t>((row_ptr[x] >> 8) & 0xFF);
+            int32_t b = static_cast<int32_t>(row_ptr[x] & 0xFF);
+            y_plane[row_start + x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            cb_plane[row_start + x] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr_plane[row_start + x] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+static PixelFormat imagePixelFormat(ImageFormat format) {
+    return format == ImageFormat::PPM || format == ImageFormat::RawRGB ? PixelFormat::RGB : PixelFormat::RGBA;
+}
+
+// Returns the length of the header
+static size_t formatImageHeader(ImageFormat format, uint32_t width, uint32_t height, char* header) {
+    int length = 0;
+    switch (format) {
+        case ImageFormat::PPM:
+            length = std::snprintf(header, MAX_HEADER_SIZE, "P6\n%u %u\n255\n", width, height);
+            break;
+        case ImageFormat::PAM:
+            length = std::snprintf(header, MAX_HEADER_SIZE,
+                                   "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width,
+                                   height);
+            break;
+        case ImageFormat::RawRGB:
+        case ImageFormat::RawRGBA:
+            break;
+    }
+    return static_cast<size_t>(length);
+}
+
+// Fills a buffer of the size of the file and writes it at once
+static bool writeImageBuffered(const char* path, const char* header, size_t header_size, size_t file_size,
+                               const void* pixels, uint32_t width, uint32_t height, uint32_t pitch_bytes,
+                               PixelFormat format) {
+    // Padded by one byte so that empty files don't request zero bytes
+    uint8_t* buffer = static_cast<uint8_t*>(std::malloc(file_size + 1));
+    assert(buffer != nullptr);
+    std::memcpy(buffer, header, header_size);
+    convertImage(pixels, width, height, pitch_bytes, format, buffer + header_size);
+
+    std::FILE* file = std::fopen(path, "wb");
+    bool written = file != nullptr && std::fwrite(buffer, 1, file_size, file) == file_size;
+    if (file != nullptr) {
+        written = std::fclose(file) == 0 && written;
+    }
+    std::free(buffer);
+    return written;
+}
+
+#if defined(__linux__)
+// Converts the pixels straight into the page cache. The file is allocated up
+// front, since running out of space while writing through the mapping would
+// raise SIGBUS instead of returning an error. Returns false if the file can't
+// be mapped, which leaves it to writeImageBuffered().
+static bool writeImageMapped(const char* path, const char* header, size_t header_size, size_t file_size,
+                             const void* pixels, uint32_t width, uint32_t height, uint32_t pitch_bytes,
+                             PixelFormat format) {
+    if (file_size == 0) {
+        return false;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (posix_fallocate(fd, 0, static_cast<off_t>(file_size)) != 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    std::memcpy(mapping, header, header_size);
+    convertImage(pixels, width, height, pitch_bytes, format, uint8_ptr(mapping) + header_size);
+    const bool unmapped = munmap(mapping, file_size) == 0;
+    return close(fd) == 0 && unmapped;
+}
+#endif
+
+bool writeImage(const char* path, ImageFormat format, const void* pixels, uint32_t width, uint32_t height,
+                uint32_t pitch_bytes) {
+    char header[MAX_HEADER_SIZE];
+    const size_t header_size = formatImageHeader(format, width, height, header);
+    const PixelFormat pixel_format = imagePixelFormat(format);
+    const size_t file_size = header_size + static_cast<size_t>(width) * height * bytesPerPixel(pixel_format);
+
+#if defined(__linux__)
+    if (writeImageMapped(path, header, header_size, file_size, pixels, width, height, pitch_bytes, pixel_format)) {
+        return true;
+    }
+#endif
+    return writeImageBuffered(path, header, header_size, file_size, pixels, width, height, pitch_bytes, pixel_format);
+}
+
+VideoWriter openVideoWriter(const char* path, VideoFormat format, uint32_t width, uint32_t height,
+                            uint32_t frame_rate) {
+    VideoWriter writer = {};
+    writer.width = width;
+    writer.height = height;
+    writer.format = format;
+
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    switch (format) {
+        case VideoFormat::Y4M:
+            writer.frame_bytes = Y4M_FRAME_HEADER_SIZE + 3 * pixel_count;
+            break;
+        case VideoFormat::RawRGB:
+            writer.frame_bytes = 3 * pixel_count;
+            break;
+        case VideoFormat::RawRGBA:
+            writer.frame_bytes = 4 * pixel_count;
+            break;
+    }
+    // Padded by one byte so that empty frames don't request zero bytes
+    writer.frame = static_cast<uint8_t*>(std::malloc(writer.frame_bytes + 1));
+    assert(writer.frame != nullptr);
+
+    writer.file = std::fopen(path, "wb");
+    if (writer.file != nullptr && format == VideoFormat::Y4M) {
+        char header[MAX_HEADER_SIZE];
+        int length = std::snprintf(header, MAX_HEADER_SIZE, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height,
+                                   frame_rate);
+        if (std::fwrite(header, 1, static_cast<size_t>(length), writer.file) != static_cast<size_t>(length)) {
+            std::fclose(writer.file);
+            writer.file = nullptr;
+        }
+    }
+    return writer;
+}
+
+bool writeVideoFrame(VideoWriter& writer, const void* pixels, uint32_t pitch_bytes) {
+    if (writer.file == nullptr) {
+        return false;
+    }
+
+    switch (writer.format) {
+        case VideoFormat::Y4M:
+            std::memcpy(writer.frame, Y4M_FRAME_HEADER, Y4M_FRAME_HEADER_SIZE);
+            convertImageYCbCr(pixels, writer.width, writer.height, pitch_bytes, writer.frame + Y4M_FRAME_HEADER_SIZE);
+            break;
+        case VideoFormat::RawRGB:
+            convertImage(pixels, writer.width, writer.height, pitch_bytes, PixelFormat::RGB, writer.frame);
+            break;
+        case VideoFormat::RawRGBA:
+            convertImage(pixels, writer.width, writer.height, pitch_bytes, PixelFormat::RGBA, writer.frame);
+            break;
+    }
+    if (std::fwrite(writer.frame, 1, writer.frame_bytes, writer.file) != writer.frame_bytes) {
+        return false;
+    }
+    ++writer.frame_count;
+    return true;
+}
+
+bool closeVideoWriter(VideoWriter& writer) {
+    const bool closed = writer.file != nullptr && std::fclose(writer.file) == 0;
+    std::free(writer.frame);
+    writer = {};
+    return closed;
+}
+
+} // namespace cascade
@@ -0,0 +1,204 @@
+#include "rasterizer/fragment_pipeline.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "detail/statistics.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// Fill level that tells the consumer that the pipeline is finished
+constexpr uint32_t END_OF_FRAGMENTS = UINT32_MAX;
+
+// Thread that flushes the buffers of one pipeline at a time. It sleeps on the
+// count of started pipelines until startFragmentPipeline() hands it the next
+// one, and increments the count of finished pipelines once it has flushed the
+// last buffer. The pipeline is only written while the thread sleeps, so the
+// counts order it. The producer waits on the consumer rather than on the
+// pipeline, which it is free to destroy as soon as it has been woken.
+struct FragmentConsumer {
+    FragmentPipeline* pipeline = nullptr; // Null tells the thread to exit
+
+    alignas(64) std::atomic<uint32_t> started{0};
+    alignas(64) std::atomic<uint32_t> finished{0};
+
+    std::thread thread;
+};
+
+// Flushes the buffers of the pipeline until the end marker
+static void consumeFragments(FragmentPipeline& pipeline) {
+    uint32_t flushed = 0;
+    uint32_t slot = 0;
+    for (;;) {
+        // Returns once the producer has submitted another buffer
+        pipeline.submitted.wait(flushed, std::memory_order_acquire);
+
+        const PipelineSlot& buffer = pipeline.slots[slot];
+        if (buffer.used_bytes == END_OF_FRAGMENTS) {
+            break;
+        }
+
+        uint64_t start = statisticsTimestamp();
+        buffer.flush(pipeline.buffers + static_cast<size_t>(slot) * pipeline.size_bytes, buffer.used_bytes,
+                     buffer.context);
+        addStatistic(pipeline.flush_ns, statisticsTimestamp() - start);
+
+        slot = slot + 1 == pipeline.buffer_count ? 0 : slot + 1;
+        pipeline.flushed.store(++flushed, std::memory_order_release);
+        pipeline.flushed.notify_one();
+    }
+}
+
+static void runConsumer(FragmentConsumer& consumer) {
+    for (uint32_t pipelines = 0;; ++pipelines) {
+        consumer.started.wait(pipelines, std::memory_order_acquire);
+        if (consumer.pipeline == nullptr) {
+            break;
+        }
+        consumeFragments(*consumer.pipeline);
+        consumer.finished.store(pipelines + 1, std::memory_order_release);
+        consumer.finished.notify_one();
+    }
+}
+
+// Wakes the consumer up for the pipeline or, with a null pipeline, to exit
+static void startConsumer(FragmentConsumer& consumer, FragmentPipeline* pipeline) {
+    consumer.pipeline = pipeline;
+    consumer.started.fetch_add(1, std::memory_order_release);
+    consumer.started.notify_one();
+}
+
+// Consumers that are not running a pipeline. One is only created when all the
+// others are busy, so there are never more than the pipelines running at once.
+// They exit when the program does.
+struct ConsumerPool {
+    std::mutex mutex;
+    std::vector<FragmentConsumer*> idle;
+    size_t created = 0;
+
+    ~ConsumerPool() {
+        assert(idle.size() == created);
+        for (FragmentConsumer* consumer : idle) {
+            startConsumer(*consumer, nullptr);
+            consumer->thread.join();
+            delete consumer;
+        }
+    }
+};
+
+static ConsumerPool& consumerPool() {
+    static ConsumerPool pool;
+    return pool;
+}
+
+static FragmentConsumer* acquireConsumer() {
+    ConsumerPool& pool = consumerPool();
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.idle.empty()) {
+            FragmentConsumer* consumer = pool.idle.back();
+            pool.idle.pop_back();
+            return consumer;
+        }
+        ++pool.created;
+        // Reserved now so that releasing consumers never allocates
+        pool.idle.reserve(pool.created);
+    }
+    FragmentConsumer* consumer = new FragmentConsumer;
+    consumer->thread = std::thread(runConsumer, std::ref(*consumer));
+    return consumer;
+}
+
+static void releaseConsumer(FragmentConsumer* consumer) {
+    ConsumerPool& pool = consumerPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.idle.push_back(consumer);
+}
+
+// Hands the current buffer of the producer over to the consumer without
+// waiting for anything
+static void queueBuffer(FragmentPipeline& pipeline, uint32_t used_bytes) {
+    // Only the producer writes the count, so it can be read without ordering
+    uint32_t submitted = pipeline.submitted.load(std::memory_order_relaxed);
+    pipeline.slots[pipeline.producer_slot] = {used_bytes, pipeline.flush, pipeline.context};
+    pipeline.submitted.store(submitted + 1, std::memory_order_release);
+    pipeline.submitted.notify_one();
+    pipeline.producer_slot = pipeline.producer_slot + 1 == pipeline.buffer_count ? 0 : pipeline.producer_slot + 1;
+}
+
+void startFragmentPipeline(FragmentPipeline& pipeline, const FragmentBufferInfo& fbi, FragmentWriter& writer) {
+    writer.pipeline = nullptr;
+    if (fbi.buffer_count <= 1) {
+        return;
+    }
+    // Every buffer of the ring has to be aligned like the first one
+    assert(fbi.layout != FragmentLayout::Quads || fbi.size_bytes % 16 == 0);
+
+    pipeline.buffers = static_cast<char*>(fbi.buffer);
+    pipeline.buffer_count = fbi.buffer_count;
+    pipeline.size_bytes = fbi.size_bytes;
+    pipeline.slots = static_cast<PipelineSlot*>(std::malloc(fbi.buffer_count * sizeof(PipelineSlot)));
+    assert(pipeline.slots != nullptr);
+    pipeline.flush = fbi.flush;
+    pipeline.context = fbi.context;
+    pipeline.producer_slot = 0;
+    pipeline.submitted.store(0, std::memory_order_relaxed);
+    pipeline.flushed.store(0, std::memory_order_relaxed);
+    pipeline.flush_ns = 0;
+    pipeline.consumer = acquireConsumer();
+    startConsumer(*pipeline.consumer, &pipeline);
+
+    writer.pipeline = &pipeline;
+}
+
+void* submitFragmentBuffer(FragmentPipeline& pipeline, uint32_t used_bytes) {
+    queueBuffer(pipeline, used_bytes);
+
+    // The next buffer is free once the consumer has flushed whatever was
+    // submitted in it one lap of the ring ago
+    uint32_t next = pipeline.submitted.load(std::memory_order_relaxed);
+    uint32_t flushed = pipeline.flushed.load(std::memory_order_acquire);
+    while (next - flushed >= pipeline.buffer_count) {
+        pipeline.flushed.wait(flushed, std::memory_order_acquire);
+        flushed = pipeline.flushed.load(std::memory_order_acquire);
+    }
+    return pipeline.buffers + static_cast<size_t>(pipeline.producer_slot) * pipeline.size_bytes;
+}
+
+void setFragmentTarget(FragmentPipeline& pipeline, void (*flush)(const void*, uint32_t, const void*),
+                       const void* context) {
+    // Only read by the producer, which copies them into every slot it submits
+    pipeline.flush = flush;
+    pipeline.context = context;
+}
+
+void finishFragmentPipeline(FragmentPipeline& pipeline, FragmentWriter& writer) {
+    if (writer.pipeline == nullptr) {
+        return;
+    }
+    assert(writer.used_bytes == 0);
+
+    // The consumer is done after flushing everything queued before the
+    // marker, which takes the place of the buffer the writer holds
+    queueBuffer(pipeline, END_OF_FRAGMENTS);
+    FragmentConsumer& consumer = *pipeline.consumer;
+    const uint32_t started = consumer.started.load(std::memory_order_relaxed);
+    for (uint32_t finished = consumer.finished.load(std::memory_order_acquire); finished != started;
+         finished = consumer.finished.load(std::memory_order_acquire)) {
+        consumer.finished.wait(finished, std::memory_order_acquire);
+    }
+    releaseConsumer(pipeline.consumer);
+
+    addStatistic(writer.statistics->flush_ns, pipeline.flush_ns);
+    std::free(pipeline.slots);
+    writer.pipeline = nullptr;
+}
+
+} // namespace cascade
@@ -0,0 +1,70 @@
+#ifndef CASCADE_FRAGMENT_PIPELINE_H_
+#define CASCADE_FRAGMENT_PIPELINE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <cascade/rasterizer.h>
+#include <cascade/statistics.h>
+
+namespace cascade {
+
+struct FragmentWriter;
+struct FragmentConsumer;
+
+// Buffer of the ring as submitted by the rasterizer, with the callback that
+// was current when it was filled
+struct PipelineSlot {
+    uint32_t used_bytes;
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
+    const void* context;
+};
+
+// Runs the flush callback on a consumer thread while the rasterizer fills the
+// next fragment buffer. The buffers form a ring that is used in order by the
+// rasterizer, which is the only producer, and then by the consumer, so the
+// callback sees the buffers in the same order as with synchronous flushing.
+//
+// The two threads only share the counts of submitted and flushed buffers,
+// which make a lock-free single-producer single-consumer queue. The counts
+// wrap around, only their differences matter. Consumer threads outlive the
+// pipelines: they are taken from a pool when a pipeline starts and sleep in it
+// again once the pipeline is finished, so rasterizing doesn't start threads.
+struct FragmentPipeline {
+    char* buffers;
+    uint32_t buffer_count;
+    uint32_t size_bytes;
+    PipelineSlot* slots;
+    // Callback for the buffers submitted from now on, see setFragmentTarget()
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
+    const void* context;
+    uint32_t producer_slot; // Buffer the rasterizer is filling
+
+    alignas(64) std::atomic<uint32_t> submitted;
+    alignas(64) std::atomic<uint32_t> flushed;
+    uint64_t flush_ns; // Only touched by the consumer until the pipeline is finished
+
+    FragmentConsumer* consumer;
+};
+
+// Makes the writer hand its buffers over to a consumer thread if fbi has more
+// than one buffer and leaves it flushing synchronously otherwise
+void startFragmentPipeline(FragmentPipeline& pipeline, const FragmentBufferInfo& fbi, FragmentWriter& writer);
+
+// Queues the fragments in the current buffer of the writer for the consumer
+// and returns the buffer to fill next, waiting until the consumer is done with
+// it
+void* submitFragmentBuffer(FragmentPipeline& pipeline, uint32_t used_bytes);
+
+// Changes the callback that the buffers submitted from now on are flushed
+// with. Buffers already submitted keep the previous one.
+void setFragmentTarget(FragmentPipeline& pipeline, void (*flush)(const void*, uint32_t, const void*),
+                       const void* context);
+
+// Waits until the consumer has flushed every submitted buffer and returns it
+// to the pool. The writer must have been flushed already.
+void finishFragmentPipeline(FragmentPipeline& pipeline, FragmentWriter& writer);
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,166 @@
+#include <cascade/render_context.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "rasterizer/fragment_pipeline.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// Every part of the arena starts on a new cache line
+constexpr size_t ARENA_ALIGNMENT = 64;
+
+inline static size_t alignArena(size_t offset) {
+    return (offset + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+RenderContext createRenderContext(const RenderContextInfo& info) {
+    assert(info.fragment_buffer_count >= 1);
+    assert(info.fragment_buffer_size >= fragmentQuadSize(info.max_attributes));
+
+    RenderContext render_context;
+    render_context.width = info.width;
+    render_context.height = info.height;
+    render_context.max_attributes = info.max_attributes;
+    // Rounded up to whole cache lines so that every buffer is aligned like the
+    // first one
+    render_context.fragment_buffer_size = static_cast<uint32_t>(alignArena(info.fragment_buffer_size));
+    render_context.fragment_buffer_count = info.fragment_buffer_count;
+
+    const size_t pixel_count = static_cast<size_t>(info.width) * info.height;
+    const size_t depth_offset = alignArena(pixel_count * sizeof(uint32_t));
+    const size_t fragment_offset = alignArena(depth_offset + depthBufferBytes(info.width, info.height));
+    const size_t setup_offset = alignArena(
+        fragment_offset + static_cast<size_t>(render_context.fragment_buffer_size) * info.fragment_buffer_count);
+    const size_t A_over_w_offset = alignArena(setup_offset + SETUP_BATCH_SIZE * sizeof(detail::TriangleSetup));
+    // Padded by one element so that contexts without attributes don't end on
+    // an empty array
+    const size_t arena_bytes =
+        A_over_w_offset + (static_cast<size_t>(SETUP_BATCH_SIZE) * 3 * info.max_attributes + 1) * sizeof(float);
+
+    // malloc() only guarantees the alignment of the fundamental types, so the
+    // start of the arena is aligned by hand
+    render_context.arena = std::malloc(arena_bytes + ARENA_ALIGNMENT - 1);
+    assert(render_context.arena != nullptr);
+    char* base = char_ptr(render_context.arena) +
+                 (alignArena(reinterpret_cast<uintptr_t>(render_context.arena)) -
+                  reinterpret_cast<uintptr_t>(render_context.arena));
+
+    render_context.color_buffer = uint32_ptr(base);
+    render_context.depth_buffer = placeDepthBuffer(base + depth_offset, info.width, info.height);
+    render_context.fragment_buffers = base + fragment_offset;
+    render_context.setups = reinterpret_cast<detail::TriangleSetup*>(base + setup_offset);
+    render_context.A_over_w = float_ptr(base + A_over_w_offset);
+
+    return render_context;
+}
+
+void destroyRenderContext(RenderContext& render_context) {
+    std::free(render_context.arena);
+    render_context = {};
+}
+
+void clearRenderContext(RenderContext& render_context, uint32_t color, float depth) {
+    const size_t pixel_count = static_cast<size_t>(render_context.width) * render_context.height;
+    for (size_t i = 0; i < pixel_count; ++i) {
+        render_context.color_buffer[i] = color;
+    }
+    clearDepthBuffer(render_context.depth_buffer, depth);
+}
+
+CommandBuffer createCommandBuffer(uint32_t draw_capacity) {
+    CommandBuffer command_buffer;
+    command_buffer.draw_count = 0;
+    command_buffer.draw_capacity = draw_capacity;
+
+    // Padded by one element so that empty buffers don't request zero bytes
+    command_buffer.draws =
+        static_cast<DrawCommand*>(std::malloc((static_cast<size_t>(draw_capacity) + 1) * sizeof(DrawCommand)));
+    assert(command_buffer.draws != nullptr);
+
+    return command_buffer;
+}
+
+void destroyCommandBuffer(CommandBuffer& command_buffer) {
+    std::free(command_buffer.draws);
+    command_buffer = {};
+}
+
+void resetCommandBuffer(CommandBuffer& command_buffer) {
+    command_buffer.draw_count = 0;
+}
+
+void recordDraw(CommandBuffer& command_buffer, const DrawCommand& draw) {
+    if (command_buffer.draw_count == command_buffer.draw_capacity) {
+        uint32_t capacity = command_buffer.draw_capacity > 0 ? command_buffer.draw_capacity * 2 : 1;
+        command_buffer.draws = static_cast<DrawCommand*>(
+            std::realloc(command_buffer.draws, (static_cast<size_t>(capacity) + 1) * sizeof(DrawCommand)));
+        assert(command_buffer.draws != nullptr);
+        command_buffer.draw_capacity = capacity;
+    }
+    command_buffer.draws[command_buffer.draw_count++] = draw;
+}
+
+void executeCommandBuffer(const CommandBuffer& command_buffer, RenderContext& render_context,
+                          PipelineStatistics* statistics) {
+    const ViewportBounds bounds = {
+        {0, 0}, {static_cast<int32_t>(render_context.width) - 1, static_cast<int32_t>(render_context.height) - 1}};
+
+    // The writer and the flush thread live for the whole command buffer. The
+    // writer gets its callback from the first draw.
+    const FragmentBufferInfo fbi = {render_context.fragment_buffers, render_context.fragment_buffer_size, nullptr,
+                                    nullptr, FragmentLayout::Packed, render_context.fragment_buffer_count};
+    PipelineStatistics stats = {};
+    FragmentWriter writer = makeFragmentWriter(fbi, 0, nullptr, stats);
+    FragmentPipeline pipeline;
+    startFragmentPipeline(pipeline, fbi, writer);
+
+    for (uint32_t i = 0; i < command_buffer.draw_count; ++i) {
+        const DrawCommand& draw = command_buffer.draws[i];
+        const uint32_t num_attributes = (draw.stride_bytes - detail::VERTEX_COORD_SIZE) / sizeof(float);
+        const uint32_t fragment_stride = fragmentStride(draw.layout, num_attributes);
+        assert(num_attributes <= render_context.max_attributes);
+
+        // Fragments already in the buffer have to reach the callback they
+        // were emitted for
+        if (draw.flush != writer.flush || draw.context != writer.context || draw.layout != writer.layout ||
+            fragment_stride != writer.fragment_stride) {
+            if (writer.used_bytes > 0) {
+                flushFragments(writer);
+            }
+            writer.fragment_stride = fragment_stride;
+            writer.flush = draw.flush;
+            writer.context = draw.context;
+            writer.layout = draw.layout;
+            if (writer.pipeline != nullptr) {
+                setFragmentTarget(*writer.pipeline, draw.flush, draw.context);
+            }
+        }
+        writer.depth_buffer = draw.depth_test ? &render_context.depth_buffer : nullptr;
+
+        const char* indices =
+            char_ptr(draw.indices) + static_cast<size_t>(draw.first_index) * indexSize(draw.index_type);
+        RasterizerInput input = {draw.vertex_data, indices, draw.index_count, draw.stride_bytes, bounds};
+        input.index_type = draw.index_type;
+        input.topology = draw.topology;
+        input.primitive_restart = draw.primitive_restart;
+        dispatchAttributeCount(num_attributes, [&]<uint32_t NumAttributes>() {
+            rasterizeTriangles<NumAttributes>(input, num_attributes, render_context.setups, render_context.A_over_w,
+                                              writer, stats);
+        });
+    }
+    if (writer.used_bytes > 0) {
+        flushFragments(writer);
+    }
+    finishFragmentPipeline(pipeline, writer);
+
+    if (statistics != nullptr) {
+        accumulateRasterizerStatistics(*statistics, stats);
+    }
+}
+
+} // namespace cascade
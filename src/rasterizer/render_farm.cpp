@@ -0,0 +1,261 @@
+#include <cascade/render_farm.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "detail/ptr_utils.h"
+#include "detail/statistics.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// Every part of the arena starts on a new cache line, so the workers don't
+// share any
+constexpr size_t ARENA_ALIGNMENT = 64;
+
+inline static size_t alignArena(size_t offset) {
+    return (offset + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+// Frames [first, end) that a worker has yet to render. Both are packed into
+// one word, so the worker taking frames from the front and the thieves taking
+// them from the back agree on who gets which frame with a single
+// compare-and-swap. Only the order of the frames is shared between the
+// workers, and the start and the end of a batch are ordered by the counters of
+// RenderFarmState, so relaxed ordering is enough.
+struct alignas(64) FrameQueue {
+    std::atomic<uint64_t> frames;
+};
+
+// The threads of workers 1 to worker_count - 1 sleep on the batch counter
+// until the thread calling renderFrames(), which acts as worker 0, starts a
+// batch by incrementing it. Each of them increments finished once it is done
+// with the batch, and renderFrames() returns once all of them are. The batch
+// is only written while the threads sleep, so the counters order it.
+struct RenderFarmState {
+    const FrameJob* jobs = nullptr;
+    FrameQueue* queues = nullptr;               // One per worker
+    PipelineStatistics* worker_stats = nullptr; // One per worker, overwritten by every batch
+    std::thread* threads = nullptr;             // Of workers 1 to worker_count - 1
+    bool stopping = false;                      // Set instead of starting another batch
+
+    alignas(64) std::atomic<uint32_t> batch{0};
+    alignas(64) std::atomic<uint32_t> finished{0};
+};
+
+inline static uint64_t packFrames(uint32_t first, uint32_t end) {
+    return static_cast<uint64_t>(end) << 32 | first;
+}
+
+// Takes the frame at the front of the queue. Returns false if it is empty.
+static bool takeFrame(FrameQueue& queue, uint32_t& frame) {
+    uint64_t frames = queue.frames.load(std::memory_order_relaxed);
+    while (true) {
+        const uint32_t first = static_cast<uint32_t>(frames);
+        const uint32_t end = static_cast<uint32_t>(frames >> 32);
+        if (first == end) {
+            return false;
+        }
+        if (queue.frames.compare_exchange_weak(frames, packFrames(first + 1, end), std::memory_order_relaxed)) {
+            frame = first;
+            return true;
+        }
+    }
+}
+
+// Moves the back half of the frames left in the queue of another worker, at
+// least one, into the empty queue of worker. Returns false if all the other
+// queues are empty.
+static bool stealFrames(FrameQueue* queues, uint32_t worker_count, uint32_t worker) {
+    for (uint32_t k = 1; k < worker_count; ++k) {
+        FrameQueue& victim = queues[(worker + k) % worker_count];
+        uint64_t frames = victim.frames.load(std::memory_order_relaxed);
+        while (true) {
+            const uint32_t first = static_cast<uint32_t>(frames);
+            const uint32_t end = static_cast<uint32_t>(frames >> 32);
+            if (first == end) {
+                break;
+            }
+            const uint32_t split = end - (end - first + 1) / 2;
+            if (victim.frames.compare_exchange_weak(frames, packFrames(first, split), std::memory_order_relaxed)) {
+                queues[worker].frames.store(packFrames(split, end), std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Rasterizes the frame like rasterize() with the buffers of the worker
+template <uint32_t NumAttributes>
+static void renderFrame(const FrameJob& job, uint32_t num_attributes, const RenderFarm& render_farm,
+                        const RenderFarmWorker& worker, PipelineStatistics& stats) {
+    const FragmentBufferInfo fbi = {worker.fragment_buffer, render_farm.fragment_buffer_size, job.flush, job.context,
+                                    job.layout};
+    FragmentWriter writer = makeFragmentWriter(fbi, num_attributes, job.input.depth_buffer, stats);
+
+    rasterizeTriangles<NumAttributes>(job.input, num_attributes, worker.setups, worker.A_over_w, writer, stats);
+    flushFragments(writer);
+}
+
+// Renders frames of the current batch until there are none left
+static void runFarmWorker(const RenderFarm& render_farm, uint32_t worker) {
+    RenderFarmState& state = *render_farm.state;
+    PipelineStatistics stats = {};
+    while (true) {
+        uint32_t frame;
+        if (!takeFrame(state.queues[worker], frame)) {
+            if (!stealFrames(state.queues, render_farm.worker_count, worker)) {
+                break;
+            }
+            continue;
+        }
+
+        const FrameJob& job = state.jobs[frame];
+        const uint32_t num_attributes = (job.input.stride_bytes - detail::VERTEX_COORD_SIZE) / sizeof(float);
+        assert(num_attributes <= render_farm.max_attributes);
+        if (job.begin != nullptr) {
+            job.begin(job.context);
+        }
+        dispatchAttributeCount(num_attributes, [&]<uint32_t NumAttributes>() {
+            renderFrame<NumAttributes>(job, num_attributes, render_farm, render_farm.workers[worker], stats);
+        });
+    }
+    state.worker_stats[worker] = stats;
+}
+
+// Takes part in every batch until the farm is destroyed. Gets a copy of the
+// farm, which doesn't change after it is created.
+static void runFarmThread(RenderFarm render_farm, uint32_t worker) {
+    RenderFarmState& state = *render_farm.state;
+    uint32_t batch = 0;
+    while (true) {
+        state.batch.wait(batch, std::memory_order_acquire);
+        batch = state.batch.load(std::memory_order_acquire);
+        if (state.stopping) {
+            break;
+        }
+
+        runFarmWorker(render_farm, worker);
+        if (state.finished.fetch_add(1, std::memory_order_acq_rel) + 1 == render_farm.worker_count - 1) {
+            state.finished.notify_one();
+        }
+    }
+}
+
+// Wakes the threads of the workers up for the batch or, with stopping set, to
+// let them return
+static void startBatch(RenderFarmState& state) {
+    state.finished.store(0, std::memory_order_relaxed);
+    state.batch.fetch_add(1, std::memory_order_release);
+    state.batch.notify_all();
+}
+
+RenderFarm createRenderFarm(const RenderFarmInfo& info) {
+    assert(info.worker_count >= 1);
+    assert(info.fragment_buffer_size >= fragmentQuadSize(info.max_attributes));
+
+    RenderFarm render_farm;
+    render_farm.worker_count = info.worker_count;
+    render_farm.max_attributes = info.max_attributes;
+    // Rounded up to whole cache lines so that every buffer is aligned like the
+    // first one
+    render_farm.fragment_buffer_size = static_cast<uint32_t>(alignArena(info.fragment_buffer_size));
+
+    // The workers and the state of the batches, with the queues, statistics
+    // and threads of the workers, are followed by the buffers of each worker.
+    // These are padded by one element so that farms without attributes don't
+    // end on an empty array.
+    const size_t state_offset = alignArena(info.worker_count * sizeof(RenderFarmWorker));
+    const size_t queues_offset = alignArena(state_offset + sizeof(RenderFarmState));
+    const size_t stats_offset = alignArena(queues_offset + info.worker_count * sizeof(FrameQueue));
+    const size_t threads_offset = alignArena(stats_offset + info.worker_count * sizeof(PipelineStatistics));
+    const size_t workers_bytes = alignArena(threads_offset + info.worker_count * sizeof(std::thread));
+    const size_t setup_offset = render_farm.fragment_buffer_size;
+    const size_t A_over_w_offset = alignArena(setup_offset + SETUP_BATCH_SIZE * sizeof(detail::TriangleSetup));
+    const size_t worker_bytes = alignArena(
+        A_over_w_offset + (static_cast<size_t>(SETUP_BATCH_SIZE) * 3 * info.max_attributes + 1) * sizeof(float));
+    const size_t arena_bytes = workers_bytes + worker_bytes * info.worker_count;
+
+    // malloc() only guarantees the alignment of the fundamental types, so the
+    // start of the arena is aligned by hand
+    render_farm.arena = std::malloc(arena_bytes + ARENA_ALIGNMENT - 1);
+    assert(render_farm.arena != nullptr);
+    char* base = char_ptr(render_farm.arena) +
+                 (alignArena(reinterpret_cast<uintptr_t>(render_farm.arena)) -
+                  reinterpret_cast<uintptr_t>(render_farm.arena));
+
+    render_farm.workers = reinterpret_cast<RenderFarmWorker*>(base);
+    for (uint32_t worker = 0; worker < info.worker_count; ++worker) {
+        char* worker_base = base + workers_bytes + worker_bytes * worker;
+        render_farm.workers[worker].fragment_buffer = worker_base;
+        render_farm.workers[worker].setups = reinterpret_cast<detail::TriangleSetup*>(worker_base + setup_offset);
+        render_farm.workers[worker].A_over_w = float_ptr(worker_base + A_over_w_offset);
+    }
+
+    RenderFarmState* state = new (base + state_offset) RenderFarmState;
+    state->queues = reinterpret_cast<FrameQueue*>(base + queues_offset);
+    state->worker_stats = reinterpret_cast<PipelineStatistics*>(base + stats_offset);
+    state->threads = reinterpret_cast<std::thread*>(base + threads_offset);
+    for (uint32_t worker = 0; worker < info.worker_count; ++worker) {
+        new (&state->queues[worker]) FrameQueue{};
+    }
+    render_farm.state = state;
+
+    for (uint32_t worker = 1; worker < info.worker_count; ++worker) {
+        new (&state->threads[worker - 1]) std::thread(runFarmThread, render_farm, worker);
+    }
+
+    return render_farm;
+}
+
+void destroyRenderFarm(RenderFarm& render_farm) {
+    RenderFarmState& state = *render_farm.state;
+    state.stopping = true;
+    startBatch(state);
+    for (uint32_t worker = 1; worker < render_farm.worker_count; ++worker) {
+        state.threads[worker - 1].join();
+        state.threads[worker - 1].~thread();
+    }
+    state.~RenderFarmState();
+
+    std::free(render_farm.arena);
+    render_farm = {};
+}
+
+void renderFrames(RenderFarm& render_farm, const FrameJob* jobs, uint32_t job_count, PipelineStatistics* statistics) {
+    if (job_count == 0) {
+        return;
+    }
+    RenderFarmState& state = *render_farm.state;
+    const uint32_t worker_count = render_farm.worker_count;
+
+    // Every worker starts with its own share of consecutive frames, which is
+    // empty for some of them if there are fewer frames than workers
+    state.jobs = jobs;
+    for (uint32_t worker = 0; worker < worker_count; ++worker) {
+        const uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(job_count) * worker / worker_count);
+        const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(job_count) * (worker + 1) / worker_count);
+        state.queues[worker].frames.store(packFrames(first, end), std::memory_order_relaxed);
+    }
+
+    startBatch(state);
+    runFarmWorker(render_farm, 0);
+    uint32_t finished = state.finished.load(std::memory_order_acquire);
+    while (finished != worker_count - 1) {
+        state.finished.wait(finished, std::memory_order_acquire);
+        finished = state.finished.load(std::memory_order_acquire);
+    }
+
+    if (statistics != nullptr) {
+        for (uint32_t worker = 0; worker < worker_count; ++worker) {
+            accumulateRasterizerStatistics(*statistics, state.worker_stats[worker]);
+        }
+    }
+}
+
+} // namespace cascade
@@ -0,0 +1,77 @@
+#include "rasterizer/span_kernels.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "rasterizer/span_simd.h"
+
+namespace cascade {
+
+struct AVX2Ops {
+    using Vec = __m256;
+    using VecI = __m256i;
+    static constexpr int LANES = 8;
+
+    static Vec set1(float value) { return _mm256_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    // Return b if either operand is NaN, like the scalar comparisons in
+    // clampDepth()
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static Vec toFloat(VecI a) { return _mm256_cvtepi32_ps(a); }
+    static void store(float* dst, Vec a) { _mm256_store_ps(dst, a); }
+
+    static VecI set1i(int32_t value) { return _mm256_set1_epi32(value); }
+    static VecI addi(VecI a, VecI b) { return _mm256_add_epi32(a, b); }
+    static void storei(int32_t* dst, VecI a) { _mm256_store_si256(reinterpret_cast<VecI*>(dst), a); }
+
+    // Lane k holds start + k * step
+    static VecI laneRamp(int32_t start, int32_t step) {
+        VecI lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm256_add_epi32(_mm256_set1_epi32(start), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(step)));
+    }
+
+    // Lanes 4q..4q+3 hold the pixels of quad q, which starts 2q pixels to the
+    // right of start
+    static VecI quadRamp(int32_t start, int32_t step_x, int32_t step_y) {
+        VecI dx = _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3);
+        VecI dy = _mm256_setr_epi32(0, 0, 1, 1, 0, 0, 1, 1);
+        return _mm256_add_epi32(_mm256_set1_epi32(start),
+                                _mm256_add_epi32(_mm256_mullo_epi32(dx, _mm256_set1_epi32(step_x)),
+                                                 _mm256_mullo_epi32(dy, _mm256_set1_epi32(step_y))));
+    }
+
+    // Stores the lanes of the given quad
+    static void storeQuad(float* dst, Vec a, int quad) {
+        _mm_store_ps(dst, quad == 0 ? _mm256_castps256_ps128(a) : _mm256_extractf128_ps(a, 1));
+    }
+
+    static int coverage(VecI e0, VecI e1, VecI e2) {
+        const VecI zero = _mm256_setzero_si256();
+        VecI outside0 = _mm256_cmpgt_epi32(e0, zero);
+        VecI outside1 = _mm256_cmpgt_epi32(e1, zero);
+        VecI outside2 = _mm256_cmpgt_epi32(e2, zero);
+        VecI outside = _mm256_or_si256(_mm256_or_si256(outside0, outside1), outside2);
+        return ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+    }
+};
+
+SpanKernel spanKernelAVX2(uint32_t num_attributes) {
+    SpanKernel kernel = nullptr;
+    dispatchAttributeCount(num_attributes,
+                           [&]<uint32_t NumAttributes>() { kernel = rasterizeSpanSimd<AVX2Ops, NumAttributes>; });
+    return kernel;
+}
+
+QuadKernel quadKernelAVX2(uint32_t num_attributes) {
+    QuadKernel kernel = nullptr;
+    dispatchAttributeCount(num_attributes,
+                           [&]<uint32_t NumAttributes>() { kernel = rasterizeQuadsSimd<AVX2Ops, NumAttributes>; });
+    return kernel;
+}
+
+} // namespace cascade
@@ -0,0 +1,91 @@
+#ifndef CASCADE_SPAN_KERNELS_H_
+#define CASCADE_SPAN_KERNELS_H_
+
+#include <cstdint>
+
+#include <cascade/detail/traversal.h>
+
+#include "detail/ptr_utils.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// Emits the fragments of the covered pixels of the span
+using SpanKernel = void (*)(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                            FragmentWriter& writer);
+
+template <uint32_t NumAttributes>
+void rasterizeSpanScalar(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                         FragmentWriter& writer);
+
+// Emits the quads of the covered pixels of rows span.y and span.y + 1, where
+// span.x0 and span.y are even and span.x1 is odd. Only pixels within clip are
+// considered covered.
+using QuadKernel = void (*)(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                            const detail::PixelRect& clip, FragmentWriter& writer);
+
+template <uint32_t NumAttributes>
+void rasterizeQuadsScalar(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                          const detail::PixelRect& clip, FragmentWriter& writer);
+
+#if defined(CASCADE_X86_SIMD)
+// The vectorized kernels specialized for the attribute count that
+// dispatchAttributeCount() picks for num_attributes
+SpanKernel spanKernelSSE41(uint32_t num_attributes);
+
+SpanKernel spanKernelAVX2(uint32_t num_attributes);
+
+QuadKernel quadKernelSSE41(uint32_t num_attributes);
+
+QuadKernel quadKernelAVX2(uint32_t num_attributes);
+#endif
+
+// Pixels of the quad at (x, y) that lie within the clip rectangle, in the bit
+// order of FragmentQuadHeader::mask
+inline static int quadClipMask(const detail::PixelRect& clip, int x, int y) {
+    int left = x >= clip.min_x && x <= clip.max_x ? 0x5 : 0;
+    int right = x + 1 >= clip.min_x && x + 1 <= clip.max_x ? 0xA : 0;
+    int top = y >= clip.min_y && y <= clip.max_y ? 0x3 : 0;
+    int bottom = y + 1 >= clip.min_y && y + 1 <= clip.max_y ? 0xC : 0;
+    return (left | right) & (top | bottom);
+}
+
+// Samples of the pixel whose edge function values at the center are e that
+// are covered, bit s for sample s
+inline static int sampleCoverage(const detail::TriangleSetup& tri, const int32_t* e) {
+    int samples = 0;
+    for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+        const int32_t* offset = tri.sample_offset[s];
+        if (e[0] + offset[0] <= 0 && e[1] + offset[1] <= 0 && e[2] + offset[2] <= 0) {
+            samples |= 1 << s;
+        }
+    }
+    return samples;
+}
+
+// Every sample of the pixels of a quad that are set in mask, in the bit order
+// of FragmentQuadHeader::samples
+inline static int quadSampleMask(int mask) {
+    static_assert(MSAA_SAMPLE_COUNT == 4);
+    int samples = 0;
+    for (int k = 0; k < 4; ++k) {
+        samples |= mask & (1 << k) ? 0xF << (4 * k) : 0;
+    }
+    return samples;
+}
+
+// Reserves space for a quad record and fills in its header
+inline static char* beginQuad(FragmentWriter& writer, int x, int y, int mask, int samples) {
+    char* quad_ptr = char_ptr(writer.buffer) + writer.used_bytes;
+    FragmentQuadHeader* header = reinterpret_cast<FragmentQuadHeader*>(quad_ptr);
+    header->x = x;
+    header->y = y;
+    header->mask = mask;
+    header->samples = samples;
+    writer.used_bytes += writer.fragment_stride;
+    return quad_ptr;
+}
+
+} // namespace cascade
+
+#endif
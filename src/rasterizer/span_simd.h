@@ -0,0 +1,303 @@
+#ifndef CASCADE_SPAN_SIMD_H_
+#define CASCADE_SPAN_SIMD_H_
+
+#include <cstdint>
+
+#include "detail/ptr_utils.h"
+#include "rasterizer/span_kernels.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// Vectorized span traversal shared by the SSE4.1 and AVX2 kernels. Ops wraps
+// the vector types and operations of one instruction set, so this header must
+// only be included from translation units compiled for that instruction set.
+//
+// Every floating-point operation mirrors the scalar kernel in type and order,
+// so the lanes produce bit-identical results to it.
+template <typename Ops, uint32_t NumAttributes>
+inline static void rasterizeSpanSimd(const detail::TriangleSetup& tri, uint32_t num_attributes,
+                                     const detail::Span& span, FragmentWriter& writer) {
+    using Vec = typename Ops::Vec;
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+    constexpr int ALL_LANES = (1 << LANES) - 1;
+
+    const uint32_t attribute_count = detail::attributeCount<NumAttributes>(num_attributes);
+    const uint32_t fragment_stride = writer.fragment_stride;
+    const float* A_over_w = tri.A_over_w;
+    const int x1 = span.x1;
+    const int y = span.y;
+
+    // Edge function values of the lanes and their change from one group of
+    // lanes to the next
+    VecI e[3];
+    VecI e_step[3];
+    for (int edge = 0; edge < 3; ++edge) {
+        e[edge] = Ops::laneRamp(span.e[edge], tri.step_x[edge]);
+        e_step[edge] = Ops::set1i(LANES * tri.step_x[edge]);
+    }
+
+    const Vec bary_offset[3] = {Ops::set1(tri.bary_offset[0]), Ops::set1(tri.bary_offset[1]),
+                                Ops::set1(tri.bary_offset[2])};
+    const Vec inv_area2 = Ops::set1(tri.inv_area2);
+    const Vec inv_w[3] = {Ops::set1(tri.inv_w[0]), Ops::set1(tri.inv_w[1]), Ops::set1(tri.inv_w[2])};
+    const Vec z_over_w[3] = {Ops::set1(tri.z_over_w[0]), Ops::set1(tri.z_over_w[1]), Ops::set1(tri.z_over_w[2])};
+    const Vec min_z = Ops::set1(tri.min_z);
+    const Vec max_z = Ops::set1(tri.max_z);
+    const Vec one = Ops::set1(1.0f);
+
+    for (int x = span.x0; x <= x1; x += LANES) {
+        VecI e_lanes[3] = {e[0], e[1], e[2]};
+        e[0] = Ops::addi(e[0], e_step[0]);
+        e[1] = Ops::addi(e[1], e_step[1]);
+        e[2] = Ops::addi(e[2], e_step[2]);
+
+        // Bit k of the mask is set if pixel x + k is covered
+        int mask = span.covered ? ALL_LANES : Ops::coverage(e_lanes[0], e_lanes[1], e_lanes[2]);
+        int remaining = x1 - x + 1;
+        if (remaining < LANES) {
+            mask &= (1 << remaining) - 1;
+        }
+        if (mask == 0) {
+            continue;
+        }
+
+        // Screen-space barycentric coordinates, see writeFragment()
+        Vec lambda0 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[1]), bary_offset[1]), inv_area2);
+        Vec lambda1 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[2]), bary_offset[2]), inv_area2);
+        Vec lambda2 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[0]), bary_offset[0]), inv_area2);
+
+        Vec one_over_w_interp =
+            Ops::add(Ops::add(Ops::mul(lambda0, inv_w[0]), Ops::mul(lambda1, inv_w[1])), Ops::mul(lambda2, inv_w[2]));
+        Vec inv_one_over_w_interp = Ops::div(one, one_over_w_interp);
+
+        Vec z_over_w_interp = Ops::add(Ops::add(Ops::mul(lambda0, z_over_w[0]), Ops::mul(lambda1, z_over_w[1])),
+                                       Ops::mul(lambda2, z_over_w[2]));
+        alignas(32) float z[LANES];
+        Ops::store(z, Ops::min(Ops::max(Ops::mul(z_over_w_interp, inv_one_over_w_interp), min_z), max_z));
+
+        // Attributes are only interpolated for fragments that pass the depth
+        // test
+        if (writer.depth_buffer != nullptr) {
+            for (int lane = 0; lane < LANES; ++lane) {
+                if ((mask & (1 << lane)) && !testDepth(writer, x + lane, y, z[lane], span.depth_passes)) {
+                    mask &= ~(1 << lane);
+                }
+            }
+            if (mask == 0) {
+                continue;
+            }
+        }
+
+        int lanes[LANES];
+        int count = 0;
+        for (int lane = 0; lane < LANES; ++lane) {
+            if (mask & (1 << lane)) {
+                lanes[count++] = lane;
+            }
+        }
+
+        // Make space for all covered lanes at once so that none of them gets
+        // flushed before its attributes are written
+        if (writer.used_bytes + count * fragment_stride > writer.size_bytes) {
+            flushFragments(writer);
+        }
+
+        // The buffer cannot hold the whole group, so fall back to emitting the
+        // fragments one at a time
+        if (count * fragment_stride > writer.size_bytes) {
+            alignas(32) int32_t e_values[3][LANES];
+            Ops::storei(e_values[0], e_lanes[0]);
+            Ops::storei(e_values[1], e_lanes[1]);
+            Ops::storei(e_values[2], e_lanes[2]);
+            for (int k = 0; k < count; ++k) {
+                int32_t e_pixel[3] = {e_values[0][lanes[k]], e_values[1][lanes[k]], e_values[2][lanes[k]]};
+                writeFragment<NumAttributes>(tri, num_attributes, e_pixel, x + lanes[k], y, writer);
+            }
+            continue;
+        }
+
+        char* frag_ptrs[LANES];
+        for (int k = 0; k < count; ++k) {
+            char* frag_ptr = char_ptr(writer.buffer) + writer.used_bytes;
+            *uint32_ptr(frag_ptr) = x + lanes[k];
+            *uint32_ptr(frag_ptr + sizeof(uint32_t)) = y;
+            *float_ptr(frag_ptr + 2 * sizeof(uint32_t)) = z[lanes[k]];
+            frag_ptrs[k] = frag_ptr;
+            writer.used_bytes += fragment_stride;
+        }
+
+        for (uint32_t attrib = 0; attrib < attribute_count; ++attrib) {
+            Vec A_over_w_interp = Ops::add(Ops::add(Ops::mul(lambda0, Ops::set1(A_over_w[3 * attrib])),
+                                                    Ops::mul(lambda1, Ops::set1(A_over_w[3 * attrib + 1]))),
+                                           Ops::mul(lambda2, Ops::set1(A_over_w[3 * attrib + 2])));
+            alignas(32) float values[LANES];
+            Ops::store(values, Ops::mul(A_over_w_interp, inv_one_over_w_interp));
+            for (int k = 0; k < count; ++k) {
+                float_ptr(frag_ptrs[k] + FRAGMENT_COORD_SIZE)[attrib] = values[lanes[k]];
+            }
+        }
+    }
+}
+
+// Vectorized quad traversal shared by the SSE4.1 and AVX2 kernels. Every group
+// of four lanes holds one quad, so the vectors are stored straight into the
+// quad records.
+template <typename Ops, uint32_t NumAttributes>
+inline static void rasterizeQuadsSimd(const detail::TriangleSetup& tri, uint32_t num_attributes,
+                                      const detail::Span& span, const detail::PixelRect& clip, FragmentWriter& writer) {
+    using Vec = typename Ops::Vec;
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+    constexpr int QUADS = LANES / 4;
+    constexpr int ALL_LANES = (1 << LANES) - 1;
+
+    const uint32_t attribute_count = detail::attributeCount<NumAttributes>(num_attributes);
+    const uint32_t quad_size = writer.fragment_stride;
+    const float* A_over_w = tri.A_over_w;
+    const int x1 = span.x1;
+    const int y = span.y;
+
+    VecI e[3];
+    VecI e_step[3];
+    VecI sample_offset[MSAA_SAMPLE_COUNT][3];
+    for (int edge = 0; edge < 3; ++edge) {
+        e[edge] = Ops::quadRamp(span.e[edge], tri.step_x[edge], tri.step_y[edge]);
+        e_step[edge] = Ops::set1i(2 * QUADS * tri.step_x[edge]);
+        if (tri.multisample) {
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                sample_offset[s][edge] = Ops::set1i(tri.sample_offset[s][edge]);
+            }
+        }
+    }
+
+    const Vec bary_offset[3] = {Ops::set1(tri.bary_offset[0]), Ops::set1(tri.bary_offset[1]),
+                                Ops::set1(tri.bary_offset[2])};
+    const Vec inv_area2 = Ops::set1(tri.inv_area2);
+    const Vec inv_w[3] = {Ops::set1(tri.inv_w[0]), Ops::set1(tri.inv_w[1]), Ops::set1(tri.inv_w[2])};
+    const Vec z_over_w[3] = {Ops::set1(tri.z_over_w[0]), Ops::set1(tri.z_over_w[1]), Ops::set1(tri.z_over_w[2])};
+    const Vec min_z = Ops::set1(tri.min_z);
+    const Vec max_z = Ops::set1(tri.max_z);
+    const Vec one = Ops::set1(1.0f);
+
+    for (int x = span.x0; x <= x1; x += 2 * QUADS) {
+        VecI e_lanes[3] = {e[0], e[1], e[2]};
+        e[0] = Ops::addi(e[0], e_step[0]);
+        e[1] = Ops::addi(e[1], e_step[1]);
+        e[2] = Ops::addi(e[2], e_step[2]);
+
+        // With multisampling the lanes are tested once for every sample and
+        // a pixel is covered if any of its samples is
+        int coverage = ALL_LANES;
+        int sample_coverage[MSAA_SAMPLE_COUNT] = {};
+        if (tri.multisample) {
+            coverage = 0;
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                sample_coverage[s] = span.covered ? ALL_LANES
+                                                  : Ops::coverage(Ops::addi(e_lanes[0], sample_offset[s][0]),
+                                                                  Ops::addi(e_lanes[1], sample_offset[s][1]),
+                                                                  Ops::addi(e_lanes[2], sample_offset[s][2]));
+                coverage |= sample_coverage[s];
+            }
+        } else if (!span.covered) {
+            coverage = Ops::coverage(e_lanes[0], e_lanes[1], e_lanes[2]);
+        }
+
+        // Bit k of the mask of quad q is set if its pixel k is covered
+        int masks[QUADS];
+        int any_covered = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            int quad_x = x + 2 * q;
+            masks[q] = quad_x <= x1 ? (coverage >> (4 * q)) & quadClipMask(clip, quad_x, y) : 0;
+            any_covered |= masks[q];
+        }
+        if (any_covered == 0) {
+            continue;
+        }
+
+        // Screen-space barycentric coordinates, see writeFragment()
+        Vec lambda0 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[1]), bary_offset[1]), inv_area2);
+        Vec lambda1 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[2]), bary_offset[2]), inv_area2);
+        Vec lambda2 = Ops::mul(Ops::sub(Ops::toFloat(e_lanes[0]), bary_offset[0]), inv_area2);
+
+        Vec one_over_w_interp =
+            Ops::add(Ops::add(Ops::mul(lambda0, inv_w[0]), Ops::mul(lambda1, inv_w[1])), Ops::mul(lambda2, inv_w[2]));
+        Vec inv_one_over_w_interp = Ops::div(one, one_over_w_interp);
+
+        Vec z_over_w_interp = Ops::add(Ops::add(Ops::mul(lambda0, z_over_w[0]), Ops::mul(lambda1, z_over_w[1])),
+                                       Ops::mul(lambda2, z_over_w[2]));
+        Vec z = Ops::min(Ops::max(Ops::mul(z_over_w_interp, inv_one_over_w_interp), min_z), max_z);
+
+        // Attributes are only interpolated for quads with a pixel that passes
+        // the depth test
+        if (writer.depth_buffer != nullptr) {
+            alignas(32) float z_values[LANES];
+            Ops::store(z_values, z);
+            any_covered = 0;
+            for (int q = 0; q < QUADS; ++q) {
+                for (int k = 0; k < 4; ++k) {
+                    if ((masks[q] & (1 << k)) &&
+                        !testDepth(writer, x + 2 * q + k % 2, y + k / 2, z_values[4 * q + k], span.depth_passes)) {
+                        masks[q] &= ~(1 << k);
+                    }
+                }
+                any_covered |= masks[q];
+            }
+            if (any_covered == 0) {
+                continue;
+            }
+        }
+
+        int quads[QUADS];
+        int count = 0;
+        for (int q = 0; q < QUADS; ++q) {
+            if (masks[q] != 0) {
+                quads[count++] = q;
+            }
+        }
+
+        // Write as many of the quads at once as the buffer can hold, which is
+        // all of them unless it is very small
+        for (int first = 0; first < count;) {
+            if (writer.used_bytes + quad_size > writer.size_bytes) {
+                flushFragments(writer);
+            }
+            int batch = static_cast<int>((writer.size_bytes - writer.used_bytes) / quad_size);
+            batch = batch < count - first ? batch : count - first;
+
+            float* values[QUADS] = {};
+            for (int k = 0; k < batch; ++k) {
+                int q = quads[first + k];
+                int samples = 0;
+                if (tri.multisample) {
+                    for (int pixel = 0; pixel < 4; ++pixel) {
+                        for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                            samples |= ((sample_coverage[s] >> (4 * q + pixel)) & 1) << (4 * pixel + s);
+                        }
+                    }
+                    samples &= quadSampleMask(masks[q]);
+                }
+                values[k] =
+                    float_ptr(beginQuad(writer, x + 2 * q, y, masks[q], samples) + sizeof(FragmentQuadHeader));
+                Ops::storeQuad(values[k], z, q);
+            }
+
+            for (uint32_t attrib = 0; attrib < attribute_count; ++attrib) {
+                Vec A_over_w_interp = Ops::add(Ops::add(Ops::mul(lambda0, Ops::set1(A_over_w[3 * attrib])),
+                                                        Ops::mul(lambda1, Ops::set1(A_over_w[3 * attrib + 1]))),
+                                               Ops::mul(lambda2, Ops::set1(A_over_w[3 * attrib + 2])));
+                Vec value = Ops::mul(A_over_w_interp, inv_one_over_w_interp);
+                for (int k = 0; k < batch; ++k) {
+                    Ops::storeQuad(values[k] + 4 * (attrib + 1), value, quads[first + k]);
+                }
+            }
+
+            first += batch;
+        }
+    }
+}
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,69 @@
+#include "rasterizer/span_kernels.h"
+
+#include <cstdint>
+
+#include <smmintrin.h>
+
+#include "rasterizer/span_simd.h"
+
+namespace cascade {
+
+struct SSE41Ops {
+    using Vec = __m128;
+    using VecI = __m128i;
+    static constexpr int LANES = 4;
+
+    static Vec set1(float value) { return _mm_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+    // Return b if either operand is NaN, like the scalar comparisons in
+    // clampDepth()
+    static Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    static Vec toFloat(VecI a) { return _mm_cvtepi32_ps(a); }
+    static void store(float* dst, Vec a) { _mm_store_ps(dst, a); }
+
+    static VecI set1i(int32_t value) { return _mm_set1_epi32(value); }
+    static VecI addi(VecI a, VecI b) { return _mm_add_epi32(a, b); }
+    static void storei(int32_t* dst, VecI a) { _mm_store_si128(reinterpret_cast<VecI*>(dst), a); }
+
+    // Lane k holds start + k * step
+    static VecI laneRamp(int32_t start, int32_t step) {
+        return _mm_add_epi32(_mm_set1_epi32(start), _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(step)));
+    }
+
+    // Lanes hold the pixels of the quad whose top left pixel is start
+    static VecI quadRamp(int32_t start, int32_t step_x, int32_t step_y) {
+        VecI dx = _mm_setr_epi32(0, 1, 0, 1);
+        VecI dy = _mm_setr_epi32(0, 0, 1, 1);
+        return _mm_add_epi32(_mm_set1_epi32(start), _mm_add_epi32(_mm_mullo_epi32(dx, _mm_set1_epi32(step_x)),
+                                                                  _mm_mullo_epi32(dy, _mm_set1_epi32(step_y))));
+    }
+
+    static void storeQuad(float* dst, Vec a, int) { _mm_store_ps(dst, a); }
+
+    static int coverage(VecI e0, VecI e1, VecI e2) {
+        const VecI zero = _mm_setzero_si128();
+        VecI outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(e0, zero), _mm_cmpgt_epi32(e1, zero)),
+                                    _mm_cmpgt_epi32(e2, zero));
+        return ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+    }
+};
+
+SpanKernel spanKernelSSE41(uint32_t num_attributes) {
+    SpanKernel kernel = nullptr;
+    dispatchAttributeCount(num_attributes,
+                           [&]<uint32_t NumAttributes>() { kernel = rasterizeSpanSimd<SSE41Ops, NumAttributes>; });
+    return kernel;
+}
+
+QuadKernel quadKernelSSE41(uint32_t num_attributes) {
+    QuadKernel kernel = nullptr;
+    dispatchAttributeCount(num_attributes,
+                           [&]<uint32_t NumAttributes>() { kernel = rasterizeQuadsSimd<SSE41Ops, NumAttributes>; });
+    return kernel;
+}
+
+} // namespace cascade
@@ -0,0 +1,47 @@
+#include <cascade/tile_history.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+TileHistory createTileHistory(const ViewportBounds& bounds) {
+    TileHistory history = {};
+    history.bounds = bounds;
+
+    // Same tile grid as rasterizeTiled()
+    history.first_tile_x = detail::floorDiv(bounds.top_left.x, detail::TILE_SIZE);
+    history.first_tile_y = detail::floorDiv(bounds.top_left.y, detail::TILE_SIZE);
+    const int tiles_x = detail::floorDiv(bounds.bottom_right.x, detail::TILE_SIZE) - history.first_tile_x + 1;
+    const int tiles_y = detail::floorDiv(bounds.bottom_right.y, detail::TILE_SIZE) - history.first_tile_y + 1;
+    if (tiles_x > 0 && tiles_y > 0) {
+        history.tiles_x = static_cast<uint32_t>(tiles_x);
+        history.tiles_y = static_cast<uint32_t>(tiles_y);
+    }
+
+    // Padded by one element so that empty viewports don't request zero bytes
+    const size_t tile_count = static_cast<size_t>(history.tiles_x) * history.tiles_y;
+    history.hashes = static_cast<uint64_t*>(std::calloc(tile_count + 1, sizeof(uint64_t)));
+    history.dirty_rects = static_cast<ViewportBounds*>(std::malloc((tile_count + 1) * sizeof(ViewportBounds)));
+    assert(history.hashes != nullptr && history.dirty_rects != nullptr);
+
+    return history;
+}
+
+void destroyTileHistory(TileHistory& history) {
+    std::free(history.hashes);
+    std::free(history.dirty_rects);
+    history = {};
+}
+
+void invalidateTileHistory(TileHistory& history) {
+    const size_t tile_count = static_cast<size_t>(history.tiles_x) * history.tiles_y;
+    for (size_t i = 0; i < tile_count; ++i) {
+        history.hashes[i] = 0;
+    }
+}
+
+} // namespace cascade
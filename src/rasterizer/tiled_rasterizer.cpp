@@ -0,0 +1,394 @@
+#include <cascade/rasterizer.h>
+#include <cascade/tile_history.h>
+
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "detail/ptr_utils.h"
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+// State shared by all workers of a single rasterizeTiled() call
+struct TiledRasterizerState {
+    const RasterizerInput* input = nullptr;
+    const FragmentBufferInfo* worker_buffers = nullptr;
+    uint32_t worker_count = 0;
+    uint32_t num_attributes = 0;
+    uint32_t triangle_count = 0;
+
+    detail::TriangleSetup* setups = nullptr;
+    float* A_over_w = nullptr; // 3 * num_attributes values per triangle
+
+    // Tile grid covering the viewport
+    int first_tile_x = 0;
+    int first_tile_y = 0;
+    int tiles_x = 0;
+    int tiles_y = 0;
+    uint32_t tile_count = 0;
+
+    // Number of triangles each worker bins into each tile. Turned into the
+    // write position of the worker within each bin after the counting pass.
+    uint32_t* worker_counts = nullptr;
+    // Bin of tile t spans [bin_offsets[t], bin_offsets[t + 1]) in bins
+    uint32_t* bin_offsets = nullptr;
+    uint32_t* bins = nullptr;
+
+    std::atomic<uint32_t> next_tile{0};
+    std::barrier<> sync;
+
+    PipelineStatistics* worker_stats = nullptr;
+
+    // Only used with input->tile_history
+    uint64_t frame_hash = 0;             // Hash of the settings every tile is drawn with
+    uint64_t* triangle_hashes = nullptr; // One per triangle, see hashTriangle()
+    bool hash_triangle_numbers = false;  // Set if the fragments carry the number of their triangle
+    uint8_t* tiles_redrawn = nullptr;    // Non-zero for the tiles that don't match the history
+};
+
+// Step of the tile hashes. The multiplication by an odd constant spreads the
+// low bits over the whole hash and the shift folds the high bits back in.
+inline static uint64_t mixHash(uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 29);
+}
+
+// Hash of the vertex data of the triangle formed by indices v in their order,
+// which is everything its setup depends on besides the settings in frame_hash
+static uint64_t hashTriangle(const RasterizerInput& input, const uint32_t* v) {
+    const uint32_t words = input.stride_bytes / sizeof(uint32_t);
+    uint64_t hash = 0;
+    for (uint32_t k = 0; k < 3; ++k) {
+        const size_t offset = static_cast<size_t>(v[k]) * input.stride_bytes;
+        const uint32_t* vertex = uint32_ptr(char_ptr(input.vertex_data) + offset);
+        for (uint32_t i = 0; i < words; ++i) {
+            hash = mixHash(hash, vertex[i]);
+        }
+    }
+    return hash;
+}
+
+// Pixels of the tile that lie within the viewport
+static ViewportBounds tileViewportRect(const TiledRasterizerState& state, uint32_t tile) {
+    const ViewportBounds& vb = state.input->bounds;
+    const int32_t min_x = (state.first_tile_x + static_cast<int32_t>(tile % state.tiles_x)) * detail::TILE_SIZE;
+    const int32_t min_y = (state.first_tile_y + static_cast<int32_t>(tile / state.tiles_x)) * detail::TILE_SIZE;
+    const int32_t max_x = min_x + detail::TILE_SIZE - 1;
+    const int32_t max_y = min_y + detail::TILE_SIZE - 1;
+    ViewportBounds rect;
+    rect.top_left.x = min_x > vb.top_left.x ? min_x : vb.top_left.x;
+    rect.top_left.y = min_y > vb.top_left.y ? min_y : vb.top_left.y;
+    rect.bottom_right.x = max_x < vb.bottom_right.x ? max_x : vb.bottom_right.x;
+    rect.bottom_right.y = max_y < vb.bottom_right.y ? max_y : vb.bottom_right.y;
+    return rect;
+}
+
+// Compares the triangles binned into the tile with the previous frame.
+// Returns false if the tile can be skipped, otherwise records the new hash
+// and clears the tile for drawing.
+static bool beginTileRedraw(TiledRasterizerState& state, uint32_t tile) {
+    TileHistory& history = *state.input->tile_history;
+    uint64_t hash = state.frame_hash;
+    for (uint32_t k = state.bin_offsets[tile]; k < state.bin_offsets[tile + 1]; ++k) {
+        hash = mixHash(hash, state.triangle_hashes[state.bins[k]]);
+    }
+    // 0 is reserved for tiles that have to be redrawn
+    hash |= 1;
+    if (history.hashes[tile] == hash) {
+        return false;
+    }
+
+    history.hashes[tile] = hash;
+    state.tiles_redrawn[tile] = 1;
+    if (history.clear != nullptr) {
+        history.clear(tileViewportRect(state, tile), history.context);
+    }
+    return true;
+}
+
+// Merges the redrawn tiles into the dirty rectangles of the history
+static void collectDirtyRects(const TiledRasterizerState& state, TileHistory& history) {
+    history.dirty_count = 0;
+    for (uint32_t tile = 0; tile < state.tile_count; ++tile) {
+        if (!state.tiles_redrawn[tile]) {
+            continue;
+        }
+        ViewportBounds rect = tileViewportRect(state, tile);
+        if (tile % state.tiles_x != 0 && state.tiles_redrawn[tile - 1]) {
+            history.dirty_rects[history.dirty_count - 1].bottom_right.x = rect.bottom_right.x;
+        } else {
+            history.dirty_rects[history.dirty_count++] = rect;
+        }
+    }
+}
+
+inline static bool sameViewport(const ViewportBounds& a, const ViewportBounds& b) {
+    return a.top_left.x == b.top_left.x && a.top_left.y == b.top_left.y && a.bottom_right.x == b.bottom_right.x &&
+           a.bottom_right.y == b.bottom_right.y;
+}
+
+static detail::PixelRect findTileRange(const TiledRasterizerState& state, const detail::PixelRect& bounds) {
+    return {detail::floorDiv(bounds.min_x, detail::TILE_SIZE) - state.first_tile_x,
+            detail::floorDiv(bounds.min_y, detail::TILE_SIZE) - state.first_tile_y,
+            detail::floorDiv(bounds.max_x, detail::TILE_SIZE) - state.first_tile_x,
+            detail::floorDiv(bounds.max_y, detail::TILE_SIZE) - state.first_tile_y};
+}
+
+// Turns the per-worker counts into write positions. Bins are filled in
+// worker order and each worker owns a contiguous range of triangles, so every
+// bin ends up sorted by triangle index, which preserves the submission order
+// within each tile.
+static void computeBinOffsets(TiledRasterizerState& state) {
+    uint32_t total = 0;
+    for (uint32_t tile = 0; tile < state.tile_count; ++tile) {
+        state.bin_offsets[tile] = total;
+        for (uint32_t worker = 0; worker < state.worker_count; ++worker) {
+            uint32_t& count = state.worker_counts[worker * state.tile_count + tile];
+            uint32_t worker_offset = total;
+            total += count;
+            count = worker_offset;
+        }
+    }
+    state.bin_offsets[state.tile_count] = total;
+
+    state.bins = static_cast<uint32_t*>(std::malloc((static_cast<size_t>(total) + 1) * sizeof(uint32_t)));
+    assert(state.bins != nullptr);
+}
+
+template <uint32_t NumAttributes>
+static void runWorker(TiledRasterizerState& state, uint32_t worker) {
+    const RasterizerInput& input = *state.input;
+    const uint32_t num_attributes = state.num_attributes;
+    const uint32_t first_triangle =
+        static_cast<uint32_t>(static_cast<uint64_t>(state.triangle_count) * worker / state.worker_count);
+    const uint32_t last_triangle =
+        static_cast<uint32_t>(static_cast<uint64_t>(state.triangle_count) * (worker + 1) / state.worker_count);
+    uint32_t* counts = state.worker_counts + static_cast<size_t>(worker) * state.tile_count;
+    PipelineStatistics& stats = state.worker_stats[worker];
+
+    // Set up this worker's share of the triangles and count how many of them
+    // land in each tile. Rejected triangles and numbers that don't belong to
+    // a triangle are marked so that the binning pass skips them.
+    const uint64_t setup_start = statisticsTimestamp();
+    detail::PrimitiveAssembler assembler = detail::makePrimitiveAssembler(input.indices, input.index_type,
+                                                                          input.topology, input.primitive_restart,
+                                                                          first_triangle, last_triangle);
+    detail::VertexWindow window = {};
+    uint32_t next_triangle = first_triangle;
+    uint32_t v[3];
+    uint32_t t;
+    while (detail::nextTriangle(assembler, v, t)) {
+        addStatistic(stats.triangles_input, 1);
+        for (; next_triangle <= t; ++next_triangle) {
+            state.setups[next_triangle].bounds = {0, 0, -1, -1};
+        }
+
+        detail::TriangleSetup& tri = state.setups[t];
+        float* A_over_w = state.A_over_w + static_cast<size_t>(3) * num_attributes * t;
+        if (!detail::setupTriangle<NumAttributes>(input, v[0], v[1], v[2], window, num_attributes, A_over_w, tri,
+                                                  stats)) {
+            tri.bounds = {0, 0, -1, -1};
+            continue;
+        }
+        tri.triangle = t;
+        if (state.triangle_hashes != nullptr) {
+            // With FragmentLayout::Visibility the same triangle draws
+            // differently under another number
+            const uint64_t hash = hashTriangle(input, v);
+            state.triangle_hashes[t] = state.hash_triangle_numbers ? mixHash(hash, t) : hash;
+        }
+
+        detail::PixelRect range = findTileRange(state, tri.bounds);
+        for (int ty = range.min_y; ty <= range.max_y; ++ty) {
+            for (int tx = range.min_x; tx <= range.max_x; ++tx) {
+                ++counts[ty * state.tiles_x + tx];
+            }
+        }
+    }
+    for (; next_triangle < last_triangle; ++next_triangle) {
+        state.setups[next_triangle].bounds = {0, 0, -1, -1};
+    }
+    addStatistic(stats.setup_ns, statisticsTimestamp() - setup_start);
+
+    state.sync.arrive_and_wait();
+    if (worker == 0) {
+        computeBinOffsets(state);
+    }
+    state.sync.arrive_and_wait();
+
+    // Fill the bins
+    for (uint32_t t = first_triangle; t < last_triangle; ++t) {
+        const detail::TriangleSetup& tri = state.setups[t];
+        if (tri.bounds.min_x > tri.bounds.max_x) {
+            continue;
+        }
+
+        detail::PixelRect range = findTileRange(state, tri.bounds);
+        for (int ty = range.min_y; ty <= range.max_y; ++ty) {
+            for (int tx = range.min_x; tx <= range.max_x; ++tx) {
+                state.bins[counts[ty * state.tiles_x + tx]++] = t;
+            }
+        }
+    }
+
+    state.sync.arrive_and_wait();
+
+    // Rasterize tiles until there are none left. Tiles are handed out
+    // dynamically since their cost varies wildly with the scene content.
+    // The depth buffer is shared, but its tiles match the screen tiles, so
+    // every part of it is only accessed by one worker. The same goes for the
+    // entries of the tile history.
+    FragmentWriter writer =
+        makeFragmentWriter(state.worker_buffers[worker], num_attributes, input.depth_buffer, stats);
+    FragmentPipeline pipeline;
+    startFragmentPipeline(pipeline, state.worker_buffers[worker], writer);
+    const uint64_t traversal_start = statisticsTimestamp();
+    for (uint32_t tile = state.next_tile.fetch_add(1, std::memory_order_relaxed); tile < state.tile_count;
+         tile = state.next_tile.fetch_add(1, std::memory_order_relaxed)) {
+        if (input.tile_history != nullptr && !beginTileRedraw(state, tile)) {
+            continue;
+        }
+
+        int tile_x = state.first_tile_x + static_cast<int>(tile % state.tiles_x);
+        int tile_y = state.first_tile_y + static_cast<int>(tile / state.tiles_x);
+        detail::PixelRect rect = {tile_x * detail::TILE_SIZE, tile_y * detail::TILE_SIZE,
+                                  tile_x * detail::TILE_SIZE + detail::TILE_SIZE - 1,
+                                  tile_y * detail::TILE_SIZE + detail::TILE_SIZE - 1};
+
+        for (uint32_t k = state.bin_offsets[tile]; k < state.bin_offsets[tile + 1]; ++k) {
+            rasterizeTriangle<NumAttributes>(state.setups[state.bins[k]], num_attributes, rect, writer,
+                                             stats.traversal);
+        }
+    }
+    addStatistic(stats.traversal_ns, statisticsTimestamp() - traversal_start - stats.flush_ns);
+    flushFragments(writer);
+    finishFragmentPipeline(pipeline, writer);
+}
+
+template <uint32_t NumAttributes>
+static void rasterizeTiledTriangles(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers,
+                                    uint32_t worker_count, uint32_t num_attributes) {
+    assert(worker_count > 0);
+    assert(viewportInGuardBand(input.bounds));
+    assert(input.depth_buffer == nullptr || depthBufferCoversViewport(*input.depth_buffer, input.bounds));
+    assert(!input.multisample || input.depth_buffer == nullptr);
+    assert(input.tile_history == nullptr || sameViewport(input.tile_history->bounds, input.bounds));
+    for (uint32_t worker = 0; worker < worker_count; ++worker) {
+        assert(worker_buffers[worker].size_bytes >= fragmentStride(worker_buffers[worker].layout, num_attributes));
+        assert(worker_buffers[worker].layout != FragmentLayout::Quads ||
+               reinterpret_cast<uintptr_t>(worker_buffers[worker].buffer) % 16 == 0);
+        assert(!input.multisample || worker_buffers[worker].layout == FragmentLayout::Quads);
+        assert(worker_buffers[worker].layout != FragmentLayout::Visibility ||
+               (input.bounds.top_left.x >= 0 && input.bounds.top_left.y >= 0));
+    }
+
+    const uint32_t triangle_count = primitiveCount(input.topology, input.index_count);
+    const ViewportBounds& vb = input.bounds;
+
+    TiledRasterizerState state{.sync = std::barrier<>(worker_count)};
+    state.input = &input;
+    state.worker_buffers = worker_buffers;
+    state.worker_count = worker_count;
+    state.num_attributes = num_attributes;
+    state.triangle_count = triangle_count;
+
+    state.first_tile_x = detail::floorDiv(vb.top_left.x, detail::TILE_SIZE);
+    state.first_tile_y = detail::floorDiv(vb.top_left.y, detail::TILE_SIZE);
+    state.tiles_x = detail::floorDiv(vb.bottom_right.x, detail::TILE_SIZE) - state.first_tile_x + 1;
+    state.tiles_y = detail::floorDiv(vb.bottom_right.y, detail::TILE_SIZE) - state.first_tile_y + 1;
+    if (state.tiles_x <= 0 || state.tiles_y <= 0) {
+        state.tiles_x = 0;
+        state.tiles_y = 0;
+    }
+    state.tile_count = static_cast<uint32_t>(state.tiles_x) * static_cast<uint32_t>(state.tiles_y);
+
+    // Allocations are padded by one element so that empty scenes don't
+    // request zero bytes
+    state.setups =
+        static_cast<detail::TriangleSetup*>(std::malloc((triangle_count + 1) * sizeof(detail::TriangleSetup)));
+    state.A_over_w = static_cast<float*>(
+        std::malloc((static_cast<size_t>(3) * num_attributes * triangle_count + 1) * sizeof(float)));
+    state.worker_counts = static_cast<uint32_t*>(
+        std::calloc(static_cast<size_t>(worker_count) * state.tile_count + 1, sizeof(uint32_t)));
+    state.bin_offsets = static_cast<uint32_t*>(std::malloc((state.tile_count + 1) * sizeof(uint32_t)));
+    state.worker_stats = static_cast<PipelineStatistics*>(std::calloc(worker_count, sizeof(PipelineStatistics)));
+    assert(state.setups != nullptr && state.A_over_w != nullptr);
+    assert(state.worker_counts != nullptr && state.bin_offsets != nullptr && state.worker_stats != nullptr);
+    state.bins = nullptr;
+    state.next_tile.store(0, std::memory_order_relaxed);
+
+    state.triangle_hashes = nullptr;
+    state.tiles_redrawn = nullptr;
+    if (input.tile_history != nullptr) {
+        state.frame_hash = mixHash(mixHash(mixHash(0, input.stride_bytes), input.multisample),
+                                   input.depth_buffer != nullptr);
+        for (uint32_t worker = 0; worker < worker_count; ++worker) {
+            state.hash_triangle_numbers |= worker_buffers[worker].layout == FragmentLayout::Visibility;
+        }
+        state.triangle_hashes = static_cast<uint64_t*>(std::malloc((triangle_count + 1) * sizeof(uint64_t)));
+        state.tiles_redrawn = static_cast<uint8_t*>(std::calloc(state.tile_count + 1, sizeof(uint8_t)));
+        assert(state.triangle_hashes != nullptr && state.tiles_redrawn != nullptr);
+    }
+
+    // The calling thread acts as worker 0
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count - 1);
+    for (uint32_t worker = 1; worker < worker_count; ++worker) {
+        threads.emplace_back(runWorker<NumAttributes>, std::ref(state), worker);
+    }
+    runWorker<NumAttributes>(state, 0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (input.statistics != nullptr) {
+        for (uint32_t worker = 0; worker < worker_count; ++worker) {
+            accumulateRasterizerStatistics(*input.statistics, state.worker_stats[worker]);
+        }
+    }
+
+    if (input.tile_history != nullptr) {
+        collectDirtyRects(state, *input.tile_history);
+    }
+
+    std::free(state.tiles_redrawn);
+    std::free(state.triangle_hashes);
+    std::free(state.worker_stats);
+    std::free(state.bins);
+    std::free(state.bin_offsets);
+    std::free(state.worker_counts);
+    std::free(state.A_over_w);
+    std::free(state.setups);
+}
+
+template <uint32_t NumAttributes>
+void rasterizeTiled(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers, uint32_t worker_count) {
+    assert(input.stride_bytes == detail::VERTEX_COORD_SIZE + NumAttributes * sizeof(float));
+    rasterizeTiledTriangles<NumAttributes>(input, worker_buffers, worker_count, NumAttributes);
+}
+
+template void rasterizeTiled<0>(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers,
+                                uint32_t worker_count);
+template void rasterizeTiled<2>(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers,
+                                uint32_t worker_count);
+template void rasterizeTiled<4>(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers,
+                                uint32_t worker_count);
+template void rasterizeTiled<8>(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers,
+                                uint32_t worker_count);
+
+void rasterizeTiled(const RasterizerInput& input, const FragmentBufferInfo* worker_buffers, uint32_t worker_count) {
+    const uint32_t attribute_size = input.stride_bytes - detail::VERTEX_COORD_SIZE;
+    const uint32_t num_attributes = attribute_size / sizeof(float);
+
+    dispatchAttributeCount(num_attributes, [&]<uint32_t NumAttributes>() {
+        rasterizeTiledTriangles<NumAttributes>(input, worker_buffers, worker_count, num_attributes);
+    });
+}
+
+} // namespace cascade
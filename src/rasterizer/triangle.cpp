@@ -0,0 +1,508 @@
+#include "rasterizer/triangle.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include <cascade/common/vec2.h>
+#include <cascade/detail/traversal.h>
+#include <cascade/rasterizer.h>
+
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+#include "rasterizer/span_kernels.h"
+
+namespace cascade {
+
+struct BoundingBox {
+    Vec2<int32_t> top_left;
+    Vec2<int32_t> bottom_right;
+};
+
+inline static int32_t min3(int32_t a, int32_t b, int32_t c) {
+    int32_t result = a;
+    if (b < result) {
+        result = b;
+    }
+    if (c < result) {
+        result = c;
+    }
+    return result;
+}
+
+inline static int32_t max3(int32_t a, int32_t b, int32_t c) {
+    int32_t result = a;
+    if (b > result) {
+        result = b;
+    }
+    if (c > result) {
+        result = c;
+    }
+    return result;
+}
+
+inline static float min3(float a, float b, float c) {
+    float result = a;
+    if (b < result) {
+        result = b;
+    }
+    if (c < result) {
+        result = c;
+    }
+    return result;
+}
+
+inline static float max3(float a, float b, float c) {
+    float result = a;
+    if (b > result) {
+        result = b;
+    }
+    if (c > result) {
+        result = c;
+    }
+    return result;
+}
+
+inline static int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return q - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+inline static int64_t ceilDiv(int64_t a, int64_t b) {
+    return -floorDiv(-a, b);
+}
+
+inline static bool inGuardBand(float x) {
+    // Also rejects NaN
+    return x >= -static_cast<float>(GUARD_BAND) && x < static_cast<float>(GUARD_BAND);
+}
+
+// Snaps a screen-space coordinate to the sub-pixel grid
+inline static int32_t toFixed(float x) {
+    return static_cast<int32_t>(std::lround(x * static_cast<float>(SUBPIXEL_SCALE)));
+}
+
+// Computes the signed area of the parallelogram formed by the edge vector and
+// position vector with respect to the origin. It is the third component of the
+// result of (x-X, y-Y) x (dX, dY) = (0, 0, (y-Y)dX - (x-X)dY) and has the
+// property that it encodes the orientation of the two vectors with respect to
+// each other.
+inline static int64_t edge_function(Vec2<int32_t> origin, Vec2<int32_t> point, int64_t dX, int64_t dY) {
+    return (static_cast<int64_t>(point.x) - origin.x) * dY - (static_cast<int64_t>(point.y) - origin.y) * dX;
+}
+
+// Pixels whose centers lie exactly on an edge are only covered if the edge is
+// a top edge or a left edge, so that triangles sharing the edge cover them
+// exactly once. For the clockwise winding of front faces a top edge is
+// horizontal and points right and a left edge points up.
+inline static bool isTopLeftEdge(int64_t dX, int64_t dY) {
+    return dY < 0 || (dY == 0 && dX > 0);
+}
+
+static BoundingBox findBoundingBox(Vec2<int32_t> v0, Vec2<int32_t> v1, Vec2<int32_t> v2) {
+    return {{min3(v0.x, v1.x, v2.x), min3(v0.y, v1.y, v2.y)}, {max3(v0.x, v1.x, v2.x), max3(v0.y, v1.y, v2.y)}};
+}
+
+// Position of sample s relative to the pixel center on the sub-pixel grid. The
+// positions are exact with at least 4 sub-pixel bits and rounded towards the
+// center with fewer.
+inline static Vec2<int32_t> sampleOffset(uint32_t s) {
+    return {MSAA_SAMPLE_POSITIONS[s][0] * SUBPIXEL_SCALE / 16, MSAA_SAMPLE_POSITIONS[s][1] * SUBPIXEL_SCALE / 16};
+}
+
+// Finds the pixels that have a sample within the bounding box and clips them
+// to the viewport. Samples lie at most reach sub-pixel units away from the
+// pixel center along each axis.
+static detail::PixelRect findPixelBounds(const BoundingBox& bb, const ViewportBounds& vb, int32_t reach) {
+    const int32_t half = SUBPIXEL_SCALE / 2;
+    detail::PixelRect bounds;
+    bounds.min_x = static_cast<int>(ceilDiv(bb.top_left.x - half - reach, SUBPIXEL_SCALE));
+    bounds.min_y = static_cast<int>(ceilDiv(bb.top_left.y - half - reach, SUBPIXEL_SCALE));
+    bounds.max_x = static_cast<int>(floorDiv(bb.bottom_right.x - half + reach, SUBPIXEL_SCALE));
+    bounds.max_y = static_cast<int>(floorDiv(bb.bottom_right.y - half + reach, SUBPIXEL_SCALE));
+
+    bounds.min_x = detail::max2(bounds.min_x, vb.top_left.x);
+    bounds.min_y = detail::max2(bounds.min_y, vb.top_left.y);
+    bounds.max_x = detail::min2(bounds.max_x, vb.bottom_right.x);
+    bounds.max_y = detail::min2(bounds.max_y, vb.bottom_right.y);
+    return bounds;
+}
+
+// Reads the vertex and does the part of the setup that only depends on it
+inline static detail::SetupVertex fetchVertex(const RasterizerInput& input, uint32_t index) {
+    const float* ptr = float_ptr(char_ptr(input.vertex_data) + static_cast<size_t>(input.stride_bytes) * index);
+
+    detail::SetupVertex vertex;
+    vertex.index = index;
+    // Vertices outside of the guard band cannot be represented in fixed point
+    vertex.in_guard_band = inGuardBand(ptr[0]) && inGuardBand(ptr[1]);
+    vertex.position = {0, 0};
+    if (vertex.in_guard_band) {
+        vertex.position = {toFixed(ptr[0]), toFixed(ptr[1])};
+    }
+
+    // Precompute values for perspective-correct divison, z and w are in clip
+    // space
+    vertex.z = ptr[2];
+    vertex.inv_w = 1 / ptr[3];
+    vertex.z_over_w = vertex.z * vertex.inv_w;
+    vertex.attributes = ptr + detail::VERTEX_COORD_SIZE / sizeof(float);
+    return vertex;
+}
+
+// Takes the vertex over from the previous triangle if it has it and fetches
+// it otherwise
+inline static detail::SetupVertex findVertex(const RasterizerInput& input, const detail::VertexWindow& window,
+                                             uint32_t index, PipelineStatistics& stats) {
+    for (uint32_t k = 0; k < window.count; ++k) {
+        if (window.vertices[k].index == index) {
+            return window.vertices[k];
+        }
+    }
+    addStatistic(stats.vertices_fetched, 1);
+    return fetchVertex(input, index);
+}
+
+template <uint32_t NumAttributes>
+bool detail::setupTriangle(const RasterizerInput& input, uint32_t v0_ind, uint32_t v1_ind, uint32_t v2_ind,
+                           detail::VertexWindow& window, uint32_t num_attributes, float* A_over_w,
+                           detail::TriangleSetup& tri, PipelineStatistics& stats) {
+    const detail::SetupVertex v0 = findVertex(input, window, v0_ind, stats);
+    const detail::SetupVertex v1 = findVertex(input, window, v1_ind, stats);
+    const detail::SetupVertex v2 = findVertex(input, window, v2_ind, stats);
+    window = {{v0, v1, v2}, 3};
+
+    if (!v0.in_guard_band || !v1.in_guard_band || !v2.in_guard_band) {
+        addStatistic(stats.triangles_outside_guard_band, 1);
+        return false;
+    }
+
+    Vec2<int32_t> v[3] = {v0.position, v1.position, v2.position};
+
+    // Twice the signed area of the triangle. Needed for the computation
+    // of barycentric coordinates for interpolation
+    int64_t area2 = edge_function(v[0], v[2], static_cast<int64_t>(v[1].x) - v[0].x,
+                                  static_cast<int64_t>(v[1].y) - v[0].y);
+
+    // Front faces have clockwise winding on the screen, which makes the area
+    // negative. Back faces and degenerate triangles cannot cover any pixel
+    // center, so they are culled before anything else is set up.
+    if (area2 >= 0) {
+        addStatistic(area2 == 0 ? stats.triangles_degenerate : stats.triangles_backfacing, 1);
+        return false;
+    }
+
+    // Find and clip the bounding box to the viewport
+    int32_t reach = 0;
+    if (input.multisample) {
+        for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+            Vec2<int32_t> offset = sampleOffset(s);
+            reach = detail::max2(reach, detail::max2(offset.x < 0 ? -offset.x : offset.x,
+                                                     offset.y < 0 ? -offset.y : offset.y));
+        }
+    }
+    tri.bounds = findPixelBounds(findBoundingBox(v[0], v[1], v[2]), input.bounds, reach);
+
+    // The triangle doesn't cover any sample within the viewport
+    if (tri.bounds.min_x > tri.bounds.max_x || tri.bounds.min_y > tri.bounds.max_y) {
+        addStatistic(stats.triangles_empty, 1);
+        return false;
+    }
+
+    // Set up state variables for Pineda's algorithm. The edge functions are
+    // exact multiples of the sub-pixel area unit and change by a multiple of
+    // SUBPIXEL_SCALE from pixel to pixel, so they are stored divided by
+    // SUBPIXEL_SCALE. Rounding the value at the origin up after adding the
+    // fill rule bias keeps the coverage test exact.
+    const Vec2<int32_t> origin_center = {SUBPIXEL_SCALE / 2, SUBPIXEL_SCALE / 2};
+    for (int edge = 0; edge < 3; ++edge) {
+        Vec2<int32_t> from = v[edge];
+        Vec2<int32_t> to = v[(edge + 1) % 3];
+        int64_t dX = static_cast<int64_t>(to.x) - from.x;
+        int64_t dY = static_cast<int64_t>(to.y) - from.y;
+
+        int64_t e = edge_function(from, origin_center, dX, dY);
+        int64_t bias = isTopLeftEdge(dX, dY) ? 0 : 1;
+        int64_t e_scaled = ceilDiv(e + bias, SUBPIXEL_SCALE);
+
+        tri.e_origin[edge] = static_cast<int32_t>(e_scaled);
+        tri.step_x[edge] = static_cast<int32_t>(dY);
+        tri.step_y[edge] = static_cast<int32_t>(-dX);
+        tri.bary_offset[edge] =
+            static_cast<float>(e_scaled * SUBPIXEL_SCALE - e) / static_cast<float>(SUBPIXEL_SCALE);
+
+        // Samples are the same fraction of a pixel away from the center in
+        // every pixel, so their values differ from the value at the center by
+        // a constant that is rounded up the same way
+        tri.sample_min[edge] = 0;
+        tri.sample_max[edge] = 0;
+        if (input.multisample) {
+            for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; ++s) {
+                Vec2<int32_t> offset = sampleOffset(s);
+                Vec2<int32_t> sample = {origin_center.x + offset.x, origin_center.y + offset.y};
+                int64_t sample_scaled = ceilDiv(edge_function(from, sample, dX, dY) + bias, SUBPIXEL_SCALE);
+                int32_t sample_offset = static_cast<int32_t>(sample_scaled - e_scaled);
+                tri.sample_offset[s][edge] = sample_offset;
+                tri.sample_min[edge] = s == 0 ? sample_offset : detail::min2(tri.sample_min[edge], sample_offset);
+                tri.sample_max[edge] = s == 0 ? sample_offset : detail::max2(tri.sample_max[edge], sample_offset);
+            }
+        }
+    }
+    tri.multisample = input.multisample;
+
+    // Precompute the factor for efficiency. The area is scaled down to the
+    // units of the stored edge function values.
+    tri.inv_area2 = 1.0f / (static_cast<float>(area2) / static_cast<float>(SUBPIXEL_SCALE));
+
+    tri.inv_w[0] = v0.inv_w;
+    tri.inv_w[1] = v1.inv_w;
+    tri.inv_w[2] = v2.inv_w;
+
+    tri.z_over_w[0] = v0.z_over_w;
+    tri.z_over_w[1] = v1.z_over_w;
+    tri.z_over_w[2] = v2.z_over_w;
+
+    // Depth range for the depth tests of whole blocks
+    tri.min_z = min3(v0.z, v1.z, v2.z);
+    tri.max_z = max3(v0.z, v1.z, v2.z);
+
+    // Ratio precomputation for the rest of the attributes
+    const uint32_t attribute_count = detail::attributeCount<NumAttributes>(num_attributes);
+    for (uint32_t attrib = 0; attrib < attribute_count; ++attrib) {
+        A_over_w[3 * attrib] = v0.attributes[attrib] * tri.inv_w[0];
+        A_over_w[3 * attrib + 1] = v1.attributes[attrib] * tri.inv_w[1];
+        A_over_w[3 * attrib + 2] = v2.attributes[attrib] * tri.inv_w[2];
+    }
+    tri.A_over_w = A_over_w;
+
+    addStatistic(stats.triangles_rasterized, 1);
+    return true;
+}
+
+template <uint32_t NumAttributes>
+void writeFragment(const detail::TriangleSetup& tri, uint32_t num_attributes, const int32_t* e, int x, int y,
+                   FragmentWriter& writer) {
+    const uint32_t fragment_stride = writer.fragment_stride;
+
+    // Test if the fragment buffer must be flushed to make space
+    if (writer.used_bytes + fragment_stride > writer.size_bytes) {
+        flushFragments(writer);
+    }
+    char* frag_ptr = char_ptr(writer.buffer) + writer.used_bytes;
+
+    // Write pixel coordinates for the fragment
+    *uint32_ptr(frag_ptr) = x;
+    *uint32_ptr(frag_ptr + sizeof(uint32_t)) = y;
+
+    detail::interpolateFragment<NumAttributes>(tri, num_attributes, e, float_ptr(frag_ptr + 2 * sizeof(uint32_t)),
+                                               float_ptr(frag_ptr + FRAGMENT_COORD_SIZE), 1);
+
+    writer.used_bytes += fragment_stride;
+}
+
+template <uint32_t NumAttributes>
+void rasterizeSpanScalar(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                         FragmentWriter& writer) {
+    int32_t e_i[3] = {span.e[0], span.e[1], span.e[2]}; // Contains E(x, y) at the current row and column
+
+    for (int i = span.x0; i <= span.x1; ++i) {
+        // Testing whether pixel is inside the triangle
+        if (span.covered || (e_i[0] <= 0 && e_i[1] <= 0 && e_i[2] <= 0)) {
+            // Attributes are only interpolated for fragments that pass the
+            // depth test
+            if (writer.depth_buffer == nullptr ||
+                testDepth(writer, i, span.y, detail::interpolateDepth(tri, e_i), span.depth_passes)) {
+                writeFragment<NumAttributes>(tri, num_attributes, e_i, i, span.y, writer);
+            }
+        }
+
+        e_i[0] += tri.step_x[0];
+        e_i[1] += tri.step_x[1];
+        e_i[2] += tri.step_x[2];
+    }
+}
+
+template <uint32_t NumAttributes>
+void rasterizeQuadsScalar(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::Span& span,
+                          const detail::PixelRect& clip, FragmentWriter& writer) {
+    const int y = span.y;
+
+    // Edge function values of the pixels of the current quad
+    int32_t e_quad[4][3];
+    for (int edge = 0; edge < 3; ++edge) {
+        e_quad[0][edge] = span.e[edge];
+        e_quad[1][edge] = span.e[edge] + tri.step_x[edge];
+        e_quad[2][edge] = span.e[edge] + tri.step_y[edge];
+        e_quad[3][edge] = span.e[edge] + tri.step_x[edge] + tri.step_y[edge];
+    }
+
+    for (int x = span.x0; x <= span.x1; x += 2) {
+        int mask = quadClipMask(clip, x, y);
+        int samples = 0;
+        if (tri.multisample) {
+            for (int k = 0; k < 4; ++k) {
+                int pixel_samples = span.covered ? 0xF : sampleCoverage(tri, e_quad[k]);
+                if (pixel_samples == 0) {
+                    mask &= ~(1 << k);
+                }
+                samples |= pixel_samples << (4 * k);
+            }
+            samples &= quadSampleMask(mask);
+        } else {
+            for (int k = 0; k < 4; ++k) {
+                bool inside = span.covered || (e_quad[k][0] <= 0 && e_quad[k][1] <= 0 && e_quad[k][2] <= 0);
+                if (!inside) {
+                    mask &= ~(1 << k);
+                }
+            }
+        }
+
+        // Attributes are only interpolated for quads with a pixel that passes
+        // the depth test
+        if (mask != 0 && writer.depth_buffer != nullptr) {
+            for (int k = 0; k < 4; ++k) {
+                if ((mask & (1 << k)) &&
+                    !testDepth(writer, x + k % 2, y + k / 2, detail::interpolateDepth(tri, e_quad[k]),
+                               span.depth_passes)) {
+                    mask &= ~(1 << k);
+                }
+            }
+        }
+
+        if (mask != 0) {
+            if (writer.used_bytes + writer.fragment_stride > writer.size_bytes) {
+                flushFragments(writer);
+            }
+            float* values = float_ptr(beginQuad(writer, x, y, mask, samples) + sizeof(FragmentQuadHeader));
+            for (int k = 0; k < 4; ++k) {
+                detail::interpolateFragment<NumAttributes>(tri, num_attributes, e_quad[k], values + k,
+                                                           values + 4 + k, 4);
+            }
+        }
+
+        for (int k = 0; k < 4; ++k) {
+            e_quad[k][0] += 2 * tri.step_x[0];
+            e_quad[k][1] += 2 * tri.step_x[1];
+            e_quad[k][2] += 2 * tri.step_x[2];
+        }
+    }
+}
+
+// Span kernel for FragmentLayout::Visibility. Only the depth is interpolated,
+// for the early depth test, and the fragments name the triangle instead of
+// carrying its attributes.
+static void rasterizeSpanVisibility(const detail::TriangleSetup& tri, uint32_t, const detail::Span& span,
+                                    FragmentWriter& writer) {
+    int32_t e_i[3] = {span.e[0], span.e[1], span.e[2]};
+
+    for (int i = span.x0; i <= span.x1; ++i) {
+        if (span.covered || (e_i[0] <= 0 && e_i[1] <= 0 && e_i[2] <= 0)) {
+            if (writer.depth_buffer == nullptr ||
+                testDepth(writer, i, span.y, detail::interpolateDepth(tri, e_i), span.depth_passes)) {
+                if (writer.used_bytes + sizeof(VisibilityFragment) > writer.size_bytes) {
+                    flushFragments(writer);
+                }
+                VisibilityFragment* fragment =
+                    reinterpret_cast<VisibilityFragment*>(char_ptr(writer.buffer) + writer.used_bytes);
+                *fragment = {static_cast<uint16_t>(i), static_cast<uint16_t>(span.y), tri.triangle};
+                writer.used_bytes += sizeof(VisibilityFragment);
+            }
+        }
+
+        e_i[0] += tri.step_x[0];
+        e_i[1] += tri.step_x[1];
+        e_i[2] += tri.step_x[2];
+    }
+}
+
+template <uint32_t NumAttributes>
+static SpanKernel selectSpanKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return spanKernelAVX2(NumAttributes);
+        case SimdLevel::SSE41:
+            return spanKernelSSE41(NumAttributes);
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return rasterizeSpanScalar<NumAttributes>;
+}
+
+template <uint32_t NumAttributes>
+static QuadKernel selectQuadKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return quadKernelAVX2(NumAttributes);
+        case SimdLevel::SSE41:
+            return quadKernelSSE41(NumAttributes);
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return rasterizeQuadsScalar<NumAttributes>;
+}
+
+// Emitter of the traversal that turns runs of pixels into fragments in the
+// layout of the fragment buffer
+struct RunEmitter {
+    SpanKernel span_kernel;
+    QuadKernel quad_kernel;
+    uint32_t num_attributes;
+    FragmentWriter& writer;
+
+    bool quads() const {
+        return writer.layout == FragmentLayout::Quads;
+    }
+
+    DepthBuffer* depthBuffer() const {
+        return writer.depth_buffer;
+    }
+
+    uint32_t depthWrites() const {
+        return writer.depth_writes;
+    }
+
+    void emit(const detail::TriangleSetup& tri, const detail::Span& span, const detail::PixelRect& clip) {
+        if (quads()) {
+            quad_kernel(tri, num_attributes, span, clip, writer);
+        } else {
+            span_kernel(tri, num_attributes, span, writer);
+        }
+    }
+};
+
+// The generic instantiation of traverseTriangle(), which goes through the
+// fragment buffer
+template <uint32_t NumAttributes>
+void rasterizeTriangle(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::PixelRect& rect,
+                       FragmentWriter& writer, TraversalStats& stats) {
+    static const SpanKernel span_kernel = selectSpanKernel<NumAttributes>();
+    static const QuadKernel quad_kernel = selectQuadKernel<NumAttributes>();
+
+    RunEmitter emitter = {writer.layout == FragmentLayout::Visibility ? rasterizeSpanVisibility : span_kernel,
+                          quad_kernel, num_attributes, writer};
+    detail::traverseTriangle(tri, rect, emitter, stats);
+}
+
+// Instantiates the functions used by the rest of the rasterizer for every
+// attribute count handled by dispatchAttributeCount()
+#define CASCADE_INSTANTIATE_TRIANGLE(N)                                                                              \
+    template bool detail::setupTriangle<N>(const RasterizerInput& input, uint32_t v0_ind, uint32_t v1_ind,           \
+                                           uint32_t v2_ind, detail::VertexWindow& window, uint32_t num_attributes,   \
+                                           float* A_over_w, detail::TriangleSetup& tri, PipelineStatistics& stats);  \
+    template void writeFragment<N>(const detail::TriangleSetup& tri, uint32_t num_attributes, const int32_t* e,      \
+                                   int x, int y, FragmentWriter& writer);                                            \
+    template void rasterizeTriangle<N>(const detail::TriangleSetup& tri, uint32_t num_attributes,                    \
+                                       const detail::PixelRect& rect, FragmentWriter& writer, TraversalStats& stats);
+
+CASCADE_INSTANTIATE_TRIANGLE(0)
+CASCADE_INSTANTIATE_TRIANGLE(2)
+CASCADE_INSTANTIATE_TRIANGLE(4)
+CASCADE_INSTANTIATE_TRIANGLE(8)
+CASCADE_INSTANTIATE_TRIANGLE(detail::DYNAMIC_ATTRIBUTES)
+
+#undef CASCADE_INSTANTIATE_TRIANGLE
+
+} // namespace cascade
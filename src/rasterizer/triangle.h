@@ -0,0 +1,149 @@
+#ifndef CASCADE_TRIANGLE_H_
+#define CASCADE_TRIANGLE_H_
+
+#include <cstdint>
+
+#include <cascade/common/vec2.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/multisample.h>
+#include <cascade/detail/primitive_assembly.h>
+#include <cascade/detail/triangle_setup.h>
+#include <cascade/rasterizer.h>
+
+#include "detail/statistics.h"
+#include "rasterizer/fragment_pipeline.h"
+
+namespace cascade {
+
+constexpr uint32_t FRAGMENT_COORD_SIZE = 2 * sizeof(uint32_t) + sizeof(float); // (x, y, z)
+
+// Vertex positions are snapped to a fixed-point grid with SUBPIXEL_BITS
+// fractional bits before the edge functions are set up
+constexpr int SUBPIXEL_BITS = CASCADE_SUBPIXEL_BITS;
+constexpr int32_t SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+
+// Calls f.template operator()<NumAttributes>() with the specialization for the
+// given attribute count
+template <typename F>
+inline static void dispatchAttributeCount(uint32_t num_attributes, F&& f) {
+    switch (num_attributes) {
+        case 0:
+            f.template operator()<0>();
+            break;
+        case 2:
+            f.template operator()<2>();
+            break;
+        case 4:
+            f.template operator()<4>();
+            break;
+        case 8:
+            f.template operator()<8>();
+            break;
+        default:
+            f.template operator()<detail::DYNAMIC_ATTRIBUTES>();
+            break;
+    }
+}
+
+// Accumulates fragments and hands them over to the flush callback whenever the
+// buffer cannot fit another fragment. If there is a depth buffer, fragments
+// are only written after passing the depth test.
+struct FragmentWriter {
+    void* buffer;
+    uint32_t size_bytes;
+    uint32_t used_bytes;
+    uint32_t fragment_stride; // Size of a quad record with FragmentLayout::Quads
+    void (*flush)(const void* buffer, uint32_t used_bytes, const void* context);
+    const void* context;
+    FragmentLayout layout;
+    DepthBuffer* depth_buffer;
+    uint32_t depth_writes; // Tells the traversal which depth ranges must be refreshed
+    PipelineStatistics* statistics;
+    FragmentPipeline* pipeline; // Set if buffers are flushed on another thread
+};
+
+// Size of a fragment, or of a quad record with FragmentLayout::Quads
+inline static uint32_t fragmentStride(FragmentLayout layout, uint32_t num_attributes) {
+    if (layout == FragmentLayout::Quads) {
+        return fragmentQuadSize(num_attributes);
+    } else if (layout == FragmentLayout::Visibility) {
+        return sizeof(VisibilityFragment);
+    }
+    return FRAGMENT_COORD_SIZE + num_attributes * static_cast<uint32_t>(sizeof(float));
+}
+
+inline static FragmentWriter makeFragmentWriter(const FragmentBufferInfo& fbi, uint32_t num_attributes,
+                                                DepthBuffer* depth_buffer, PipelineStatistics& stats) {
+    const uint32_t fragment_stride = fragmentStride(fbi.layout, num_attributes);
+    return {fbi.buffer, fbi.size_bytes, 0, fragment_stride, fbi.flush, fbi.context, fbi.layout, depth_buffer, 0,
+            &stats,     nullptr};
+}
+
+inline static void flushFragments(FragmentWriter& writer) {
+    if constexpr (PIPELINE_STATISTICS_ENABLED) {
+        PipelineStatistics& stats = *writer.statistics;
+        ++stats.flush_calls;
+        stats.flush_bytes += writer.used_bytes;
+        stats.fragments_emitted +=
+            countFragments(writer.buffer, writer.used_bytes, writer.fragment_stride, writer.layout);
+    }
+    if (writer.pipeline != nullptr) {
+        // The consumer measures the time it spends in the callback itself
+        writer.buffer = submitFragmentBuffer(*writer.pipeline, writer.used_bytes);
+    } else {
+        uint64_t start = statisticsTimestamp();
+        writer.flush(writer.buffer, writer.used_bytes, writer.context);
+        addStatistic(writer.statistics->flush_ns, statisticsTimestamp() - start);
+    }
+    writer.used_bytes = 0;
+}
+
+// Early depth test of pixel (x, y). Stores the depth and returns true if the
+// fragment is closer than the stored depth or already known to be.
+inline static bool testDepth(FragmentWriter& writer, int x, int y, float z, bool passes) {
+    float& stored = writer.depth_buffer->depth[depthBufferIndex(*writer.depth_buffer, x, y)];
+    if (passes || z < stored) {
+        stored = z;
+        ++writer.depth_writes;
+        return true;
+    }
+    return false;
+}
+
+// The depth buffer is addressed with the pixel coordinates, so it has to cover
+// the whole viewport
+inline static bool depthBufferCoversViewport(const DepthBuffer& depth_buffer, const ViewportBounds& vb) {
+    return vb.top_left.x >= 0 && vb.top_left.y >= 0 && vb.bottom_right.x < static_cast<int64_t>(depth_buffer.width) &&
+           vb.bottom_right.y < static_cast<int64_t>(depth_buffer.height);
+}
+
+// Number of triangles that rasterizeTriangles() sets up at a time
+constexpr uint32_t SETUP_BATCH_SIZE = 64;
+
+// The functions below are instantiated for the attribute counts handled by
+// dispatchAttributeCount(). num_attributes is only read by the
+// DYNAMIC_ATTRIBUTES versions.
+
+// Interpolates the attributes of the triangle at pixel (x, y) whose edge
+// function values are e and appends the resulting fragment to the writer
+template <uint32_t NumAttributes>
+void writeFragment(const detail::TriangleSetup& tri, uint32_t num_attributes, const int32_t* e, int x, int y,
+                   FragmentWriter& writer);
+
+// Emits the fragments of the triangle that fall within the given rectangle
+template <uint32_t NumAttributes>
+void rasterizeTriangle(const detail::TriangleSetup& tri, uint32_t num_attributes, const detail::PixelRect& rect,
+                       FragmentWriter& writer, TraversalStats& stats);
+
+// Emits the fragments of all the triangles of the input without flushing the
+// writer at the end. setups and A_over_w are scratch space for one batch of
+// triangles. A_over_w holds the precomputed values for perspective-correct
+// interpolation, so it must have space for SETUP_BATCH_SIZE * 3 *
+// num_attributes values.
+template <uint32_t NumAttributes>
+void rasterizeTriangles(const RasterizerInput& input, uint32_t num_attributes, detail::TriangleSetup* setups,
+                        float* A_over_w, FragmentWriter& writer, PipelineStatistics& stats);
+
+} // namespace cascade
+
+#endif
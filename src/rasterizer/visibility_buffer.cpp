@@ -0,0 +1,145 @@
+#include <cascade/visibility_buffer.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "rasterizer/triangle.h"
+
+namespace cascade {
+
+VisibilityBuffer createVisibilityBuffer(uint32_t width, uint32_t height) {
+    VisibilityBuffer visibility_buffer;
+    visibility_buffer.width = width;
+    visibility_buffer.height = height;
+
+    // Padded by one element so that empty buffers don't request zero bytes
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    visibility_buffer.triangles = static_cast<uint32_t*>(std::malloc((pixel_count + 1) * sizeof(uint32_t)));
+    assert(visibility_buffer.triangles != nullptr);
+
+    return visibility_buffer;
+}
+
+void destroyVisibilityBuffer(VisibilityBuffer& visibility_buffer) {
+    std::free(visibility_buffer.triangles);
+    visibility_buffer = {};
+}
+
+void clearVisibilityBuffer(VisibilityBuffer& visibility_buffer) {
+    const size_t pixel_count = static_cast<size_t>(visibility_buffer.width) * visibility_buffer.height;
+    for (size_t i = 0; i < pixel_count; ++i) {
+        visibility_buffer.triangles[i] = NO_TRIANGLE;
+    }
+}
+
+void processVisibilityFragments(const void* frag_buf, uint32_t used_bytes, const void* visibility_buffer) {
+    const VisibilityBuffer& target = *static_cast<const VisibilityBuffer*>(visibility_buffer);
+    const VisibilityFragment* fragments = static_cast<const VisibilityFragment*>(frag_buf);
+    const uint32_t fragment_count = used_bytes / sizeof(VisibilityFragment);
+
+    for (uint32_t i = 0; i < fragment_count; ++i) {
+        const VisibilityFragment& fragment = fragments[i];
+        assert(fragment.x < target.width && fragment.y < target.height);
+        target.triangles[static_cast<size_t>(fragment.y) * target.width + fragment.x] = fragment.triangle;
+    }
+}
+
+// Triangles are set up at most once, and only if they are visible somewhere.
+// Buffers filled from other vertex data may name triangles that don't exist
+// or don't survive setup, and their pixels are treated as uncovered. So are
+// the numbers next to restart indices, which no triangle gets.
+template <uint32_t NumAttributes>
+static void resolveTriangles(const VisibilityBuffer& visibility_buffer, const RasterizerInput& input,
+                             const FragmentBufferInfo& fbi, uint32_t num_attributes) {
+    const ViewportBounds& vb = input.bounds;
+    const uint32_t triangle_count = primitiveCount(input.topology, input.index_count);
+    const uint32_t a_stride = 3 * detail::attributeCount<NumAttributes>(num_attributes);
+
+    assert(fbi.layout == FragmentLayout::Packed);
+    assert(!input.multisample);
+    assert(vb.top_left.x >= 0 && vb.top_left.y >= 0 &&
+           vb.bottom_right.x < static_cast<int64_t>(visibility_buffer.width) &&
+           vb.bottom_right.y < static_cast<int64_t>(visibility_buffer.height));
+
+    // Position of the setup of every triangle among the visible ones, in the
+    // order in which the pixels first show them. Allocations are padded by one
+    // element so that empty scenes don't request zero bytes.
+    uint32_t* slots = static_cast<uint32_t*>(std::malloc((static_cast<size_t>(triangle_count) + 1) * sizeof(uint32_t)));
+    assert(slots != nullptr);
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        slots[t] = NO_TRIANGLE;
+    }
+    uint32_t visible_count = 0;
+    for (int y = vb.top_left.y; y <= vb.bottom_right.y; ++y) {
+        const uint32_t* row = visibility_buffer.triangles + static_cast<size_t>(y) * visibility_buffer.width;
+        for (int x = vb.top_left.x; x <= vb.bottom_right.x; ++x) {
+            uint32_t t = row[x];
+            if (t < triangle_count && slots[t] == NO_TRIANGLE) {
+                slots[t] = visible_count++;
+            }
+        }
+    }
+
+    detail::TriangleSetup* setups =
+        static_cast<detail::TriangleSetup*>(std::malloc((visible_count + 1) * sizeof(detail::TriangleSetup)));
+    float* A_over_w =
+        static_cast<float*>(std::malloc((static_cast<size_t>(a_stride) * visible_count + 1) * sizeof(float)));
+    assert(setups != nullptr && A_over_w != nullptr);
+
+    // The triangles were already counted when they were rasterized
+    PipelineStatistics setup_stats = {};
+    detail::PrimitiveAssembler assembler = detail::makePrimitiveAssembler(input);
+    detail::VertexWindow window = {};
+    uint32_t v[3];
+    uint32_t t;
+    while (detail::nextTriangle(assembler, v, t)) {
+        const uint32_t slot = slots[t];
+        if (slot != NO_TRIANGLE &&
+            !detail::setupTriangle<NumAttributes>(input, v[0], v[1], v[2], window, num_attributes,
+                                                  A_over_w + static_cast<size_t>(a_stride) * slot, setups[slot],
+                                                  setup_stats)) {
+            slots[t] = NO_TRIANGLE;
+        }
+    }
+
+    PipelineStatistics stats = {};
+    FragmentWriter writer = makeFragmentWriter(fbi, num_attributes, nullptr, stats);
+    FragmentPipeline pipeline;
+    startFragmentPipeline(pipeline, fbi, writer);
+    for (int y = vb.top_left.y; y <= vb.bottom_right.y; ++y) {
+        const uint32_t* row = visibility_buffer.triangles + static_cast<size_t>(y) * visibility_buffer.width;
+        for (int x = vb.top_left.x; x <= vb.bottom_right.x; ++x) {
+            uint32_t t = row[x];
+            if (t >= triangle_count || slots[t] == NO_TRIANGLE) {
+                continue;
+            }
+            const detail::TriangleSetup& tri = setups[slots[t]];
+            int32_t e[3];
+            detail::edgeValuesAt(tri, x, y, e);
+            writeFragment<NumAttributes>(tri, num_attributes, e, x, y, writer);
+        }
+    }
+    flushFragments(writer);
+    finishFragmentPipeline(pipeline, writer);
+
+    if (input.statistics != nullptr) {
+        accumulateRasterizerStatistics(*input.statistics, stats);
+    }
+
+    std::free(A_over_w);
+    std::free(setups);
+    std::free(slots);
+}
+
+void resolveVisibilityBuffer(const VisibilityBuffer& visibility_buffer, const RasterizerInput& input,
+                             const FragmentBufferInfo& fbi) {
+    const uint32_t attribute_size = input.stride_bytes - detail::VERTEX_COORD_SIZE;
+    const uint32_t num_attributes = attribute_size / sizeof(float);
+
+    dispatchAttributeCount(num_attributes, [&]<uint32_t NumAttributes>() {
+        resolveTriangles<NumAttributes>(visibility_buffer, input, fbi, num_attributes);
+    });
+}
+
+} // namespace cascade
@@ -0,0 +1,80 @@
+#include <cascade/texture.h>
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace cascade {
+
+// Average of four texels per channel, rounded to nearest
+inline static uint32_t averageTexels(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) / 4) << shift;
+    }
+    return result;
+}
+
+Texture createTexture(const uint32_t* pixels, uint32_t width, uint32_t height) {
+    assert(std::has_single_bit(width) && std::has_single_bit(height));
+    assert(std::bit_width(width) <= MAX_TEXTURE_LEVELS && std::bit_width(height) <= MAX_TEXTURE_LEVELS);
+
+    Texture texture;
+    texture.level_count = std::bit_width(width > height ? width : height);
+
+    // Levels are padded to whole tiles, so those narrower than a tile still
+    // take up a full one
+    size_t texel_count = 0;
+    for (uint32_t level = 0; level < texture.level_count; ++level) {
+        TextureLevel& l = texture.levels[level];
+        l.offset = static_cast<uint32_t>(texel_count);
+        l.width = width >> level > 0 ? width >> level : 1;
+        l.height = height >> level > 0 ? height >> level : 1;
+        l.tiles_x = (l.width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        uint32_t tiles_y = (l.height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        texel_count += static_cast<size_t>(l.tiles_x) * tiles_y * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+    }
+
+    texture.texels = static_cast<uint32_t*>(std::malloc((texel_count + 1) * sizeof(uint32_t)));
+    assert(texture.texels != nullptr);
+    std::memset(texture.texels, 0, (texel_count + 1) * sizeof(uint32_t));
+
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            texture.texels[textureTexelIndex(texture, 0, x, y)] = pixels[y * width + x];
+        }
+    }
+
+    // Each texel is the average of the 2x2 texels it covers in the level
+    // above. Once one dimension is down to a single texel the same row or
+    // column is used twice.
+    for (uint32_t level = 1; level < texture.level_count; ++level) {
+        const TextureLevel& src = texture.levels[level - 1];
+        const TextureLevel& dst = texture.levels[level];
+        for (uint32_t y = 0; y < dst.height; ++y) {
+            uint32_t y0 = 2 * y;
+            uint32_t y1 = 2 * y + 1 < src.height ? 2 * y + 1 : y0;
+            for (uint32_t x = 0; x < dst.width; ++x) {
+                uint32_t x0 = 2 * x;
+                uint32_t x1 = 2 * x + 1 < src.width ? 2 * x + 1 : x0;
+                texture.texels[textureTexelIndex(texture, level, x, y)] =
+                    averageTexels(texture.texels[textureTexelIndex(texture, level - 1, x0, y0)],
+                                  texture.texels[textureTexelIndex(texture, level - 1, x1, y0)],
+                                  texture.texels[textureTexelIndex(texture, level - 1, x0, y1)],
+                                  texture.texels[textureTexelIndex(texture, level - 1, x1, y1)]);
+            }
+        }
+    }
+
+    return texture;
+}
+
+void destroyTexture(Texture& texture) {
+    std::free(texture.texels);
+    texture = {};
+}
+
+} // namespace cascade
@@ -0,0 +1,95 @@
+#include <cstdint>
+
+#include "vertex/vertex_kernels.h"
+
+namespace cascade {
+
+// Signed distance of the clip-space position from the given clip plane scaled
+// by some positive factor. It is non-negative on the visible side.
+static float planeDistance(const VertexTransform& transform, uint32_t plane, const float* position) {
+    const float x = position[0];
+    const float y = position[1];
+    const float z = position[2];
+    const float w = position[3];
+    switch (plane) {
+        case 0:
+            return z;
+        case 1:
+            return x - transform.guard_min_x * w;
+        case 2:
+            return transform.guard_max_x * w - x;
+        case 3:
+            return y - transform.guard_min_y * w;
+        default:
+            return transform.guard_max_y * w - y;
+    }
+}
+
+// Writes the point at t along the way from inside to outside to dst. Always
+// interpolating from the inside vertex makes triangles that share an edge
+// produce the same point on it.
+static void intersectEdge(const float* inside, const float* outside, float t, uint32_t vertex_floats, float* dst) {
+    for (uint32_t k = 0; k < vertex_floats; ++k) {
+        dst[k] = inside[k] + t * (outside[k] - inside[k]);
+    }
+}
+
+// Sutherland-Hodgman clipping. Positions and attributes are interpolated
+// linearly in clip space, where both of them are linear, so the rasterizer
+// still interpolates them perspective-correctly across the clipped triangles.
+uint32_t clipTriangle(const VertexTransform& transform, const float* const* vertices, uint32_t num_attributes,
+                      float* result, float* scratch) {
+    const uint32_t vertex_floats = POSITION_SIZE / sizeof(float) + num_attributes;
+
+    // Polygons alternate between the two buffers, so the number of planes
+    // decides which one holds the input of the first plane. The final
+    // polygon always ends up in result.
+    float* buffers[2] = {result, scratch};
+    float* polygon = buffers[CLIP_PLANE_COUNT % 2];
+    for (uint32_t k = 0; k < 3; ++k) {
+        for (uint32_t i = 0; i < vertex_floats; ++i) {
+            polygon[k * vertex_floats + i] = vertices[k][i];
+        }
+    }
+    uint32_t count = 3;
+
+    for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT; ++plane) {
+        float* clipped = buffers[(CLIP_PLANE_COUNT - plane - 1) % 2];
+        uint32_t clipped_count = 0;
+
+        for (uint32_t k = 0; k < count; ++k) {
+            const float* current = polygon + k * vertex_floats;
+            const float* next = polygon + ((k + 1) % count) * vertex_floats;
+            float current_distance = planeDistance(transform, plane, current);
+            float next_distance = planeDistance(transform, plane, next);
+            bool current_inside = current_distance >= 0.0f;
+            bool next_inside = next_distance >= 0.0f;
+
+            if (current_inside) {
+                for (uint32_t i = 0; i < vertex_floats; ++i) {
+                    clipped[clipped_count * vertex_floats + i] = current[i];
+                }
+                ++clipped_count;
+            }
+            if (current_inside && !next_inside) {
+                intersectEdge(current, next, current_distance / (current_distance - next_distance), vertex_floats,
+                              clipped + clipped_count * vertex_floats);
+                ++clipped_count;
+            } else if (!current_inside && next_inside) {
+                intersectEdge(next, current, next_distance / (next_distance - current_distance), vertex_floats,
+                              clipped + clipped_count * vertex_floats);
+                ++clipped_count;
+            }
+        }
+
+        polygon = clipped;
+        count = clipped_count;
+        if (count == 0) {
+            return 0;
+        }
+    }
+
+    return count;
+}
+
+} // namespace cascade
@@ -0,0 +1,252 @@
+#include <cascade/vertex.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <cascade/rasterizer.h>
+
+#include "detail/cpu_features.h"
+#include "detail/ptr_utils.h"
+#include "rasterizer/triangle.h"
+#include "vertex/vertex_kernels.h"
+
+namespace cascade {
+
+VertexCache createVertexCache(uint32_t vertex_count, uint32_t stride_bytes) {
+    assert(stride_bytes >= POSITION_SIZE && stride_bytes % sizeof(float) == 0);
+
+    VertexCache cache;
+    cache.vertex_count = vertex_count;
+    cache.vertex_capacity = vertex_count;
+    cache.index_capacity = 0;
+    cache.stride_bytes = stride_bytes;
+    cache.draw = 0;
+
+    // Allocations are padded by one element so that empty caches don't
+    // request zero bytes. The index buffer is allocated once the size of the
+    // draw is known.
+    cache.vertex_data = static_cast<float*>(std::malloc(static_cast<size_t>(vertex_count) * stride_bytes + 1));
+    cache.indices = nullptr;
+    cache.stamps = static_cast<uint32_t*>(std::calloc(static_cast<size_t>(vertex_count) + 1, sizeof(uint32_t)));
+    cache.pending = static_cast<uint32_t*>(std::malloc((static_cast<size_t>(vertex_count) + 1) * sizeof(uint32_t)));
+    cache.outcodes = static_cast<uint16_t*>(std::malloc((static_cast<size_t>(vertex_count) + 1) * sizeof(uint16_t)));
+    // The three input vertices and the two polygons that clipTriangle() works
+    // with
+    cache.clip_vertices = static_cast<float*>(std::malloc((3 + 2 * MAX_CLIPPED_VERTICES) * stride_bytes));
+    assert(cache.vertex_data != nullptr && cache.stamps != nullptr && cache.pending != nullptr);
+    assert(cache.outcodes != nullptr && cache.clip_vertices != nullptr);
+
+    return cache;
+}
+
+void destroyVertexCache(VertexCache& cache) {
+    std::free(cache.vertex_data);
+    std::free(cache.indices);
+    std::free(cache.stamps);
+    std::free(cache.pending);
+    std::free(cache.outcodes);
+    std::free(cache.clip_vertices);
+    cache = {};
+}
+
+void transformVerticesScalar(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                             const uint32_t* vertices, uint32_t count, uint16_t* outcodes) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const size_t offset = static_cast<size_t>(vertices[i]) * stride_bytes;
+        const char* src_ptr = char_ptr(src) + offset;
+        char* dst_ptr = char_ptr(dst) + offset;
+
+        float clip[4];
+        transformToClip(transform, float_ptr(src_ptr), clip);
+        outcodes[vertices[i]] = static_cast<uint16_t>(computeOutcode(transform, clip));
+        projectPosition(transform, clip, float_ptr(dst_ptr));
+        copyAttributes(src_ptr, dst_ptr, stride_bytes);
+    }
+}
+
+static VertexKernel selectVertexKernel() {
+#if defined(CASCADE_X86_SIMD)
+    switch (detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return transformVerticesAVX2;
+        case SimdLevel::SSE41:
+            return transformVerticesSSE41;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return transformVerticesScalar;
+}
+
+inline static float min2(float a, float b) {
+    return a < b ? a : b;
+}
+
+inline static float max2(float a, float b) {
+    return a > b ? a : b;
+}
+
+// The viewport maps [-1, 1] to the outer edges of its pixels. Y points up in
+// normalized device coordinates and down on the screen.
+static VertexTransform makeVertexTransform(const VertexInput& input) {
+    const ViewportBounds& vb = input.bounds;
+    const float half_width = static_cast<float>(vb.bottom_right.x - vb.top_left.x + 1) * 0.5f;
+    const float half_height = static_cast<float>(vb.bottom_right.y - vb.top_left.y + 1) * 0.5f;
+
+    VertexTransform transform;
+    std::memcpy(transform.m, input.transform.m, sizeof(transform.m));
+    transform.scale_x = half_width;
+    transform.scale_y = -half_height;
+    transform.offset_x = static_cast<float>(vb.top_left.x) + half_width;
+    transform.offset_y = static_cast<float>(vb.top_left.y) + half_height;
+
+    // Clipped vertices land on the guard band planes up to rounding, so the
+    // guard band is kept a pixel inside of the range of the rasterizer
+    const float limit = static_cast<float>(GUARD_BAND - 1);
+    float guard_x0 = (-limit - transform.offset_x) / transform.scale_x;
+    float guard_x1 = (limit - transform.offset_x) / transform.scale_x;
+    float guard_y0 = (-limit - transform.offset_y) / transform.scale_y;
+    float guard_y1 = (limit - transform.offset_y) / transform.scale_y;
+    transform.guard_min_x = min2(guard_x0, guard_x1);
+    transform.guard_max_x = max2(guard_x0, guard_x1);
+    transform.guard_min_y = min2(guard_y0, guard_y1);
+    transform.guard_max_y = max2(guard_y0, guard_y1);
+    return transform;
+}
+
+static void reserveVertices(VertexCache& cache, uint32_t count) {
+    if (count <= cache.vertex_capacity) {
+        return;
+    }
+    uint32_t capacity = cache.vertex_capacity * 2 > count ? cache.vertex_capacity * 2 : count;
+    cache.vertex_data =
+        static_cast<float*>(std::realloc(cache.vertex_data, static_cast<size_t>(capacity) * cache.stride_bytes));
+    assert(cache.vertex_data != nullptr);
+    cache.vertex_capacity = capacity;
+}
+
+static void reserveIndices(VertexCache& cache, uint32_t count) {
+    if (count <= cache.index_capacity) {
+        return;
+    }
+    uint32_t capacity = cache.index_capacity * 2 > count ? cache.index_capacity * 2 : count;
+    cache.indices =
+        static_cast<uint32_t*>(std::realloc(cache.indices, static_cast<size_t>(capacity) * sizeof(uint32_t)));
+    assert(cache.indices != nullptr);
+    cache.index_capacity = capacity;
+}
+
+// Clips the triangle and appends the resulting polygon to the cache as a fan
+// of triangles. The clip-space positions are computed again from the input
+// since only the projected ones are kept.
+static void clipAndAppend(const VertexInput& input, const VertexTransform& transform, const uint32_t* triangle,
+                          VertexCache& cache, uint32_t& vertex_count, uint32_t& index_count) {
+    const uint32_t stride = input.stride_bytes;
+    const uint32_t num_attributes = (stride - POSITION_SIZE) / sizeof(float);
+
+    float* triangle_vertices = cache.clip_vertices;
+    float* polygon = float_ptr(char_ptr(triangle_vertices) + 3 * stride);
+    float* scratch = float_ptr(char_ptr(polygon) + MAX_CLIPPED_VERTICES * stride);
+
+    const float* vertices[3];
+    for (int k = 0; k < 3; ++k) {
+        const char* src_ptr = char_ptr(input.vertex_data) + static_cast<size_t>(triangle[k]) * stride;
+        char* clip_ptr = char_ptr(triangle_vertices) + k * stride;
+        transformToClip(transform, float_ptr(src_ptr), float_ptr(clip_ptr));
+        copyAttributes(src_ptr, clip_ptr, stride);
+        vertices[k] = float_ptr(clip_ptr);
+    }
+
+    uint32_t count = clipTriangle(transform, vertices, num_attributes, polygon, scratch);
+    if (count < 3) {
+        return;
+    }
+
+    reserveVertices(cache, vertex_count + count);
+    reserveIndices(cache, index_count + 3 * (count - 2));
+
+    const uint32_t first = vertex_count;
+    for (uint32_t k = 0; k < count; ++k) {
+        const char* clip_ptr = char_ptr(polygon) + k * stride;
+        char* dst_ptr = char_ptr(cache.vertex_data) + static_cast<size_t>(first + k) * stride;
+        projectPosition(transform, float_ptr(clip_ptr), float_ptr(dst_ptr));
+        copyAttributes(clip_ptr, dst_ptr, stride);
+    }
+    vertex_count += count;
+
+    for (uint32_t k = 1; k + 1 < count; ++k) {
+        cache.indices[index_count++] = first;
+        cache.indices[index_count++] = first + k;
+        cache.indices[index_count++] = first + k + 1;
+    }
+}
+
+RasterizerInput transformVertices(const VertexInput& input, VertexCache& cache) {
+    static const VertexKernel kernel = selectVertexKernel();
+
+    assert(input.stride_bytes == cache.stride_bytes);
+
+    // Vertices stamped with the current draw have already been transformed.
+    // Once the counter wraps around, stamps of old draws could match again,
+    // so they are cleared.
+    if (++cache.draw == 0) {
+        std::memset(cache.stamps, 0, static_cast<size_t>(cache.vertex_count) * sizeof(uint32_t));
+        cache.draw = 1;
+    }
+
+    // Gather the vertices of the draw so that the kernel can transform them
+    // in batches regardless of how they are shared between triangles
+    uint32_t pending_count = 0;
+    for (uint32_t i = 0; i < input.index_count; ++i) {
+        uint32_t vertex = detail::readIndex(input.indices, input.index_type, i);
+        if (input.primitive_restart && detail::isRestartIndex(input.index_type, vertex)) {
+            continue;
+        }
+        assert(vertex < cache.vertex_count);
+        if (cache.stamps[vertex] != cache.draw) {
+            cache.stamps[vertex] = cache.draw;
+            cache.pending[pending_count++] = vertex;
+        }
+    }
+
+    const VertexTransform transform = makeVertexTransform(input);
+    kernel(transform, input.vertex_data, cache.vertex_data, input.stride_bytes, cache.pending, pending_count,
+           cache.outcodes);
+
+    // Assemble the triangles. The outcodes decide whether a triangle is
+    // dropped, kept as it is or clipped, which is rare.
+    const uint32_t triangle_count = primitiveCount(input.topology, input.index_count);
+    reserveIndices(cache, 3 * triangle_count);
+    detail::PrimitiveAssembler assembler = detail::makePrimitiveAssembler(input.indices, input.index_type,
+                                                                          input.topology, input.primitive_restart, 0,
+                                                                          triangle_count);
+    uint32_t vertex_count = cache.vertex_count;
+    uint32_t index_count = 0;
+    uint32_t triangle[3];
+    uint32_t t;
+    while (detail::nextTriangle(assembler, triangle, t)) {
+        uint32_t outcode0 = cache.outcodes[triangle[0]];
+        uint32_t outcode1 = cache.outcodes[triangle[1]];
+        uint32_t outcode2 = cache.outcodes[triangle[2]];
+
+        if ((outcode0 & outcode1 & outcode2 & OUTSIDE_FRUSTUM) != 0) {
+            continue;
+        }
+        if (((outcode0 | outcode1 | outcode2) & OUTSIDE_CLIP_PLANES) == 0) {
+            cache.indices[index_count++] = triangle[0];
+            cache.indices[index_count++] = triangle[1];
+            cache.indices[index_count++] = triangle[2];
+            continue;
+        }
+        clipAndAppend(input, transform, triangle, cache, vertex_count, index_count);
+        // The polygon may have taken the space reserved for the triangles
+        // that follow
+        reserveIndices(cache, index_count + 3 * (triangle_count - t - 1));
+    }
+
+    return {cache.vertex_data, cache.indices, index_count, input.stride_bytes, input.bounds};
+}
+
+} // namespace cascade
@@ -0,0 +1,74 @@
+#include "vertex/vertex_kernels.h"
+
+#include <cstdint>
+#include <limits>
+
+#include <immintrin.h>
+
+#include "vertex/vertex_simd.h"
+
+namespace cascade {
+
+// Transposes the 4x4 matrices in both 128-bit halves of the rows
+inline static void transposeHalves(__m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+struct AVX2VertexOps {
+    using Vec = __m256;
+    using VecI = __m256i;
+    static constexpr int LANES = 8;
+
+    static Vec set1(float value) { return _mm256_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+
+    // Lanes hold bit where a < b and 0 elsewhere
+    static VecI lessBits(Vec a, Vec b, uint32_t bit) {
+        return _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)),
+                                _mm256_set1_epi32(static_cast<int32_t>(bit)));
+    }
+    static VecI orBits(VecI a, VecI b) { return _mm256_or_si256(a, b); }
+    static void storeBits(uint32_t* dst, VecI a) { _mm256_store_si256(reinterpret_cast<VecI*>(dst), a); }
+
+    // All bits set in lanes where a > 0 does not hold, including NaN
+    static Vec notPositive(Vec a) { return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NGT_UQ); }
+
+    static Vec nanWhere(Vec mask, Vec a) {
+        return _mm256_blendv_ps(a, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), mask);
+    }
+
+    // Component k of the position of vertex l ends up in lane l of result[k].
+    // Vertices 0-3 go to the lower half and vertices 4-7 to the upper one.
+    static void loadPositions(const float* const* src, Vec* result) {
+        for (int k = 0; k < 4; ++k) {
+            result[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src[k])), _mm_loadu_ps(src[k + 4]), 1);
+        }
+        transposeHalves(result[0], result[1], result[2], result[3]);
+    }
+
+    static void storePositions(float* const* dst, const Vec* components) {
+        Vec rows[4] = {components[0], components[1], components[2], components[3]};
+        transposeHalves(rows[0], rows[1], rows[2], rows[3]);
+        for (int k = 0; k < 4; ++k) {
+            _mm_storeu_ps(dst[k], _mm256_castps256_ps128(rows[k]));
+            _mm_storeu_ps(dst[k + 4], _mm256_extractf128_ps(rows[k], 1));
+        }
+    }
+};
+
+void transformVerticesAVX2(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                           const uint32_t* vertices, uint32_t count, uint16_t* outcodes) {
+    transformVerticesSimd<AVX2VertexOps>(transform, src, dst, stride_bytes, vertices, count, outcodes);
+}
+
+} // namespace cascade
@@ -0,0 +1,120 @@
+#ifndef CASCADE_VERTEX_KERNELS_H_
+#define CASCADE_VERTEX_KERNELS_H_
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace cascade {
+
+constexpr uint32_t POSITION_SIZE = 4 * sizeof(float); // (x, y, z, w)
+
+// Outcode bits telling on which side of the clip planes a clip-space position
+// lies. A triangle whose vertices all lie outside of the same one of the first
+// six planes cannot be visible.
+constexpr uint32_t OUTSIDE_LEFT = 1 << 0;   // x < -w
+constexpr uint32_t OUTSIDE_RIGHT = 1 << 1;  // x > w
+constexpr uint32_t OUTSIDE_BOTTOM = 1 << 2; // y < -w
+constexpr uint32_t OUTSIDE_TOP = 1 << 3;    // y > w
+constexpr uint32_t OUTSIDE_NEAR = 1 << 4;   // z < 0
+constexpr uint32_t OUTSIDE_FAR = 1 << 5;    // z > w
+// The position lies outside of the guard band, so its screen-space
+// coordinates cannot be handled by the rasterizer
+constexpr uint32_t OUTSIDE_GUARD_LEFT = 1 << 6;
+constexpr uint32_t OUTSIDE_GUARD_RIGHT = 1 << 7;
+constexpr uint32_t OUTSIDE_GUARD_BOTTOM = 1 << 8;
+constexpr uint32_t OUTSIDE_GUARD_TOP = 1 << 9;
+
+constexpr uint32_t OUTSIDE_FRUSTUM =
+    OUTSIDE_LEFT | OUTSIDE_RIGHT | OUTSIDE_BOTTOM | OUTSIDE_TOP | OUTSIDE_NEAR | OUTSIDE_FAR;
+
+// Triangles with a vertex outside of these planes have to be clipped
+constexpr uint32_t OUTSIDE_CLIP_PLANES =
+    OUTSIDE_NEAR | OUTSIDE_GUARD_LEFT | OUTSIDE_GUARD_RIGHT | OUTSIDE_GUARD_BOTTOM | OUTSIDE_GUARD_TOP;
+
+// Transform of a draw, with the viewport mapping folded into a scale and an
+// offset of the normalized device coordinates
+struct VertexTransform {
+    float m[16]; // Column-major
+    float scale_x;
+    float scale_y;
+    float offset_x;
+    float offset_y;
+    // Guard band in normalized device coordinates
+    float guard_min_x;
+    float guard_max_x;
+    float guard_min_y;
+    float guard_max_y;
+};
+
+inline static void transformToClip(const VertexTransform& transform, const float* src, float* clip) {
+    const float* m = transform.m;
+    for (int row = 0; row < 4; ++row) {
+        clip[row] = m[row] * src[0] + m[4 + row] * src[1] + m[8 + row] * src[2] + m[12 + row] * src[3];
+    }
+}
+
+inline static uint32_t computeOutcode(const VertexTransform& transform, const float* clip) {
+    const float x = clip[0];
+    const float y = clip[1];
+    const float z = clip[2];
+    const float w = clip[3];
+    return (x < -w ? OUTSIDE_LEFT : 0u) | (x > w ? OUTSIDE_RIGHT : 0u) | (y < -w ? OUTSIDE_BOTTOM : 0u) |
+           (y > w ? OUTSIDE_TOP : 0u) | (z < 0.0f ? OUTSIDE_NEAR : 0u) | (z > w ? OUTSIDE_FAR : 0u) |
+           (x < transform.guard_min_x * w ? OUTSIDE_GUARD_LEFT : 0u) |
+           (x > transform.guard_max_x * w ? OUTSIDE_GUARD_RIGHT : 0u) |
+           (y < transform.guard_min_y * w ? OUTSIDE_GUARD_BOTTOM : 0u) |
+           (y > transform.guard_max_y * w ? OUTSIDE_GUARD_TOP : 0u);
+}
+
+// Writes the screen-space x and y of the clip-space position followed by its
+// z and w to dst
+inline static void projectPosition(const VertexTransform& transform, const float* clip, float* dst) {
+    if (!(clip[3] > 0.0f)) {
+        dst[0] = std::numeric_limits<float>::quiet_NaN();
+        dst[1] = std::numeric_limits<float>::quiet_NaN();
+    } else {
+        float inv_w = 1.0f / clip[3];
+        dst[0] = clip[0] * inv_w * transform.scale_x + transform.offset_x;
+        dst[1] = clip[1] * inv_w * transform.scale_y + transform.offset_y;
+    }
+    dst[2] = clip[2];
+    dst[3] = clip[3];
+}
+
+// Attributes are passed through unchanged
+inline static void copyAttributes(const char* src, char* dst, uint32_t stride_bytes) {
+    std::memcpy(dst + POSITION_SIZE, src + POSITION_SIZE, stride_bytes - POSITION_SIZE);
+}
+
+// Transforms vertices[0..count) from src to dst, both of which hold vertices
+// stride_bytes apart, and stores the outcode of every vertex in outcodes
+using VertexKernel = void (*)(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                              const uint32_t* vertices, uint32_t count, uint16_t* outcodes);
+
+void transformVerticesScalar(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                             const uint32_t* vertices, uint32_t count, uint16_t* outcodes);
+
+#if defined(CASCADE_X86_SIMD)
+void transformVerticesSSE41(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                            const uint32_t* vertices, uint32_t count, uint16_t* outcodes);
+
+void transformVerticesAVX2(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                           const uint32_t* vertices, uint32_t count, uint16_t* outcodes);
+#endif
+
+// Clips the triangle with the given clip-space vertices against the near
+// plane and the guard band. Vertices are made of the clip-space position
+// followed by num_attributes attributes, and the resulting convex polygon is
+// written to result, which must have space for MAX_CLIPPED_VERTICES vertices.
+// scratch must have the same size. Returns the number of vertices of the
+// polygon, which is 0 if nothing is left of the triangle.
+constexpr uint32_t CLIP_PLANE_COUNT = 5;
+constexpr uint32_t MAX_CLIPPED_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+uint32_t clipTriangle(const VertexTransform& transform, const float* const* vertices, uint32_t num_attributes,
+                      float* result, float* scratch);
+
+} // namespace cascade
+
+#endif
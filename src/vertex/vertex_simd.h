@@ -0,0 +1,106 @@
+#ifndef CASCADE_VERTEX_SIMD_H_
+#define CASCADE_VERTEX_SIMD_H_
+
+#include <cstdint>
+
+#include "detail/ptr_utils.h"
+#include "vertex/vertex_kernels.h"
+
+namespace cascade {
+
+// Vectorized vertex transform shared by the SSE4.1 and AVX2 kernels. Ops wraps
+// the vector types and operations of one instruction set, so this header must
+// only be included from translation units compiled for that instruction set.
+//
+// Positions of LANES vertices are transposed into one vector per component,
+// so every lane transforms one vertex. The operations mirror
+// transformToClip(), computeOutcode() and projectPosition() in type and order,
+// which makes the results bit-identical to them.
+template <typename Ops>
+inline static void transformVerticesSimd(const VertexTransform& transform, const float* src, float* dst,
+                                         uint32_t stride_bytes, const uint32_t* vertices, uint32_t count,
+                                         uint16_t* outcodes) {
+    using Vec = typename Ops::Vec;
+    using VecI = typename Ops::VecI;
+    constexpr int LANES = Ops::LANES;
+
+    Vec m[16];
+    for (int k = 0; k < 16; ++k) {
+        m[k] = Ops::set1(transform.m[k]);
+    }
+    const Vec scale_x = Ops::set1(transform.scale_x);
+    const Vec scale_y = Ops::set1(transform.scale_y);
+    const Vec offset_x = Ops::set1(transform.offset_x);
+    const Vec offset_y = Ops::set1(transform.offset_y);
+    const Vec guard_min_x = Ops::set1(transform.guard_min_x);
+    const Vec guard_max_x = Ops::set1(transform.guard_max_x);
+    const Vec guard_min_y = Ops::set1(transform.guard_min_y);
+    const Vec guard_max_y = Ops::set1(transform.guard_max_y);
+    const Vec zero = Ops::set1(0.0f);
+    const Vec one = Ops::set1(1.0f);
+
+    uint32_t i = 0;
+    for (; count - i >= LANES; i += LANES) {
+        const float* src_ptrs[LANES];
+        float* dst_ptrs[LANES];
+        for (int k = 0; k < LANES; ++k) {
+            const size_t offset = static_cast<size_t>(vertices[i + k]) * stride_bytes;
+            src_ptrs[k] = float_ptr(char_ptr(src) + offset);
+            dst_ptrs[k] = float_ptr(char_ptr(dst) + offset);
+        }
+
+        Vec position[4];
+        Ops::loadPositions(src_ptrs, position);
+
+        Vec clip[4];
+        for (int row = 0; row < 4; ++row) {
+            clip[row] = Ops::add(Ops::add(Ops::add(Ops::mul(m[row], position[0]), Ops::mul(m[4 + row], position[1])),
+                                          Ops::mul(m[8 + row], position[2])),
+                                 Ops::mul(m[12 + row], position[3]));
+        }
+
+        // Outcodes of the lanes, see computeOutcode()
+        const Vec x = clip[0];
+        const Vec y = clip[1];
+        const Vec z = clip[2];
+        const Vec w = clip[3];
+        const Vec neg_w = Ops::sub(zero, w);
+        VecI outcode = Ops::orBits(Ops::lessBits(x, neg_w, OUTSIDE_LEFT), Ops::lessBits(w, x, OUTSIDE_RIGHT));
+        outcode = Ops::orBits(outcode, Ops::lessBits(y, neg_w, OUTSIDE_BOTTOM));
+        outcode = Ops::orBits(outcode, Ops::lessBits(w, y, OUTSIDE_TOP));
+        outcode = Ops::orBits(outcode, Ops::lessBits(z, zero, OUTSIDE_NEAR));
+        outcode = Ops::orBits(outcode, Ops::lessBits(w, z, OUTSIDE_FAR));
+        outcode = Ops::orBits(outcode, Ops::lessBits(x, Ops::mul(guard_min_x, w), OUTSIDE_GUARD_LEFT));
+        outcode = Ops::orBits(outcode, Ops::lessBits(Ops::mul(guard_max_x, w), x, OUTSIDE_GUARD_RIGHT));
+        outcode = Ops::orBits(outcode, Ops::lessBits(y, Ops::mul(guard_min_y, w), OUTSIDE_GUARD_BOTTOM));
+        outcode = Ops::orBits(outcode, Ops::lessBits(Ops::mul(guard_max_y, w), y, OUTSIDE_GUARD_TOP));
+        alignas(32) uint32_t lane_outcodes[LANES];
+        Ops::storeBits(lane_outcodes, outcode);
+        for (int k = 0; k < LANES; ++k) {
+            outcodes[vertices[i + k]] = static_cast<uint16_t>(lane_outcodes[k]);
+        }
+
+        // Lanes behind the eye divide by a non-positive w, but are replaced
+        // with NaN anyway
+        Vec inv_w = Ops::div(one, clip[3]);
+        Vec behind = Ops::notPositive(clip[3]);
+        Vec screen[4] = {
+            Ops::nanWhere(behind, Ops::add(Ops::mul(Ops::mul(clip[0], inv_w), scale_x), offset_x)),
+            Ops::nanWhere(behind, Ops::add(Ops::mul(Ops::mul(clip[1], inv_w), scale_y), offset_y)),
+            clip[2],
+            clip[3],
+        };
+        Ops::storePositions(dst_ptrs, screen);
+
+        for (int k = 0; k < LANES; ++k) {
+            copyAttributes(char_ptr(src_ptrs[k]), char_ptr(dst_ptrs[k]), stride_bytes);
+        }
+    }
+
+    // Fewer vertices than lanes are left
+    transformVerticesScalar(transform, src, dst, stride_bytes, vertices + i, count - i, outcodes);
+}
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,61 @@
+#include "vertex/vertex_kernels.h"
+
+#include <cstdint>
+#include <limits>
+
+#include <smmintrin.h>
+
+#include "vertex/vertex_simd.h"
+
+namespace cascade {
+
+struct SSE41VertexOps {
+    using Vec = __m128;
+    using VecI = __m128i;
+    static constexpr int LANES = 4;
+
+    static Vec set1(float value) { return _mm_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+
+    // Lanes hold bit where a < b and 0 elsewhere
+    static VecI lessBits(Vec a, Vec b, uint32_t bit) {
+        return _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(a, b)), _mm_set1_epi32(static_cast<int32_t>(bit)));
+    }
+    static VecI orBits(VecI a, VecI b) { return _mm_or_si128(a, b); }
+    static void storeBits(uint32_t* dst, VecI a) { _mm_store_si128(reinterpret_cast<VecI*>(dst), a); }
+
+    // All bits set in lanes where a > 0 does not hold, including NaN
+    static Vec notPositive(Vec a) { return _mm_cmpngt_ps(a, _mm_setzero_ps()); }
+
+    static Vec nanWhere(Vec mask, Vec a) {
+        return _mm_blendv_ps(a, _mm_set1_ps(std::numeric_limits<float>::quiet_NaN()), mask);
+    }
+
+    // Component k of the position of vertex l ends up in lane l of result[k]
+    static void loadPositions(const float* const* src, Vec* result) {
+        result[0] = _mm_loadu_ps(src[0]);
+        result[1] = _mm_loadu_ps(src[1]);
+        result[2] = _mm_loadu_ps(src[2]);
+        result[3] = _mm_loadu_ps(src[3]);
+        _MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+    }
+
+    static void storePositions(float* const* dst, const Vec* components) {
+        Vec rows[4] = {components[0], components[1], components[2], components[3]};
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        _mm_storeu_ps(dst[0], rows[0]);
+        _mm_storeu_ps(dst[1], rows[1]);
+        _mm_storeu_ps(dst[2], rows[2]);
+        _mm_storeu_ps(dst[3], rows[3]);
+    }
+};
+
+void transformVerticesSSE41(const VertexTransform& transform, const float* src, float* dst, uint32_t stride_bytes,
+                            const uint32_t* vertices, uint32_t count, uint16_t* outcodes) {
+    transformVerticesSimd<SSE41VertexOps>(transform, src, dst, stride_bytes, vertices, count, outcodes);
+}
+
+} // namespace cascade
@@ -0,0 +1,584 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cascade/color_buffer.h>
+#include <cascade/depth_buffer.h>
+#include <cascade/fragment_ops.h>
+#include <cascade/image_export.h>
+#include <cascade/multisample.h>
+#include <cascade/rasterizer.h>
+#include <cascade/texture.h>
+#include <cascade/vertex.h>
+#include <cascade/visibility_buffer.h>
+
+// Differential test of the vectorized kernels. The kernels are selected once
+// per process, capped by the CASCADE_SIMD environment variable, so the test is
+// run once per instruction set: the scalar run writes a hash of the result of
+// every case to a file with --write, and the other runs compute the same cases
+// and compare their hashes against it with --compare.
+//
+// Every case renders the same scenes through one of the fragment stages at
+// odd and even sizes, so quads and vectors straddle the right and bottom edges
+// of the buffers, with buffers small enough to be flushed in the middle of a
+// group as well as large ones.
+
+using namespace cascade;
+
+constexpr uint32_t SIZES[][2] = {{9, 9}, {16, 16}, {37, 21}, {64, 40}};
+constexpr uint32_t LARGE_BUFFER_SIZE = 64 * 1024;
+constexpr uint32_t TEXTURE_SIZE = 32;
+constexpr uint32_t TEXCOORD_ATTRIBUTE = 4;
+
+// FNV-1a over 32-bit words, which only depends on the values hashed
+struct Hash {
+    uint64_t value = 14695981039346656037ull;
+
+    void add(uint32_t word) {
+        value = (value ^ word) * 1099511628211ull;
+    }
+    void add(float value) {
+        uint32_t word;
+        std::memcpy(&word, &value, sizeof(word));
+        add(word);
+    }
+    void add(const void* data, size_t bytes) {
+        const uint8_t* bytes_ptr = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            add(static_cast<uint32_t>(bytes_ptr[i]));
+        }
+    }
+};
+
+// Screen-space triangles with num_attributes attributes, the first four being
+// a color and the next two texture coordinates. Mixes triangles of every size
+// that cross the edges of the viewport, both windings, and a mesh with shared
+// edges covering the whole viewport. Some triangles are fully opaque and some
+// fully transparent, so blending takes every path.
+struct Scene {
+    std::vector<float> vertex_data;
+    std::vector<uint32_t> indices;
+    uint32_t num_attributes;
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t strideBytes() const {
+        return (4 + num_attributes) * sizeof(float);
+    }
+    // Size of a fragment with FragmentLayout::Packed
+    uint32_t fragmentStride() const {
+        return 2 * sizeof(uint32_t) + (1 + num_attributes) * sizeof(float);
+    }
+};
+
+static Scene makeScene(uint32_t width, uint32_t height, uint32_t num_attributes, uint32_t seed) {
+    std::mt19937 rng(seed);
+    auto uniform = [&](float lo, float hi) {
+        return lo + (hi - lo) * static_cast<float>(rng() >> 8) / static_cast<float>(1 << 24);
+    };
+
+    Scene scene = {{}, {}, num_attributes, width, height};
+    auto addVertex = [&](float x, float y, float alpha) {
+        scene.vertex_data.insert(scene.vertex_data.end(), {x, y, uniform(0.0f, 1.0f), uniform(0.5f, 2.0f)});
+        for (uint32_t a = 0; a < num_attributes; ++a) {
+            scene.vertex_data.push_back(a == 3 && alpha >= 0.0f ? alpha : uniform(-0.25f, 1.25f));
+        }
+        return static_cast<uint32_t>(scene.vertex_data.size() / (4 + num_attributes) - 1);
+    };
+
+    const float w = static_cast<float>(width);
+    const float h = static_cast<float>(height);
+    for (uint32_t t = 0; t < 48; ++t) {
+        const float size = t % 4 == 0 ? 2.0f * w : t % 4 == 1 ? 2.5f : t % 4 == 2 ? 0.5f * w : 6.0f;
+        const float cx = uniform(-0.25f * w, 1.25f * w);
+        const float cy = uniform(-0.25f * h, 1.25f * h);
+        const float alpha = t % 6 == 0 ? 1.0f : t % 6 == 1 ? 0.0f : -1.0f;
+        uint32_t v[3];
+        for (uint32_t& vertex : v) {
+            vertex = addVertex(cx + uniform(-size, size), cy + uniform(-size, size), alpha);
+        }
+        scene.indices.insert(scene.indices.end(), {v[0], v[1], v[2], v[0], v[2], v[1]});
+    }
+
+    constexpr uint32_t CELLS = 5;
+    const uint32_t first = static_cast<uint32_t>(scene.vertex_data.size() / (4 + num_attributes));
+    for (uint32_t y = 0; y <= CELLS; ++y) {
+        for (uint32_t x = 0; x <= CELLS; ++x) {
+            const float jitter = x > 0 && x < CELLS && y > 0 && y < CELLS ? 0.3f : 0.0f;
+            addVertex((x + uniform(-jitter, jitter)) * w / CELLS, (y + uniform(-jitter, jitter)) * h / CELLS,
+                      -1.0f);
+        }
+    }
+    for (uint32_t y = 0; y < CELLS; ++y) {
+        for (uint32_t x = 0; x < CELLS; ++x) {
+            const uint32_t i0 = first + y * (CELLS + 1) + x;
+            const uint32_t i1 = i0 + 1;
+            const uint32_t i2 = i0 + CELLS + 1;
+            const uint32_t i3 = i2 + 1;
+            scene.indices.insert(scene.indices.end(), {i0, i1, i2, i1, i3, i2, i0, i2, i1, i1, i2, i3});
+        }
+    }
+    return scene;
+}
+
+static RasterizerInput makeInput(const Scene& scene) {
+    return {scene.vertex_data.data(),
+            scene.indices.data(),
+            static_cast<uint32_t>(scene.indices.size()),
+            scene.strideBytes(),
+            {{0, 0}, {static_cast<int32_t>(scene.width) - 1, static_cast<int32_t>(scene.height) - 1}}};
+}
+
+// Fragment buffer of the given size, aligned for FragmentLayout::Quads
+struct FragmentBuffer {
+    std::vector<uint8_t> storage;
+
+    explicit FragmentBuffer(uint32_t size_bytes) : storage(size_bytes + 16) {}
+    void* data() {
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+        return storage.data() + (16 - address % 16) % 16;
+    }
+};
+
+// Buffer size that only holds a few fragments of the layout, so that groups of
+// fragments get split between flushes
+static uint32_t smallBufferSize(const Scene& scene, FragmentLayout layout) {
+    if (layout == FragmentLayout::Quads) {
+        return 3 * fragmentQuadSize(scene.num_attributes);
+    } else if (layout == FragmentLayout::Visibility) {
+        return 5 * sizeof(VisibilityFragment);
+    }
+    return 5 * scene.fragmentStride();
+}
+
+// The stream is hashed as a whole, since the vectorized traversal may flush at
+// different points than the scalar one
+static void hashFragments(const void* frag_buf, uint32_t used_bytes, const void* context) {
+    static_cast<Hash*>(const_cast<void*>(context))->add(frag_buf, used_bytes);
+}
+
+static std::vector<uint32_t> makeColors(uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> colors(count);
+    for (uint32_t& color : colors) {
+        color = static_cast<uint32_t>(rng());
+    }
+    return colors;
+}
+
+// Linear or blocked color buffer filled with the same random pixels in both
+// layouts, hashed in row-major order
+struct ColorTarget {
+    ColorLayout layout;
+    std::vector<uint32_t> linear;
+    ColorBuffer blocked = {};
+
+    ColorTarget(ColorLayout layout, uint32_t width, uint32_t height) : layout(layout) {
+        const std::vector<uint32_t> colors = makeColors(width * height, width * 131 + height);
+        if (layout == ColorLayout::Linear) {
+            linear = colors;
+            return;
+        }
+        blocked = createColorBuffer(width, height);
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                blocked.pixels[colorBufferIndex(blocked, x, y)] = colors[y * width + x];
+            }
+        }
+    }
+    ~ColorTarget() {
+        if (layout == ColorLayout::Blocked) {
+            destroyColorBuffer(blocked);
+        }
+    }
+    ColorTarget(const ColorTarget&) = delete;
+    ColorTarget& operator=(const ColorTarget&) = delete;
+
+    void* pixels() {
+        return layout == ColorLayout::Linear ? static_cast<void*>(linear.data()) : blocked.pixels;
+    }
+    void hash(Hash& hash, uint32_t width, uint32_t height) const {
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                hash.add(layout == ColorLayout::Linear ? linear[y * width + x]
+                                                       : blocked.pixels[colorBufferIndex(blocked, x, y)]);
+            }
+        }
+    }
+};
+
+static void hashDepth(Hash& hash, const DepthBuffer& depth_buffer) {
+    for (uint32_t y = 0; y < depth_buffer.height; ++y) {
+        for (uint32_t x = 0; x < depth_buffer.width; ++x) {
+            hash.add(depth_buffer.depth[depthBufferIndex(depth_buffer, x, y)]);
+        }
+    }
+}
+
+static const char* layoutName(FragmentLayout layout) {
+    switch (layout) {
+        case FragmentLayout::Packed:
+            return "packed";
+        case FragmentLayout::Quads:
+            return "quads";
+        case FragmentLayout::Visibility:
+            return "visibility";
+    }
+    return "";
+}
+
+// Hash of the result of every case by name
+using Results = std::map<std::string, uint64_t>;
+
+// Fragment stream of the span kernels in every layout
+static void testFragments(Results& results, const Scene& scene, const std::string& prefix) {
+    for (FragmentLayout layout : {FragmentLayout::Packed, FragmentLayout::Quads, FragmentLayout::Visibility}) {
+        for (bool depth : {false, true}) {
+            for (uint32_t size_bytes : {smallBufferSize(scene, layout), LARGE_BUFFER_SIZE}) {
+                Hash hash;
+                DepthBuffer depth_buffer = createDepthBuffer(scene.width, scene.height);
+                clearDepthBuffer(depth_buffer, 1.0f);
+                RasterizerInput input = makeInput(scene);
+                input.depth_buffer = depth ? &depth_buffer : nullptr;
+                FragmentBuffer buffer(size_bytes);
+                rasterize(input, {buffer.data(), size_bytes, hashFragments, &hash, layout});
+                if (depth) {
+                    hashDepth(hash, depth_buffer);
+                }
+                destroyDepthBuffer(depth_buffer);
+                results[prefix + "fragments/" + layoutName(layout) + (depth ? "/depth/" : "/") +
+                        std::to_string(size_bytes)] = hash.value;
+            }
+        }
+    }
+
+    // Multisampled coverage only exists with quads
+    Hash hash;
+    RasterizerInput input = makeInput(scene);
+    input.multisample = true;
+    FragmentBuffer buffer(LARGE_BUFFER_SIZE);
+    rasterize(input, {buffer.data(), LARGE_BUFFER_SIZE, hashFragments, &hash, FragmentLayout::Quads});
+    results[prefix + "fragments/msaa"] = hash.value;
+}
+
+// Color, depth and blend operations in both color layouts
+static void testColors(Results& results, const Scene& scene, const std::string& prefix) {
+    using Process = void (*)(const void*, uint32_t, const void*);
+    struct Operation {
+        const char* name;
+        FragmentLayout layout;
+        Process process;
+        bool depth;
+        bool blend;
+    };
+    const Operation operations[] = {
+        {"color", FragmentLayout::Packed, processFragmentsWithoutDepth, false, false},
+        {"color_depth", FragmentLayout::Packed, processFragmentsWithDepth, true, false},
+        {"quad_color", FragmentLayout::Quads, processFragmentQuadsWithoutDepth, false, false},
+        {"quad_color_depth", FragmentLayout::Quads, processFragmentQuadsWithDepth, true, false},
+        {"blend", FragmentLayout::Packed, processBlendedFragments, false, true},
+        {"blend_depth", FragmentLayout::Packed, processBlendedFragments, true, true},
+        {"quad_blend", FragmentLayout::Quads, processBlendedFragmentQuads, false, true},
+        {"quad_blend_depth", FragmentLayout::Quads, processBlendedFragmentQuads, true, true},
+    };
+
+    for (const Operation& op : operations) {
+        for (ColorLayout color_layout : {ColorLayout::Linear, ColorLayout::Blocked}) {
+            for (BlendMode mode : {BlendMode::Over, BlendMode::Additive, BlendMode::Premultiplied}) {
+                if (!op.blend && mode != BlendMode::Over) {
+                    continue;
+                }
+                for (uint32_t size_bytes : {smallBufferSize(scene, op.layout), LARGE_BUFFER_SIZE}) {
+                    ColorTarget target(color_layout, scene.width, scene.height);
+                    DepthBuffer depth_buffer = createDepthBuffer(scene.width, scene.height);
+                    clearDepthBuffer(depth_buffer, 0.75f);
+
+                    // Blending only tests depth, so the rasterizer doesn't
+                    // update it either
+                    OutputContext context = {target.pixels(), scene.fragmentStride(), scene.width};
+                    if (op.layout == FragmentLayout::Quads) {
+                        context.fragment_stride = fragmentQuadSize(scene.num_attributes);
+                    }
+                    context.depth_buffer = op.depth ? &depth_buffer : nullptr;
+                    context.color_layout = color_layout;
+                    context.blend_mode = mode;
+
+                    RasterizerInput input = makeInput(scene);
+                    input.depth_buffer = op.depth && !op.blend ? &depth_buffer : nullptr;
+                    FragmentBuffer buffer(size_bytes);
+                    rasterize(input, {buffer.data(), size_bytes, op.process, &context, op.layout});
+
+                    Hash hash;
+                    target.hash(hash, scene.width, scene.height);
+                    if (op.depth) {
+                        hashDepth(hash, depth_buffer);
+                    }
+                    destroyDepthBuffer(depth_buffer);
+                    results[prefix + op.name + (color_layout == ColorLayout::Blocked ? "/blocked/" : "/linear/") +
+                            std::to_string(static_cast<uint32_t>(mode)) + "/" + std::to_string(size_bytes)] =
+                        hash.value;
+                }
+            }
+        }
+    }
+}
+
+static void testTexture(Results& results, const Scene& scene, const std::string& prefix) {
+    const std::vector<uint32_t> texels = makeColors(TEXTURE_SIZE * TEXTURE_SIZE, 7);
+    Texture texture = createTexture(texels.data(), TEXTURE_SIZE, TEXTURE_SIZE);
+
+    for (bool depth : {false, true}) {
+        for (TextureFilter filter : {TextureFilter::Bilinear, TextureFilter::Trilinear}) {
+            for (TextureAddressMode address_mode : {TextureAddressMode::Repeat, TextureAddressMode::Clamp}) {
+                for (ColorLayout color_layout : {ColorLayout::Linear, ColorLayout::Blocked}) {
+                    ColorTarget target(color_layout, scene.width, scene.height);
+                    DepthBuffer depth_buffer = createDepthBuffer(scene.width, scene.height);
+                    clearDepthBuffer(depth_buffer, 1.0f);
+
+                    TexturedOutputContext context = {target.pixels(), fragmentQuadSize(scene.num_attributes),
+                                                      scene.width, &texture, TEXCOORD_ATTRIBUTE};
+                    context.filter = filter;
+                    context.address_mode = address_mode;
+                    context.depth_buffer = depth ? &depth_buffer : nullptr;
+                    context.color_layout = color_layout;
+
+                    const uint32_t size_bytes = smallBufferSize(scene, FragmentLayout::Quads);
+                    FragmentBuffer buffer(size_bytes);
+                    rasterize(makeInput(scene), {buffer.data(), size_bytes,
+                                                 depth ? processTexturedQuadsWithDepth
+                                                       : processTexturedQuadsWithoutDepth,
+                                                 &context, FragmentLayout::Quads});
+
+                    Hash hash;
+                    target.hash(hash, scene.width, scene.height);
+                    destroyDepthBuffer(depth_buffer);
+                    results[prefix + "texture/" + (depth ? "depth/" : "") +
+                            std::to_string(static_cast<uint32_t>(filter)) + "/" +
+                            std::to_string(static_cast<uint32_t>(address_mode)) +
+                            (color_layout == ColorLayout::Blocked ? "/blocked" : "/linear")] = hash.value;
+                }
+            }
+        }
+    }
+    destroyTexture(texture);
+}
+
+// Multisample operations and the resolve filters
+static void testMultisample(Results& results, const Scene& scene, const std::string& prefix) {
+    for (bool depth : {false, true}) {
+        MultisampleBuffer target = createMultisampleBuffer(scene.width, scene.height);
+        clearMultisampleBuffer(target, 0xFF202020u, 0.75f);
+
+        MultisampleOutputContext context = {&target, fragmentQuadSize(scene.num_attributes)};
+        RasterizerInput input = makeInput(scene);
+        input.multisample = true;
+        const uint32_t size_bytes = smallBufferSize(scene, FragmentLayout::Quads);
+        FragmentBuffer buffer(size_bytes);
+        rasterize(input, {buffer.data(), size_bytes,
+                          depth ? processMultisampleQuadsWithDepth : processMultisampleQuadsWithoutDepth, &context,
+                          FragmentLayout::Quads});
+
+        const uint32_t sample_count = scene.width * scene.height * MSAA_SAMPLE_COUNT;
+        Hash hash;
+        for (uint32_t s = 0; s < sample_count; ++s) {
+            hash.add(target.color[s]);
+            hash.add(target.depth[s]);
+        }
+        results[prefix + "msaa" + (depth ? "/depth" : "")] = hash.value;
+
+        for (ResolveFilter filter : {ResolveFilter::Box, ResolveFilter::Tent}) {
+            std::vector<uint32_t> image(scene.width * scene.height);
+            resolveMultisampleBuffer(target, filter, image.data(), scene.width * sizeof(uint32_t));
+            Hash resolve_hash;
+            resolve_hash.add(image.data(), image.size() * sizeof(uint32_t));
+            results[prefix + "msaa_resolve" + (depth ? "/depth/" : "/") +
+                    std::to_string(static_cast<uint32_t>(filter))] = resolve_hash.value;
+        }
+        destroyMultisampleBuffer(target);
+    }
+}
+
+// Visibility buffer filled with early depth testing and resolved into colors
+static void testVisibility(Results& results, const Scene& scene, const std::string& prefix) {
+    VisibilityBuffer visibility_buffer = createVisibilityBuffer(scene.width, scene.height);
+    clearVisibilityBuffer(visibility_buffer);
+    DepthBuffer depth_buffer = createDepthBuffer(scene.width, scene.height);
+    clearDepthBuffer(depth_buffer, 1.0f);
+
+    RasterizerInput input = makeInput(scene);
+    input.depth_buffer = &depth_buffer;
+    const uint32_t size_bytes = smallBufferSize(scene, FragmentLayout::Visibility);
+    FragmentBuffer buffer(LARGE_BUFFER_SIZE);
+    rasterize(input, {buffer.data(), size_bytes, processVisibilityFragments, &visibility_buffer,
+                      FragmentLayout::Visibility});
+
+    ColorTarget target(ColorLayout::Linear, scene.width, scene.height);
+    OutputContext context = {target.pixels(), scene.fragmentStride(), scene.width};
+    resolveVisibilityBuffer(visibility_buffer, makeInput(scene),
+                            {buffer.data(), LARGE_BUFFER_SIZE, processFragmentsWithoutDepth, &context});
+
+    Hash hash;
+    hash.add(visibility_buffer.triangles, scene.width * scene.height * sizeof(uint32_t));
+    target.hash(hash, scene.width, scene.height);
+    results[prefix + "visibility"] = hash.value;
+    destroyDepthBuffer(depth_buffer);
+    destroyVisibilityBuffer(visibility_buffer);
+}
+
+// Tiled rasterization with a fragment buffer and a consumer thread per worker
+static void testTiled(Results& results, const Scene& scene, const std::string& prefix) {
+    ColorTarget target(ColorLayout::Linear, scene.width, scene.height);
+    DepthBuffer depth_buffer = createDepthBuffer(scene.width, scene.height);
+    clearDepthBuffer(depth_buffer, 1.0f);
+
+    OutputContext context = {target.pixels(), fragmentQuadSize(scene.num_attributes), scene.width, &depth_buffer};
+    RasterizerInput input = makeInput(scene);
+    input.depth_buffer = &depth_buffer;
+    const uint32_t size_bytes = smallBufferSize(scene, FragmentLayout::Quads);
+    FragmentBuffer buffers[2] = {FragmentBuffer(2 * size_bytes), FragmentBuffer(2 * size_bytes)};
+    FragmentBufferInfo worker_buffers[2];
+    for (uint32_t worker = 0; worker < 2; ++worker) {
+        worker_buffers[worker] = {buffers[worker].data(), size_bytes, processFragmentQuadsWithDepth, &context,
+                                  FragmentLayout::Quads, 2};
+    }
+    rasterizeTiled(input, worker_buffers, 2);
+
+    Hash hash;
+    target.hash(hash, scene.width, scene.height);
+    hashDepth(hash, depth_buffer);
+    results[prefix + "tiled"] = hash.value;
+    destroyDepthBuffer(depth_buffer);
+}
+
+// Color buffer resolves and pixel conversion for export
+static void testConversions(Results& results, const Scene& scene, const std::string& prefix) {
+    ColorTarget target(ColorLayout::Blocked, scene.width, scene.height);
+    std::vector<uint8_t> bgra(scene.width * scene.height * 4);
+    std::vector<uint8_t> rgb(scene.width * scene.height * 3);
+    resolveColorBuffer(target.blocked, bgra.data(), scene.width * 4);
+    resolveColorBufferRGB(target.blocked, rgb.data(), scene.width * 3);
+    Hash resolve_hash;
+    resolve_hash.add(bgra.data(), bgra.size());
+    resolve_hash.add(rgb.data(), rgb.size());
+    results[prefix + "color_resolve"] = resolve_hash.value;
+
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(bgra.data());
+    std::vector<uint8_t> rgba(bgra.size());
+    convertPixels(pixels, PixelFormat::RGB, rgb.data(), scene.width * scene.height);
+    convertPixels(pixels, PixelFormat::RGBA, rgba.data(), scene.width * scene.height);
+    Hash convert_hash;
+    convert_hash.add(rgb.data(), rgb.size());
+    convert_hash.add(rgba.data(), rgba.size());
+    results[prefix + "convert"] = convert_hash.value;
+}
+
+// Vertex transform and clipping. The scene is used as clip-space positions
+// reaching past the guard band and the near plane.
+static void testVertices(Results& results, const Scene& scene, const std::string& prefix) {
+    std::vector<float> clip_data = scene.vertex_data;
+    const uint32_t stride = 4 + scene.num_attributes;
+    for (size_t v = 0; v < clip_data.size(); v += stride) {
+        const float w = clip_data[v + 3];
+        clip_data[v] = (clip_data[v] / scene.width * 2.0f - 1.0f) * w;
+        clip_data[v + 1] = (1.0f - clip_data[v + 1] / scene.height * 2.0f) * w;
+        clip_data[v + 2] = (clip_data[v + 2] * 1.5f - 0.25f) * w;
+    }
+    const uint32_t vertex_count = static_cast<uint32_t>(clip_data.size() / stride);
+
+    Hash hash;
+    // The second transform stretches x so that triangles leave the guard band
+    for (float scale_x : {1.0f, static_cast<float>(GUARD_BAND) / scene.width}) {
+        const Mat4<float> transform = {{scale_x, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+        const VertexInput input = {clip_data.data(), scene.indices.data(), static_cast<uint32_t>(scene.indices.size()),
+                                   scene.strideBytes(), transform, makeInput(scene).bounds};
+        VertexCache cache = createVertexCache(vertex_count, scene.strideBytes());
+        const RasterizerInput output = transformVertices(input, cache);
+        const uint32_t* indices = static_cast<const uint32_t*>(output.indices);
+        for (uint32_t i = 0; i < output.index_count; ++i) {
+            hash.add(output.vertex_data + static_cast<size_t>(indices[i]) * stride, stride * sizeof(float));
+        }
+        destroyVertexCache(cache);
+    }
+    results[prefix + "vertices"] = hash.value;
+}
+
+static Results runCases() {
+    Results results;
+    for (const auto& size : SIZES) {
+        for (uint32_t num_attributes : {4u, 6u}) {
+            const Scene scene = makeScene(size[0], size[1], num_attributes, size[0] * 1000 + size[1]);
+            const std::string prefix =
+                std::to_string(size[0]) + "x" + std::to_string(size[1]) + "/" + std::to_string(num_attributes) + "/";
+            testFragments(results, scene, prefix);
+            testColors(results, scene, prefix);
+            testMultisample(results, scene, prefix);
+            testVisibility(results, scene, prefix);
+            testTiled(results, scene, prefix);
+            testVertices(results, scene, prefix);
+            if (num_attributes > TEXCOORD_ATTRIBUTE + 1) {
+                testTexture(results, scene, prefix);
+            }
+            if (num_attributes == 4) {
+                testConversions(results, scene, prefix);
+            }
+        }
+    }
+    return results;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3 || (std::strcmp(argv[1], "--write") != 0 && std::strcmp(argv[1], "--compare") != 0)) {
+        std::fprintf(stderr, "Usage: %s --write|--compare <hash_file>\n", argv[0]);
+        return 1;
+    }
+    const char* simd = std::getenv("CASCADE_SIMD");
+    const Results results = runCases();
+
+    if (std::strcmp(argv[1], "--write") == 0) {
+        std::FILE* file = std::fopen(argv[2], "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "cannot create %s\n", argv[2]);
+            return 1;
+        }
+        for (const auto& [name, hash] : results) {
+            std::fprintf(file, "%s %016llx\n", name.c_str(), static_cast<unsigned long long>(hash));
+        }
+        std::fclose(file);
+        std::printf("%zu cases written\n", results.size());
+        return 0;
+    }
+
+    std::FILE* file = std::fopen(argv[2], "r");
+    if (file == nullptr) {
+        std::fprintf(stderr, "cannot open %s\n", argv[2]);
+        return 1;
+    }
+    std::map<std::string, uint64_t> expected;
+    char name[256];
+    unsigned long long hash;
+    while (std::fscanf(file, "%255s %llx", name, &hash) == 2) {
+        expected[name] = hash;
+    }
+    std::fclose(file);
+
+    uint32_t failures = 0;
+    for (const auto& [case_name, case_hash] : results) {
+        auto it = expected.find(case_name);
+        if (it == expected.end() || it->second != case_hash) {
+            std::printf("%s differs from the scalar kernels with CASCADE_SIMD=%s\n", case_name.c_str(),
+                        simd != nullptr ? simd : "");
+            ++failures;
+        }
+    }
+    if (expected.size() != results.size()) {
+        std::printf("%zu cases expected, %zu run\n", expected.size(), results.size());
+        ++failures;
+    }
+    std::printf("%zu cases, %u failed\n", results.size(), failures);
+    return failures == 0 ? 0 : 1;
+}